@@ -0,0 +1,739 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "KICachePolicy.h"
+#include "KMpmcQueue.h"
+
+namespace MyCache
+{
+
+// 追加日志(AOF，参考Redis)：把缓存的写操作(写入/删除/过期/清空)追加到日志文件，重启时重放恢复数据
+// - 写路径只把记录放入无锁队列，由后台写线程批量编码、write，再按策略fdatasync(组提交)
+// - 每条记录带长度和CRC32，重放时遇到不完整或损坏的尾部(写到一半时崩溃)就截断
+// - 日志比上次重写后增长到一定比例时在后台重写：把日志折叠成每个key的最新值，
+//   重写期间新写入的记录再接到新文件尾部，最后rename替换旧文件，恢复时间与写入历史的长短无关
+// - 驱逐不记日志：重放时按写入顺序批量加载，超出容量的旧条目会被重新驱逐
+// 使用POSIX文件接口
+
+
+enum class KLogOp : uint8_t
+{
+    Put = 1,
+    Remove = 2,
+    Expire = 3,     // 过期删除，重放时与Remove相同
+    Clear = 4,
+};
+
+// fdatasync的时机
+enum class KLogSyncPolicy
+{
+    Always,     // 每批写入后都同步，崩溃不丢已写出的记录
+    Interval,   // 每隔syncInterval同步一次，最多丢这段时间内的写入
+    Never,      // 交给操作系统
+};
+
+struct KAppendLogOptions
+{
+    size_t                      queueCapacity = 65536;     // 无锁队列容量，满时写路径自旋等待
+    size_t                      batchRecords = 4096;       // 每次write最多包含的记录数
+    KLogSyncPolicy              syncPolicy = KLogSyncPolicy::Interval;
+    std::chrono::milliseconds   syncInterval{1000};
+    size_t                      rewriteMinBytes = 64 << 20;    // 日志小于该大小时不自动重写
+    int                         rewritePercentage = 100;       // 比上次重写后增长的百分比，0表示不自动重写
+};
+
+struct KAppendLogStats
+{
+    uint64_t records = 0;       // 已写入文件的记录数
+    uint64_t syncs = 0;         // fdatasync次数
+    uint64_t rewrites = 0;      // 完成的重写次数
+    uint64_t fileBytes = 0;     // 当前日志大小
+    int      lastError = 0;     // 最近一次I/O错误的errno，0表示没有错误
+};
+
+struct KLogReplayStats
+{
+    uint64_t records = 0;           // 重放的记录数
+    uint64_t entries = 0;           // 折叠后的条目数
+    uint64_t truncatedBytes = 0;    // 截断的损坏尾部字节数
+};
+
+
+// 日志中key/value的编码：可平凡复制的类型直接复制字节，其他类型需特化
+template<typename T, typename Enable = void>
+struct KLogCodec
+{
+    static_assert(std::is_trivially_copyable<T>::value, "该类型不能直接按字节写入日志，需要特化KLogCodec");
+
+    static void encode(std::string& out, const T& value)
+    {
+        out.append(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    static bool decode(const char*& p, const char* end, T& value)
+    {
+        if (static_cast<size_t>(end - p) < sizeof(T))
+            return false;
+        std::memcpy(&value, p, sizeof(T));
+        p += sizeof(T);
+        return true;
+    }
+};
+
+// 字符串：4字节长度 + 内容
+template<>
+struct KLogCodec<std::string>
+{
+    static void encode(std::string& out, const std::string& value)
+    {
+        KLogCodec<uint32_t>::encode(out, static_cast<uint32_t>(value.size()));
+        out.append(value);
+    }
+
+    static bool decode(const char*& p, const char* end, std::string& value)
+    {
+        uint32_t size;
+        if (!KLogCodec<uint32_t>::decode(p, end, size) || static_cast<size_t>(end - p) < size)
+            return false;
+        value.assign(p, size);
+        p += size;
+        return true;
+    }
+};
+
+
+// CRC32(IEEE多项式)，查表实现
+inline uint32_t crc32(const char* data, size_t size)
+{
+    static const auto table = [] {
+        std::array<uint32_t, 256> t{};
+        for (uint32_t i = 0; i < 256; ++i)
+        {
+            uint32_t c = i;
+            for (int k = 0; k < 8; ++k)
+                c = (c & 1) ? 0xedb88320u ^ (c >> 1) : c >> 1;
+            t[i] = c;
+        }
+        return t;
+    }();
+    uint32_t crc = 0xffffffffu;
+    for (size_t i = 0; i < size; ++i)
+        crc = table[(crc ^ static_cast<uint8_t>(data[i])) & 0xff] ^ (crc >> 8);
+    return crc ^ 0xffffffffu;
+}
+
+
+// 日志记录，复制流(KReplication.h)使用同样的格式
+// 格式：[4字节正文长度][4字节CRC32][正文：1字节操作 + key(Clear没有) + value(仅Put)]
+template<typename Key, typename Value>
+struct KLogRecord
+{
+    KLogOp op = KLogOp::Put;
+    Key    key{};
+    Value  value{};
+
+    static void encode(std::string& out, KLogOp op, const Key& key, const Value* value)
+    {
+        size_t start = out.size();
+        out.append(8, '\0');
+        out.push_back(static_cast<char>(op));
+        if (op != KLogOp::Clear)
+            KLogCodec<Key>::encode(out, key);
+        if (op == KLogOp::Put)
+            KLogCodec<Value>::encode(out, *value);
+        uint32_t size = static_cast<uint32_t>(out.size() - start - 8);
+        uint32_t crc = crc32(out.data() + start + 8, size);
+        std::memcpy(&out[start], &size, 4);
+        std::memcpy(&out[start + 4], &crc, 4);
+    }
+
+    // 逐条解析并调用func(op, key, value)，返回最后一条完整记录之后的偏移
+    // 遇到不完整(数据还没收全)或校验失败的记录时停止
+    template<typename Func>
+    static size_t parse(const char* data, size_t size, Func&& func)
+    {
+        size_t offset = 0;
+        while (size - offset >= 8)
+        {
+            uint32_t length, crc;
+            std::memcpy(&length, data + offset, 4);
+            std::memcpy(&crc, data + offset + 4, 4);
+            if (length == 0 || size - offset - 8 < length || crc32(data + offset + 8, length) != crc)
+                break;
+
+            const char* p = data + offset + 8;
+            const char* end = p + length;
+            KLogOp op = static_cast<KLogOp>(*p++);
+            Key key{};
+            Value value{};
+            bool ok = op == KLogOp::Clear
+                || (op == KLogOp::Put && KLogCodec<Key>::decode(p, end, key) && KLogCodec<Value>::decode(p, end, value))
+                || ((op == KLogOp::Remove || op == KLogOp::Expire) && KLogCodec<Key>::decode(p, end, key));
+            if (!ok || p != end)
+                break;
+            func(op, key, value);
+            offset += 8 + length;
+        }
+        return offset;
+    }
+};
+
+
+template<typename Key, typename Value>
+class KAppendLog
+{
+public:
+    // 打开(不存在则创建)日志文件，失败抛出std::system_error
+    explicit KAppendLog(std::string path, KAppendLogOptions options = KAppendLogOptions())
+        : path_(std::move(path))
+        , options_(options)
+        , queue_(options.queueCapacity)
+        , fd_(-1)
+        , fileBytes_(0)
+        , rewriteBaseBytes_(0)
+        , written_(0)
+        , synced_(0)
+        , syncTarget_(0)
+        , stopping_(false)
+        , rewriting_(false)
+        , records_(0)
+        , syncs_(0)
+        , rewrites_(0)
+        , lastError_(0)
+    {
+        fd_ = ::open(path_.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+        if (fd_ < 0)
+            throw std::system_error(errno, std::generic_category(), "打开日志文件失败: " + path_);
+        struct stat st;
+        if (::fstat(fd_, &st) == 0)
+            fileBytes_ = static_cast<uint64_t>(st.st_size);
+        rewriteBaseBytes_ = fileBytes_;
+    }
+
+    ~KAppendLog()
+    {
+        stop();
+        if (fd_ >= 0)
+            ::close(fd_);
+    }
+
+    KAppendLog(const KAppendLog&) = delete;
+    KAppendLog& operator=(const KAppendLog&) = delete;
+
+    // 读取已有日志并折叠成每个key的最新值(按最后一次写入的顺序)，应在start之前调用
+    // 损坏的尾部会被截断，之后的追加从最后一条完整记录之后开始
+    KLogReplayStats replay(std::vector<std::pair<Key, Value>>& entries)
+    {
+        KLogReplayStats stats;
+        std::string data;
+        if (!readFile(path_, 0, fileBytes_, data))
+            return stats;
+
+        Folder folder;
+        size_t valid = Record::parse(data.data(), data.size(), [&](KLogOp op, Key& key, Value& value) {
+            folder.apply(op, key, value);
+            ++stats.records;
+        });
+        if (valid < data.size())
+        {
+            stats.truncatedBytes = data.size() - valid;
+            if (::ftruncate(fd_, static_cast<off_t>(valid)) != 0)
+                lastError_ = errno;
+            fileBytes_ = valid;
+            rewriteBaseBytes_ = valid;
+        }
+        folder.collect(entries);
+        stats.entries = entries.size();
+        return stats;
+    }
+
+    // 启动后台写线程
+    void start()
+    {
+        if (!writer_.joinable())
+            writer_ = std::thread(&KAppendLog::writerLoop, this);
+    }
+
+    // 停止写线程：队列中剩余的记录写完并同步后返回
+    void stop()
+    {
+        if (writer_.joinable())
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                stopping_ = true;
+            }
+            wakeup_.notify_one();
+            writer_.join();
+        }
+        if (rewriter_.joinable())
+            rewriter_.join();
+    }
+
+    // 追加一条记录(只入队，不做I/O)，队满时自旋等待写线程
+    void append(KLogOp op, const Key& key, const Value& value = Value())
+    {
+        queue_.push(Record{op, key, value});
+    }
+
+    // 等待此前追加的记录都写入并fdatasync，返回期间是否没有发生I/O错误
+    bool sync()
+    {
+        uint64_t target = queue_.enqueued();
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (!writer_.joinable())
+            return false;
+        syncTarget_ = std::max(syncTarget_, target);
+        wakeup_.notify_one();
+        syncedCv_.wait(lock, [&] { return synced_ >= target; });
+        return lastError_.load() == 0;
+    }
+
+    // 在后台重写日志，已在重写时忽略
+    void rewrite()
+    {
+        bool expected = false;
+        if (!rewriting_.compare_exchange_strong(expected, true))
+            return;
+        if (rewriter_.joinable())
+            rewriter_.join();   // 上一次重写的线程已经结束
+        rewriter_ = std::thread(&KAppendLog::rewriteLog, this);
+    }
+
+    bool rewriting() const { return rewriting_.load(); }
+
+    KAppendLogStats stats()
+    {
+        KAppendLogStats stats;
+        stats.records = records_.load();
+        stats.syncs = syncs_.load();
+        stats.rewrites = rewrites_.load();
+        stats.lastError = lastError_.load();
+        std::lock_guard<std::mutex> lock(fileMutex_);
+        stats.fileBytes = fileBytes_;
+        return stats;
+    }
+
+    const std::string& path() const { return path_; }
+
+private:
+    using Record = KLogRecord<Key, Value>;
+
+    // 日志折叠：每个key只保留最后一次写入，保持最后写入的先后顺序
+    class Folder
+    {
+    public:
+        void apply(KLogOp op, Key& key, Value& value)
+        {
+            switch (op)
+            {
+            case KLogOp::Put:
+            {
+                auto it = index_.find(key);
+                if (it != index_.end())
+                {
+                    alive_[it->second] = false;
+                    it->second = entries_.size();
+                }
+                else
+                {
+                    index_.emplace(key, entries_.size());
+                }
+                entries_.emplace_back(std::move(key), std::move(value));
+                alive_.push_back(true);
+                break;
+            }
+            case KLogOp::Remove:
+            case KLogOp::Expire:
+            {
+                auto it = index_.find(key);
+                if (it != index_.end())
+                {
+                    alive_[it->second] = false;
+                    index_.erase(it);
+                }
+                break;
+            }
+            case KLogOp::Clear:
+                index_.clear();
+                entries_.clear();
+                alive_.clear();
+                break;
+            }
+        }
+
+        void collect(std::vector<std::pair<Key, Value>>& out)
+        {
+            out.clear();
+            out.reserve(index_.size());
+            for (size_t i = 0; i < entries_.size(); ++i)
+            {
+                if (alive_[i])
+                    out.push_back(std::move(entries_[i]));
+            }
+        }
+
+    private:
+        std::unordered_map<Key, size_t>       index_;     // key -> entries_中的下标
+        std::vector<std::pair<Key, Value>>    entries_;
+        std::vector<bool>                     alive_;
+    };
+
+    // 读取文件从offset开始的size字节，文件不存在返回false
+    static bool readFile(const std::string& path, uint64_t offset, uint64_t size, std::string& data)
+    {
+        int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0)
+            return false;
+        data.resize(size);
+        size_t done = 0;
+        while (done < size)
+        {
+            ssize_t n = ::pread(fd, &data[done], size - done, static_cast<off_t>(offset + done));
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n <= 0)
+                break;
+            done += static_cast<size_t>(n);
+        }
+        data.resize(done);
+        ::close(fd);
+        return true;
+    }
+
+    static bool writeAll(int fd, const char* data, size_t size)
+    {
+        while (size > 0)
+        {
+            ssize_t n = ::write(fd, data, size);
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n <= 0)
+                return false;
+            data += n;
+            size -= static_cast<size_t>(n);
+        }
+        return true;
+    }
+
+    // 后台写线程：取出一批记录编码后一次write，按策略同步
+    void writerLoop()
+    {
+        std::string buffer;
+        Record record;
+        auto lastSync = std::chrono::steady_clock::now();
+        while (true)
+        {
+            buffer.clear();
+            size_t count = 0;
+            while (count < options_.batchRecords && queue_.tryPop(record))
+            {
+                Record::encode(buffer, record.op, record.key, &record.value);
+                ++count;
+            }
+            if (count > 0)
+            {
+                std::lock_guard<std::mutex> lock(fileMutex_);
+                if (writeAll(fd_, buffer.data(), buffer.size()))
+                    fileBytes_ += buffer.size();
+                else
+                    lastError_ = errno;
+                written_ += count;
+                records_ += count;
+            }
+
+            auto now = std::chrono::steady_clock::now();
+            bool requested;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                requested = syncTarget_ > synced_ && written_ > synced_;
+            }
+            bool due = options_.syncPolicy == KLogSyncPolicy::Always
+                || (options_.syncPolicy == KLogSyncPolicy::Interval && now - lastSync >= options_.syncInterval);
+            if (requested || (due && synced_ < written_))
+            {
+                syncFile();
+                lastSync = now;
+            }
+
+            maybeRewrite();
+
+            if (count == 0)
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                if (stopping_ && queue_.enqueued() == written_)
+                    break;
+                // 写路径不通知写线程(避免在热路径上加锁)，空闲时按短间隔轮询
+                wakeup_.wait_for(lock, kIdleWait, [&] { return stopping_ || syncTarget_ > synced_; });
+            }
+        }
+        syncFile();
+    }
+
+    void syncFile()
+    {
+        uint64_t written = written_;
+        {
+            std::lock_guard<std::mutex> lock(fileMutex_);
+            if (::fdatasync(fd_) != 0)
+                lastError_ = errno;
+        }
+        ++syncs_;
+        std::lock_guard<std::mutex> lock(mutex_);
+        synced_ = written;
+        syncedCv_.notify_all();
+    }
+
+    void maybeRewrite()
+    {
+        if (options_.rewritePercentage <= 0 || rewriting_.load())
+            return;
+        {
+            std::lock_guard<std::mutex> lock(fileMutex_);
+            if (fileBytes_ < options_.rewriteMinBytes
+                || fileBytes_ - rewriteBaseBytes_ < rewriteBaseBytes_ * options_.rewritePercentage / 100)
+                return;
+        }
+        rewrite();
+    }
+
+    // 重写：折叠当前日志写成新文件，再把重写期间追加的部分接到新文件尾部，rename替换
+    void rewriteLog()
+    {
+        uint64_t base;
+        {
+            std::lock_guard<std::mutex> lock(fileMutex_);
+            base = fileBytes_;
+        }
+
+        std::string data;
+        readFile(path_, 0, base, data);
+        Folder folder;
+        size_t valid = Record::parse(data.data(), data.size(), [&](KLogOp op, Key& key, Value& value) {
+            folder.apply(op, key, value);
+        });
+        std::vector<std::pair<Key, Value>> entries;
+        folder.collect(entries);
+        data.clear();
+        data.shrink_to_fit();
+
+        std::string buffer;
+        for (const auto& entry : entries)
+            Record::encode(buffer, KLogOp::Put, entry.first, &entry.second);
+        entries.clear();
+
+        std::string tmpPath = path_ + ".rewrite";
+        int fd = ::open(tmpPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_APPEND | O_CLOEXEC, 0644);
+        bool ok = fd >= 0 && writeAll(fd, buffer.data(), buffer.size());
+        if (ok)
+        {
+            std::lock_guard<std::mutex> lock(fileMutex_);
+            // 写线程此时被阻塞，把重写期间追加的记录接到新文件后面
+            std::string tail;
+            readFile(path_, valid, fileBytes_ - valid, tail);
+            ok = writeAll(fd, tail.data(), tail.size())
+                && ::fdatasync(fd) == 0
+                && ::rename(tmpPath.c_str(), path_.c_str()) == 0;
+            if (ok)
+            {
+                syncDirectory();
+                ::close(fd_);
+                fd_ = fd;
+                fileBytes_ = buffer.size() + tail.size();
+                rewriteBaseBytes_ = fileBytes_;
+                fd = -1;
+                ++rewrites_;
+            }
+        }
+        if (!ok)
+        {
+            lastError_ = errno;
+            ::unlink(tmpPath.c_str());
+        }
+        if (fd >= 0)
+            ::close(fd);
+        rewriting_ = false;
+    }
+
+    // rename之后同步所在目录，保证新文件名落盘
+    void syncDirectory()
+    {
+        size_t slash = path_.rfind('/');
+        std::string dir = slash == std::string::npos ? "." : path_.substr(0, slash + 1);
+        int fd = ::open(dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if (fd >= 0)
+        {
+            ::fsync(fd);
+            ::close(fd);
+        }
+    }
+
+private:
+    static constexpr std::chrono::milliseconds kIdleWait{1};
+
+    const std::string           path_;
+    const KAppendLogOptions     options_;
+    KMpmcQueue<Record>          queue_;
+
+    std::mutex                  fileMutex_;         // 保护fd_和文件大小：写线程写入与重写替换文件互斥
+    int                         fd_;
+    uint64_t                    fileBytes_;
+    uint64_t                    rewriteBaseBytes_;  // 上次重写后的大小
+
+    std::mutex                  mutex_;             // 保护同步进度和停止标志
+    std::condition_variable     wakeup_;            // 唤醒写线程
+    std::condition_variable     syncedCv_;         // 通知sync()的等待者
+    std::atomic<uint64_t>       written_;           // 已写入文件的记录数(等于出队数)
+    uint64_t                    synced_;            // 已同步到磁盘的记录数
+    uint64_t                    syncTarget_;        // sync()要求同步到的记录数
+    bool                        stopping_;
+
+    std::atomic<bool>           rewriting_;
+    std::thread                 writer_;
+    std::thread                 rewriter_;
+
+    std::atomic<uint64_t>       records_;
+    std::atomic<uint64_t>       syncs_;
+    std::atomic<uint64_t>       rewrites_;
+    std::atomic<int>            lastError_;
+};
+
+
+// 带追加日志的缓存：包装任意缓存，写操作在缓存锁内记日志(保证日志顺序与生效顺序一致)
+// 构造时重放日志，把折叠后的数据批量加载进缓存，然后开始记录
+template<typename Key, typename Value>
+class KAofCache : public KICachePolicy<Key, Value>
+{
+public:
+    KAofCache(KICachePolicy<Key, Value>& cache, const std::string& path,
+              KAppendLogOptions options = KAppendLogOptions())
+        : cache_(cache)
+        , log_(path, options)
+    {
+        std::vector<std::pair<Key, Value>> entries;
+        replayStats_ = log_.replay(entries);
+        cache_.bulkLoad(entries);
+        log_.start();
+    }
+
+    ~KAofCache() override = default;
+
+    void put(Key key, Value value) override
+    {
+        compute(key, [&](bool, Value& current, uint64_t) {
+            current = value;
+            return KComputeAction::Store;
+        });
+    }
+
+    bool get(Key key, Value& value) override
+    {
+        return cache_.get(key, value);
+    }
+
+    Value get(Key key) override
+    {
+        return cache_.get(key);
+    }
+
+    uint64_t compute(const Key& key, const typename KICachePolicy<Key, Value>::ComputeFunc& func) override
+    {
+        return cache_.compute(key, [&](bool present, Value& value, uint64_t version) {
+            KComputeAction action = func(present, value, version);
+            if (action == KComputeAction::Store)
+                log_.append(KLogOp::Put, key, value);
+            else if (action == KComputeAction::Remove && present)
+                log_.append(KLogOp::Remove, key);
+            return action;
+        });
+    }
+
+    // 删除key，返回是否存在
+    bool remove(const Key& key)
+    {
+        return removeWith(key, KLogOp::Remove);
+    }
+
+    // 过期删除(由上层的过期机制调用)，日志中记为过期
+    bool expire(const Key& key)
+    {
+        return removeWith(key, KLogOp::Expire);
+    }
+
+    // 先记日志再清空：与clear并发的写入在重放时可能保留下来，但不会丢失
+    void clear() override
+    {
+        log_.append(KLogOp::Clear, Key());
+        cache_.clear();
+    }
+
+    // 淘汰不写日志(重放时由容量自然淘汰)，只转发监听
+    void setEvictionListener(typename KICachePolicy<Key, Value>::EvictionListener listener) override
+    {
+        cache_.setEvictionListener(std::move(listener));
+    }
+
+    KMemoryUsage memoryUsage() override
+    {
+        return cache_.memoryUsage();
+    }
+
+    void snapshot(std::vector<std::pair<Key, Value>>& entries) override
+    {
+        cache_.snapshot(entries);
+    }
+
+    // 等待之前的写操作都落盘
+    bool sync() { return log_.sync(); }
+
+    // 在后台压缩日志
+    void rewriteLog() { log_.rewrite(); }
+
+    bool rewriting() const { return log_.rewriting(); }
+
+    KAppendLogStats logStats() { return log_.stats(); }
+
+    const KLogReplayStats& replayStats() const { return replayStats_; }
+
+private:
+    bool removeWith(const Key& key, KLogOp op)
+    {
+        bool removed = false;
+        cache_.compute(key, [&](bool present, Value&, uint64_t) {
+            if (!present)
+                return KComputeAction::Keep;
+            log_.append(op, key);
+            removed = true;
+            return KComputeAction::Remove;
+        });
+        return removed;
+    }
+
+private:
+    KICachePolicy<Key, Value>&  cache_;
+    KAppendLog<Key, Value>      log_;
+    KLogReplayStats             replayStats_;
+};
+
+} // namespace MyCache
@@ -3,6 +3,7 @@
 #include "../KICachePolicy.h"
 #include "KArcLruPart.h"
 #include "KArcLfuPart.h"
+#include <algorithm>
 #include <memory>
 
 namespace MyCache 
@@ -17,15 +18,144 @@ public:
         , transformThreshold_(transformThreshold)
         , lruPart_(std::make_unique<ArcLruPart<Key, Value>>(capacity/2, transformThreshold))
         , lfuPart_(std::make_unique<ArcLfuPart<Key, Value>>(capacity/2, transformThreshold))
-    {}
+        , versionCounter_(0)
+    {
+        MyCache::setLockName(mutex_, "KArcCache");
+        lruPart_->setLockName("KArcCache.lru");
+        lfuPart_->setLockName("KArcCache.lfu");
+    }
 
     ~KArcCache() override = default;
 
     void put(Key key, Value value) override 
+    {
+        std::lock_guard<KCacheMutex> lock(mutex_);
+        putLocked(key, value, ++versionCounter_);
+    }
+
+    bool get(Key key, Value& value) override 
+    {
+        std::lock_guard<KCacheMutex> lock(mutex_);
+        uint64_t version = 0;
+        return getLocked(key, value, version);
+    }
+
+    Value get(Key key) override 
+    {
+        Value value{};
+        get(key, value);
+        return value;
+    }
+
+    // 原子读-改-写：在整个ARC的锁内完成，读取与get、写入与put的效果相同
+    // (ARC需要分别查询LRU、LFU两部分及其幽灵缓存，无法做到只查找一次)
+    uint64_t compute(const Key& key, const typename KICachePolicy<Key, Value>::ComputeFunc& func) override
+    {
+        std::lock_guard<KCacheMutex> lock(mutex_);
+        Value value{};
+        uint64_t version = 0;
+        bool present = getLocked(key, value, version);
+        if (!present)
+            value = Value{};
+
+        switch (func(present, value, present ? version : 0))
+        {
+        case KComputeAction::Keep:
+            return present ? version : 0;
+        case KComputeAction::Store:
+            version = ++versionCounter_;
+            putLocked(key, value, version);
+            return capacity_ > 0 ? version : 0;
+        case KComputeAction::Remove:
+            lruPart_->remove(key);
+            lfuPart_->remove(key);
+            return 0;
+        }
+        return 0;
+    }
+
+    // 运行时调整lru转lfu的访问次数阈值(供自动调参使用)
+    void setTransformThreshold(size_t transformThreshold)
+    {
+        std::lock_guard<KCacheMutex> lock(mutex_);
+        transformThreshold_ = std::max<size_t>(transformThreshold, 1);
+        lruPart_->setTransformThreshold(transformThreshold_);
+        lfuPart_->setTransformThreshold(transformThreshold_);
+    }
+
+    size_t getTransformThreshold()
+    {
+        std::lock_guard<KCacheMutex> lock(mutex_);
+        return transformThreshold_;
+    }
+
+    // O(1)清空两部分缓存(包括幽灵缓存)
+    void clear() override
+    {
+        std::lock_guard<KCacheMutex> lock(mutex_);
+        lruPart_->clear();
+        lfuPart_->clear();
+    }
+
+    void setNamespaceFunc(typename KGeneration<Key>::NamespaceFunc func)
+    {
+        std::lock_guard<KCacheMutex> lock(mutex_);
+        lruPart_->setNamespaceFunc(func);
+        lfuPart_->setNamespaceFunc(func);
+    }
+
+    void invalidateNamespace(uint32_t ns)
+    {
+        std::lock_guard<KCacheMutex> lock(mutex_);
+        lruPart_->invalidateNamespace(ns);
+        lfuPart_->invalidateNamespace(ns);
+    }
+
+    size_t sweepStale(size_t maxBuckets = 64)
+    {
+        std::lock_guard<KCacheMutex> lock(mutex_);
+        return lruPart_->sweepStale(maxBuckets) + lfuPart_->sweepStale(maxBuckets);
+    }
+
+    // 外层锁以及LRU部分、LFU部分各自锁的竞争统计
+    void collectLockStats(std::vector<KLockStats>& out) const
+    {
+        MyCache::collectLockStats(mutex_, out);
+        lruPart_->collectLockStats(out);
+        lfuPart_->collectLockStats(out);
+    }
+
+    // 先LRU部分再LFU部分(LFU部分是访问多次的热数据)
+    void snapshot(std::vector<std::pair<Key, Value>>& entries) override
+    {
+        std::lock_guard<KCacheMutex> lock(mutex_);
+        lruPart_->snapshot(entries);
+        lfuPart_->snapshot(entries);
+    }
+
+    // 两部分的主缓存淘汰都通知listener(ARC的自适应调整可能在一次put中驱逐另一部分的节点)
+    void setEvictionListener(typename KICachePolicy<Key, Value>::EvictionListener listener) override
+    {
+        std::lock_guard<KCacheMutex> lock(mutex_);
+        lruPart_->setEvictionListener(listener);
+        lfuPart_->setEvictionListener(std::move(listener));
+    }
+
+    // LRU部分和LFU部分之和
+    KMemoryUsage memoryUsage() override
+    {
+        std::lock_guard<KCacheMutex> lock(mutex_);
+        KMemoryUsage usage = lruPart_->memoryUsage();
+        usage += lfuPart_->memoryUsage();
+        return usage;
+    }
+
+private:
+    void putLocked(const Key& key, const Value& value, uint64_t version)
     {
         // 若幽灵缓存中有该节点，则删除，并调整主缓存大小
         Value ghostValue;
-        bool inGhost = checkGhostCaches(key, ghostValue);
+        checkGhostCaches(key, ghostValue);
         
         bool inLru = lruPart_->existsInMain(key);
         bool inLfu = lfuPart_->existsInMain(key);
@@ -35,15 +165,15 @@ public:
         {
             // 如果在lfu主缓存中，则更新LFU中的现有项
             if (inLfu)
-                lfuPart_->put(key, value); 
+                lfuPart_->put(key, value, version); 
 
             // 如果在lru主缓存中，则更新LRU中的现有项，并检查是否达到迁移阈值，若达到则迁移至LFU
             if (inLru) 
             {
-                bool shouldTransform = lruPart_->put(key, value);
+                bool shouldTransform = lruPart_->put(key, value, version);
                 if (shouldTransform) 
                 {
-                    lfuPart_->put(key, value);
+                    lfuPart_->put(key, value, version);
                     lruPart_->remove(key);  // 从LRU移除
                 }
 
@@ -52,10 +182,11 @@ public:
         }
 
         //如果不在幽灵缓存，添加至lru中即可
-        lruPart_->put(key, value);
+        lruPart_->put(key, value, version);
     }
 
-    bool get(Key key, Value& value) override 
+    // 查找key，命中时通过version返回其版本号
+    bool getLocked(const Key& key, Value& value, uint64_t& version)
     {
         Value ghostValue;
         bool inGhost = checkGhostCaches(key, ghostValue);
@@ -67,14 +198,14 @@ public:
         if(inLru || inLfu)
         {
             if(inLfu)
-                lfuPart_->get(key, value);
+                lfuPart_->get(key, value, &version);
             if(inLru)
             {
                 bool shouldTransform = false;
-                lruPart_->get(key, value, shouldTransform);
+                lruPart_->get(key, value, shouldTransform, &version);
                 if (shouldTransform) 
                 {
-                    lfuPart_->put(key, value);
+                    lfuPart_->put(key, value, version);   // 迁移不改变版本号
                     lruPart_->remove(key);  //保证一个节点只存在于一个主缓存中
                 }
             }
@@ -84,17 +215,9 @@ public:
         //如果不在主缓存，但在幽灵缓存，说明刚被淘汰，应加入lru主缓存中
         if(inGhost)
         {
-            lruPart_->put(key, ghostValue);
+            lruPart_->put(key, ghostValue, ++versionCounter_);
         }
         return false;
-
-    }
-
-    Value get(Key key) override 
-    {
-        Value value{};
-        get(key, value);
-        return value;
     }
 
 private:
@@ -125,6 +248,8 @@ private:
     size_t transformThreshold_;     //lru中的数据转lfu的访问次数阈值
     std::unique_ptr<ArcLruPart<Key, Value>> lruPart_;   //指向lru组件的指针
     std::unique_ptr<ArcLfuPart<Key, Value>> lfuPart_;   //指向lfu组件的指针
+    KCacheMutex mutex_;         //保证对两部分的组合操作是原子的
+    uint64_t versionCounter_;   //版本号计数器
 };
 
 } // namespace MyCache
\ No newline at end of file
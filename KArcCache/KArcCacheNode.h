@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstdint>
 #include <memory>
 
 namespace MyCache 
@@ -9,28 +10,36 @@ template<typename Key, typename Value>
 class ArcNode 
 {
 private:
-    Key key_;
-    Value value_;
-    size_t accessCount_;    //访问计数器(用于lfu逻辑)
+    // 链表指针和计数器放在前面，与shared_ptr控制块相邻：链表操作和淘汰只访问这一段，不读后面的key/value
     std::shared_ptr<ArcNode> prev_;     //双向链表前驱指针
     std::shared_ptr<ArcNode> next_;     //双向链表后继指针
-    
+    size_t accessCount_;    //访问计数器(用于lfu逻辑)
+    uint32_t namespace_;    //所属命名空间
+    uint64_t generation_;   //插入时的代数
+    uint64_t version_;      //版本号，每次写入value时由KArcCache分配
+    Key key_;
+    Value value_;
+
 
 public:
-    ArcNode() : accessCount_(1), prev_(nullptr), next_(nullptr) {}
+    ArcNode() : prev_(nullptr), next_(nullptr), accessCount_(1), namespace_(0), generation_(0), version_(0) {}
     // 构造函数：初始化键值对，访问次数默认为1
-    ArcNode(Key key, Value value) 
-        : key_(key)
-        , value_(value)
+    ArcNode(Key key, Value value, uint32_t ns = 0, uint64_t generation = 0) 
+        : prev_(nullptr)
+        , next_(nullptr)
         , accessCount_(1)
-        , prev_(nullptr)
-        , next_(nullptr) 
+        , namespace_(ns)
+        , generation_(generation)
+        , version_(0)
+        , key_(key)
+        , value_(value)
     {}
 
     // Getters
     Key getKey() const { return key_; }
     Value getValue() const { return value_; }
     size_t getAccessCount() const { return accessCount_; }
+    uint64_t getVersion() const { return version_; }
     
     // Setters
     void setValue(const Value& value) { value_ = value; }
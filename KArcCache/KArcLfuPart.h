@@ -1,9 +1,16 @@
 #pragma once
 
 #include "KArcCacheNode.h"
+#include "../KGeneration.h"
+#include "../KLockProfiler.h"
+#include "../KMemoryUsage.h"
+#include <functional>
+#include <list>
 #include <unordered_map>
 #include <map>
 #include <mutex>
+#include <string>
+#include <vector>
 
 namespace MyCache 
 {
@@ -28,38 +35,58 @@ public:
         initializeLists();
     }
 
-    // 插入/更新缓存
-    bool put(Key key, Value value) 
+    // 插入/更新缓存，version为该值的版本号
+    bool put(Key key, Value value, uint64_t version = 0) 
     {
         if (capacity_ == 0)     return false;    //容量为0，插入失败
 
-        std::lock_guard<std::mutex> lock(mutex_);
-        auto it = mainCache_.find(key);
+        std::lock_guard<KCacheMutex> lock(mutex_);
+        auto it = findLiveMain(key);
         if (it != mainCache_.end()) 
         {
+            it->second->version_ = version;
             return updateExistingNode(it->second, value);   //若缓存中已存在键为key的节点，更新现有节点
         }
-        return addNewNode(key, value);  //若不存在，则插入新节点
+        return addNewNode(key, value, version);  //若不存在，则插入新节点
     }
 
-    // 获取缓存
-    bool get(Key key, Value& value) 
+    // 获取缓存(可同时取出版本号)
+    bool get(Key key, Value& value, uint64_t* version = nullptr) 
     {
-        std::lock_guard<std::mutex> lock(mutex_);
-        auto it = mainCache_.find(key);
+        std::lock_guard<KCacheMutex> lock(mutex_);
+        auto it = findLiveMain(key);
         if (it != mainCache_.end())     //若命中缓存
         {
             updateNodeFrequency(it->second);    //更新该节点频率
             value = it->second->getValue();     //获取value
+            if (version)
+                *version = it->second->getVersion();
             return true;
         }
         return false;   //未命中
     }
 
+    // 从主缓存中删除指定元素(不进入幽灵缓存)
+    void remove(Key key)
+    {
+        std::lock_guard<KCacheMutex> lock(mutex_);
+        auto it = mainCache_.find(key);
+        if (it != mainCache_.end())
+            eraseMain(it);
+    }
+
     // 检查幽灵缓存是否存在键为key的节点
     bool checkGhost(Key key, Value& ghostValue) 
     {
+        std::lock_guard<KCacheMutex> lock(mutex_);
         auto it = ghostCache_.find(key);
+        if (it != ghostCache_.end() && isStale(it->second))
+        {
+            // 清空前的幽灵记录不再参与容量调整
+            removeFromGhost(it->second);
+            ghostCache_.erase(it);
+            return false;
+        }
         if (it != ghostCache_.end()) 
         {
             ghostValue = it->second->getValue();
@@ -71,24 +98,120 @@ public:
     }
 
     // 主缓存容量+1
-    void increaseCapacity() { ++capacity_; }
+    void increaseCapacity() 
+    { 
+        std::lock_guard<KCacheMutex> lock(mutex_);
+        ++capacity_; 
+        MYCACHE_TRACE_INSTANT(Resize, "KArcCache.lfu", capacity_);
+    }
     
     // 主缓存容量-1
     bool decreaseCapacity() 
     {
+        std::lock_guard<KCacheMutex> lock(mutex_);
         if (capacity_ <= 0) return false;
         if (mainCache_.size() == capacity_) 
         {
             evictLeastFrequent();
         }
         --capacity_;
+        MYCACHE_TRACE_INSTANT(Resize, "KArcCache.lfu", capacity_);
         return true;
     }
 
+    // O(1)清空：主缓存和幽灵缓存中的现有节点立即不可见
+    void clear()
+    {
+        std::lock_guard<KCacheMutex> lock(mutex_);
+        generation_.invalidateAll(mainCache_.size() + ghostCache_.size());
+    }
+
+    void setNamespaceFunc(typename KGeneration<Key>::NamespaceFunc func)
+    {
+        std::lock_guard<KCacheMutex> lock(mutex_);
+        generation_.setNamespaceFunc(std::move(func));
+    }
+
+    void invalidateNamespace(uint32_t ns)
+    {
+        std::lock_guard<KCacheMutex> lock(mutex_);
+        generation_.invalidateNamespace(ns, mainCache_.size() + ghostCache_.size());
+    }
+
+    // 回收主缓存中的过期节点(幽灵缓存中的过期节点在被查到或被挤出时回收)
+    size_t sweepStale(size_t maxBuckets = 64)
+    {
+        std::lock_guard<KCacheMutex> lock(mutex_);
+        return sweepStaleLocked(maxBuckets);
+    }
+
+    void setLockName(const std::string& name)
+    {
+        MyCache::setLockName(mutex_, name);
+    }
+
+    // 主缓存的节点被驱逐到幽灵缓存时调用(此后get不再命中)，在锁内执行
+    void setEvictionListener(std::function<void(const Key&, const Value&)> listener)
+    {
+        evictionListener_ = std::move(listener);
+    }
+
+    void collectLockStats(std::vector<KLockStats>& out) const
+    {
+        MyCache::collectLockStats(mutex_, out);
+    }
+
+    // 调整转移阈值
+    void setTransformThreshold(size_t transformThreshold)
+    {
+        std::lock_guard<KCacheMutex> lock(mutex_);
+        transformThreshold_ = transformThreshold;
+    }
+
     // 检查主缓存中是否有键为key的节点
     bool existsInMain(Key key) 
     {
-        return mainCache_.find(key) != mainCache_.end();
+        std::lock_guard<KCacheMutex> lock(mutex_);
+        return findLiveMain(key) != mainCache_.end();
+    }
+
+    // 主缓存的快照：按访问频次从低到高，同一频次内从旧到新
+    void snapshot(std::vector<std::pair<Key, Value>>& entries)
+    {
+        std::lock_guard<KCacheMutex> lock(mutex_);
+        for (const auto& pair : freqMap_)
+        {
+            for (const auto& node : pair.second)
+            {
+                if (!isStale(node))
+                    entries.emplace_back(node->key_, node->value_);
+            }
+        }
+    }
+
+    // 内存统计：主缓存的key/value计为有效数据；幽灵缓存只用于调整容量，整体计为管理开销
+    KMemoryUsage memoryUsage()
+    {
+        std::lock_guard<KCacheMutex> lock(mutex_);
+        KMemoryUsage usage;
+        usage.entries = mainCache_.size();
+        usage.indexBytes = hashMapBytes(mainCache_);
+        usage.payloadBytes = usage.entries * (sizeof(Key) + sizeof(Value));
+        usage.metadataBytes = nodeMemory_.bytes() - usage.payloadBytes + hashMapBytes(ghostCache_)
+            + treeMapBytes(freqMap_);
+        for (const auto& pair : freqMap_)
+            usage.metadataBytes += listBytes(pair.second);
+        for (const auto& pair : mainCache_)
+        {
+            usage.indexBytes += heapBytesOf(pair.first);
+            usage.payloadBytes += heapBytesOf(pair.second->key_) + heapBytesOf(pair.second->value_);
+        }
+        for (const auto& pair : ghostCache_)
+        {
+            usage.metadataBytes += heapBytesOf(pair.first)
+                + heapBytesOf(pair.second->key_) + heapBytesOf(pair.second->value_);
+        }
+        return usage;
     }
 
 
@@ -145,6 +268,9 @@ private:
         // 移除最少使用的节点
         NodePtr leastNode = minFreqList.front();
         minFreqList.pop_front();
+        MYCACHE_TRACE_INSTANT(Evict, "KArcCache.lfu", minFreq_);
+        if (evictionListener_)
+            evictionListener_(leastNode->getKey(), leastNode->getValue());
 
         // 如果移除该节点后，该节点对应的频率列表为空，则删除该频率项
         if (minFreqList.empty()) 
@@ -168,6 +294,49 @@ private:
         mainCache_.erase(leastNode->getKey());
     }
 
+    bool isStale(const NodePtr& node) const
+    {
+        return generation_.isStale(node->namespace_, node->generation_);
+    }
+
+    // 查找主缓存中未过期的节点，找到过期节点时顺便回收
+    typename NodeMap::iterator findLiveMain(const Key& key)
+    {
+        auto it = mainCache_.find(key);
+        if (it != mainCache_.end() && isStale(it->second))
+        {
+            eraseMain(it);
+            return mainCache_.end();
+        }
+        return it;
+    }
+
+    size_t sweepStaleLocked(size_t maxBuckets)
+    {
+        return generation_.sweep(mainCache_, maxBuckets,
+            [this](const NodePtr& node) { return isStale(node); },
+            [this](const Key& key) { eraseMain(mainCache_.find(key)); });
+    }
+
+    // 从主缓存中直接删除节点(不进入幽灵缓存)
+    void eraseMain(typename NodeMap::iterator it)
+    {
+        NodePtr node = it->second;
+        mainCache_.erase(it);
+
+        size_t freq = node->getAccessCount();
+        auto listIt = freqMap_.find(freq);
+        if (listIt == freqMap_.end())
+            return;
+        listIt->second.remove(node);
+        if (listIt->second.empty())
+        {
+            freqMap_.erase(listIt);
+            if (freq == minFreq_ && !freqMap_.empty())
+                minFreq_ = freqMap_.begin()->first;
+        }
+    }
+
     // 更新主缓存节点频率
     void updateNodeFrequency(NodePtr node) 
     {
@@ -204,14 +373,20 @@ private:
     }
 
     // 向主缓存中添加一个节点
-    bool addNewNode(const Key& key, const Value& value) 
+    bool addNewNode(const Key& key, const Value& value, uint64_t version) 
     {
+        if (mainCache_.size() >= capacity_ && generation_.hasStale())
+        {
+            sweepStaleLocked(kEvictSweepBuckets);   // 优先回收过期节点
+        }
         if (mainCache_.size() >= capacity_) 
         {
             evictLeastFrequent();   //主缓存满了就先驱逐一个到幽灵缓存
         }
 
-        NodePtr newNode = std::make_shared<NodeType>(key, value);
+        NodePtr newNode = std::allocate_shared<NodeType>(KCountingAllocator<NodeType>(&nodeMemory_), key, value,
+            generation_.namespaceOf(key), generation_.current());
+        newNode->version_ = version;
         mainCache_[key] = newNode;  //添加到主缓存hash表
         
         // 将新节点添加到频率为1的列表中
@@ -234,8 +409,12 @@ private:
     size_t ghostCapacity_;      // 幽灵缓存容量
     size_t transformThreshold_; // 转移阈值
     size_t minFreq_;            // 当前缓存中频率最小节点的频率
-    std::mutex mutex_;          // 互斥锁
+    KCacheMutex mutex_;         // 互斥锁
+    KGeneration<Key> generation_;   // 代数：O(1)清空和命名空间失效
+    std::function<void(const Key&, const Value&)> evictionListener_;    // 淘汰监听，由KArcCache设置
+    static constexpr size_t kEvictSweepBuckets = 8;    // 驱逐前顺带回收过期节点时扫描的桶数
 
+    KMemoryCounter nodeMemory_;    // 节点(含控制块)占用的字节数，主缓存和幽灵缓存的节点都计入
     NodeMap mainCache_;         // 主缓存hash表
     NodeMap ghostCache_;        // 幽灵缓存hash表
     FreqMap freqMap_;           // 频率->该频率对应的链表
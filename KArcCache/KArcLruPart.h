@@ -1,8 +1,14 @@
 #pragma once
 
 #include "KArcCacheNode.h"
+#include "../KGeneration.h"
+#include "../KLockProfiler.h"
+#include "../KMemoryUsage.h"
+#include <functional>
 #include <unordered_map>
 #include <mutex>
+#include <string>
+#include <vector>
 
 namespace MyCache 
 {
@@ -26,36 +32,39 @@ public:
         initializeLists();  // 初始化主缓存双向链表、幽灵缓存双向链表
     }
 
-    // 在主缓存中 插入/更新缓存项
-    bool put(Key key, Value value) 
+    // 在主缓存中 插入/更新缓存项，version为该值的版本号
+    bool put(Key key, Value value, uint64_t version = 0) 
     {
         if (capacity_ == 0) return false;   //主缓存容量若为0 直接返回
         
-        std::lock_guard<std::mutex> lock(mutex_);
-        auto it = mainCache_.find(key);
+        std::lock_guard<KCacheMutex> lock(mutex_);
+        auto it = findLiveMain(key);
         if (it != mainCache_.end()) 
         {
             //如果在主缓存hash表中找到了，说明已经在主缓存里了，执行更新现有节点操作(更新value，移至链表头部)
             //优化：并记录是否达到阈值，只有达到转移阈值时返回true (这在KArcCache.h中的put会用到)
             bool shouldPromote = updateNodeAccess(it->second);
             it->second->setValue(value);
+            it->second->version_ = version;
             return shouldPromote;
         }
         //如果在主缓存hash表中找不到，说明不在主缓存里，执行添加新节点操作
-        return addNewNode(key, value);
+        return addNewNode(key, value, version);
         return false;
     }
 
-    // 在主缓存中 获取缓存项，并将是否转移lfu 通过参数的方式返回
-    bool get(Key key, Value& value, bool& shouldTransform) 
+    // 在主缓存中 获取缓存项，并将是否转移lfu(以及版本号) 通过参数的方式返回
+    bool get(Key key, Value& value, bool& shouldTransform, uint64_t* version = nullptr) 
     {
-        std::lock_guard<std::mutex> lock(mutex_);
-        auto it = mainCache_.find(key);
+        std::lock_guard<KCacheMutex> lock(mutex_);
+        auto it = findLiveMain(key);
         if (it != mainCache_.end()) 
         {   // 命中主缓存
             //更新节点访问状态(移动至链表头部，增加节点访问计数)，并将 是否转移lfu 通过参数的方式返回
             shouldTransform = updateNodeAccess(it->second); 
             value = it->second->getValue(); //获取值
+            if (version)
+                *version = it->second->getVersion();
             return true;
         }
         return false;   //未命中主缓存
@@ -64,7 +73,15 @@ public:
     // 检查幽灵缓存中是否存在键为key的节点
     bool checkGhost(Key key, Value& ghostValue) 
     {
+        std::lock_guard<KCacheMutex> lock(mutex_);
         auto it = ghostCache_.find(key);
+        if (it != ghostCache_.end() && isStale(it->second))
+        {
+            // 清空前的幽灵记录不再参与容量调整
+            removeFromGhost(it->second);
+            ghostCache_.erase(it);
+            return false;
+        }
         if (it != ghostCache_.end()) 
         {
             // 如果存在，就移除，并返回gValue
@@ -77,24 +94,31 @@ public:
     }
 
     //增加主缓存容量
-    void increaseCapacity() { ++capacity_; }
+    void increaseCapacity() 
+    { 
+        std::lock_guard<KCacheMutex> lock(mutex_);
+        ++capacity_; 
+        MYCACHE_TRACE_INSTANT(Resize, "KArcCache.lru", capacity_);
+    }
     
     //减少主缓存容量
     bool decreaseCapacity() 
     {
+        std::lock_guard<KCacheMutex> lock(mutex_);
         if (capacity_ <= 0) return false;
         if (mainCache_.size() == capacity_) 
         {
             evictLeastRecent();
         }
         --capacity_;
+        MYCACHE_TRACE_INSTANT(Resize, "KArcCache.lru", capacity_);
         return true;
     }
 
     // 从主缓存中删除指定元素
     void remove(Key key) 
     {   
-        std::lock_guard<std::mutex> lock(mutex_);
+        std::lock_guard<KCacheMutex> lock(mutex_);
         auto it = mainCache_.find(key);
         if (it != mainCache_.end())
         {
@@ -103,10 +127,93 @@ public:
         }
     }
     
+    // O(1)清空：主缓存和幽灵缓存中的现有节点立即不可见
+    void clear()
+    {
+        std::lock_guard<KCacheMutex> lock(mutex_);
+        generation_.invalidateAll(mainCache_.size() + ghostCache_.size());
+    }
+
+    void setNamespaceFunc(typename KGeneration<Key>::NamespaceFunc func)
+    {
+        std::lock_guard<KCacheMutex> lock(mutex_);
+        generation_.setNamespaceFunc(std::move(func));
+    }
+
+    void invalidateNamespace(uint32_t ns)
+    {
+        std::lock_guard<KCacheMutex> lock(mutex_);
+        generation_.invalidateNamespace(ns, mainCache_.size() + ghostCache_.size());
+    }
+
+    // 回收主缓存中的过期节点(幽灵缓存中的过期节点在被查到或被挤出时回收)
+    size_t sweepStale(size_t maxBuckets = 64)
+    {
+        std::lock_guard<KCacheMutex> lock(mutex_);
+        return sweepStaleLocked(maxBuckets);
+    }
+
+    void setLockName(const std::string& name)
+    {
+        MyCache::setLockName(mutex_, name);
+    }
+
+    // 主缓存的节点被驱逐到幽灵缓存时调用(此后get不再命中)，在锁内执行
+    void setEvictionListener(std::function<void(const Key&, const Value&)> listener)
+    {
+        evictionListener_ = std::move(listener);
+    }
+
+    void collectLockStats(std::vector<KLockStats>& out) const
+    {
+        MyCache::collectLockStats(mutex_, out);
+    }
+
+    // 调整转移阈值
+    void setTransformThreshold(size_t transformThreshold)
+    {
+        std::lock_guard<KCacheMutex> lock(mutex_);
+        transformThreshold_ = transformThreshold;
+    }
+
     // 检查主缓存中是否有键为key的节点
     bool existsInMain(Key key) 
     {
-        return mainCache_.find(key) != mainCache_.end();
+        std::lock_guard<KCacheMutex> lock(mutex_);
+        return findLiveMain(key) != mainCache_.end();
+    }
+
+    // 主缓存的快照：从最久未访问到最近访问(链表头部是最近访问的)
+    void snapshot(std::vector<std::pair<Key, Value>>& entries)
+    {
+        std::lock_guard<KCacheMutex> lock(mutex_);
+        for (NodePtr node = mainTail_->prev_; node != mainHead_; node = node->prev_)
+        {
+            if (!isStale(node))
+                entries.emplace_back(node->key_, node->value_);
+        }
+    }
+
+    // 内存统计：主缓存的key/value计为有效数据；幽灵缓存只用于调整容量，整体计为管理开销
+    KMemoryUsage memoryUsage()
+    {
+        std::lock_guard<KCacheMutex> lock(mutex_);
+        KMemoryUsage usage;
+        usage.entries = mainCache_.size();
+        usage.indexBytes = hashMapBytes(mainCache_);
+        usage.payloadBytes = usage.entries * (sizeof(Key) + sizeof(Value));
+        usage.metadataBytes = nodeMemory_.bytes() - usage.payloadBytes + hashMapBytes(ghostCache_);
+        for (const auto& pair : mainCache_)
+        {
+            usage.indexBytes += heapBytesOf(pair.first);
+            usage.payloadBytes += heapBytesOf(pair.second->key_) + heapBytesOf(pair.second->value_);
+        }
+        for (const auto& pair : ghostCache_)
+        {
+            usage.metadataBytes += heapBytesOf(pair.first)
+                + heapBytesOf(pair.second->key_) + heapBytesOf(pair.second->value_);
+        }
+        return usage;
     }
 
 
@@ -162,6 +269,37 @@ private:
         return node->getAccessCount() >= transformThreshold_;   // 返回是否达到转移LFU的阈值
     }
 
+    bool isStale(const NodePtr& node) const
+    {
+        return generation_.isStale(node->namespace_, node->generation_);
+    }
+
+    // 查找主缓存中未过期的节点，找到过期节点时顺便回收
+    typename NodeMap::iterator findLiveMain(const Key& key)
+    {
+        auto it = mainCache_.find(key);
+        if (it != mainCache_.end() && isStale(it->second))
+        {
+            eraseMain(it);
+            return mainCache_.end();
+        }
+        return it;
+    }
+
+    size_t sweepStaleLocked(size_t maxBuckets)
+    {
+        return generation_.sweep(mainCache_, maxBuckets,
+            [this](const NodePtr& node) { return isStale(node); },
+            [this](const Key& key) { eraseMain(mainCache_.find(key)); });
+    }
+
+    // 从主缓存中直接删除节点(不进入幽灵缓存)
+    void eraseMain(typename NodeMap::iterator it)
+    {
+        removeFromMain(it->second);
+        mainCache_.erase(it);
+    }
+
     // 把节点从主缓存链表中移除 (仅调整指针)
     void removeFromMain(NodePtr node) 
     {
@@ -209,6 +347,9 @@ private:
         NodePtr leastRecent = mainTail_->prev_;
         if (leastRecent == mainHead_)   //如果主缓存链表已经空了，就不操作
             return;
+        MYCACHE_TRACE_INSTANT(Evict, "KArcCache.lru", 1);
+        if (evictionListener_)
+            evictionListener_(leastRecent->getKey(), leastRecent->getValue());
 
         // 从主缓存链表中移除
         removeFromMain(leastRecent);
@@ -225,15 +366,21 @@ private:
     }
 
     // 向主缓存中添加一个新节点
-    bool addNewNode(const Key& key, const Value& value) 
+    bool addNewNode(const Key& key, const Value& value, uint64_t version) 
     {
         //如果主缓存已经满了，就驱逐主缓存中最久未使用的节点
+        if (mainCache_.size() >= capacity_ && generation_.hasStale())
+        {
+            sweepStaleLocked(kEvictSweepBuckets);   // 优先回收过期节点
+        }
         if (mainCache_.size() >= capacity_) 
         {   
             evictLeastRecent(); // 驱逐最近最少访问
         }
 
-        NodePtr newNode = std::make_shared<NodeType>(key, value);
+        NodePtr newNode = std::allocate_shared<NodeType>(KCountingAllocator<NodeType>(&nodeMemory_), key, value,
+            generation_.namespaceOf(key), generation_.current());
+        newNode->version_ = version;
         mainCache_[key] = newNode;  //添加到主缓存hash表
         addToFront(newNode);    //添加到主缓存链表
         return true;
@@ -245,8 +392,12 @@ private:
     size_t capacity_;           // 主缓存容量
     size_t ghostCapacity_;      // 幽灵缓存容量
     size_t transformThreshold_; // 转换门槛值(转移到lfu的访问次数阈值)
-    std::mutex mutex_;          // 互斥锁
+    KCacheMutex mutex_;         // 互斥锁
+    KGeneration<Key> generation_;   // 代数：O(1)清空和命名空间失效
+    std::function<void(const Key&, const Value&)> evictionListener_;    // 淘汰监听，由KArcCache设置
+    static constexpr size_t kEvictSweepBuckets = 8;    // 驱逐前顺带回收过期节点时扫描的桶数
 
+    KMemoryCounter nodeMemory_;    // 节点(含控制块)占用的字节数，主缓存和幽灵缓存的节点都计入
     NodeMap mainCache_;         // 主缓存hash表     key -> ArcNode
     NodeMap ghostCache_;        // 幽灵缓存hash表
 
@@ -0,0 +1,286 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+#include "KICachePolicy.h"
+#include "KLfuCache.h"
+#include "KLruCache.h"
+#include "KArcCache/KArcCache.h"
+
+namespace MyCache
+{
+
+// 爬山法自动调参：参考Caffeine自适应窗口的做法
+// 每个采样窗口结束时比较命中率，变好则沿原方向继续调整，变差则反向；
+// 步长逐窗口衰减，命中率剧烈变化(工作负载切换)时重置步长重新探索
+
+
+// 一次调参决策的记录
+struct KTuneDecision
+{
+    size_t window;      // 第几个采样窗口
+    double hitRate;     // 该窗口的命中率
+    int oldValue;       // 调整前的参数值
+    int newValue;       // 调整后的参数值
+    int step;           // 本次使用的步长(带方向)
+};
+
+// 调参器统计信息
+struct KAutoTuneStats
+{
+    size_t windows = 0;         // 已完成的采样窗口数
+    size_t adjustments = 0;     // 参数实际被修改的次数
+    size_t reversals = 0;       // 调整方向反转的次数
+    size_t restarts = 0;        // 因命中率剧变而重置步长的次数
+    int currentValue = 0;       // 当前参数值
+    double currentStep = 0.0;   // 当前步长(带方向)
+    double lastHitRate = 0.0;   // 最近一个窗口的命中率
+    std::vector<KTuneDecision> history;     // 最近的决策记录
+};
+
+// 可调参数描述
+struct KTuneParam
+{
+    std::function<void(int)> apply;     // 把新参数值写入缓存
+    int initial;        // 初始值
+    int minValue;       // 下界
+    int maxValue;       // 上界
+    int initialStep;    // 初始步长
+    int maxStep;        // 单次调整的最大步长
+};
+
+
+// 爬山调参器(线程安全)
+class KAutoTuner
+{
+public:
+    KAutoTuner(KTuneParam param, size_t sampleSize = 1000, size_t maxHistory = 64)
+        : param_(std::move(param))
+        , sampleSize_(std::max<size_t>(sampleSize, 1))
+        , maxHistory_(maxHistory)
+        , hits_(0)
+        , samples_(0)
+        , value_(std::min(std::max(param_.initial, param_.minValue), param_.maxValue))
+        , step_(std::max(param_.initialStep, 1))
+        , prevHitRate_(-1.0)
+    {
+        stats_.currentValue = value_;
+        stats_.currentStep = step_;
+    }
+
+    // 记录一次访问结果，窗口填满时触发一次调参
+    void recordAccess(bool hit)
+    {
+        if (hit)
+            hits_.fetch_add(1, std::memory_order_relaxed);
+        if (samples_.fetch_add(1, std::memory_order_relaxed) + 1 == sampleSize_)
+            climb();
+    }
+
+    KAutoTuneStats stats() const
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return stats_;
+    }
+
+    int currentValue() const
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return value_;
+    }
+
+private:
+    void climb()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        size_t samples = samples_.exchange(0, std::memory_order_relaxed);
+        size_t hits = hits_.exchange(0, std::memory_order_relaxed);
+        if (samples == 0)
+            return;
+        double hitRate = std::min(1.0, static_cast<double>(hits) / samples);
+
+        if (prevHitRate_ >= 0.0)
+        {
+            double delta = hitRate - prevHitRate_;
+            if (std::fabs(delta) >= kRestartThreshold)
+            {
+                // 命中率剧变，说明负载已切换，恢复初始步长重新探索
+                step_ = (step_ >= 0 ? 1 : -1) * static_cast<double>(std::max(param_.initialStep, 1));
+                ++stats_.restarts;
+            }
+            else
+            {
+                step_ *= kStepDecay;
+            }
+            if (delta < 0)
+            {
+                step_ = -step_;   // 命中率下降，反向调整
+                ++stats_.reversals;
+            }
+        }
+
+        // 步长限制在[1, maxStep]之内
+        double magnitude = std::min<double>(std::max(std::fabs(step_), 1.0), std::max(param_.maxStep, 1));
+        int delta = static_cast<int>(std::lround(magnitude)) * (step_ >= 0 ? 1 : -1);
+        int oldValue = value_;
+        int newValue = std::min(std::max(value_ + delta, param_.minValue), param_.maxValue);
+        if (newValue == oldValue && delta != 0)
+        {
+            // 撞到边界，下个窗口往回走
+            step_ = -step_;
+            ++stats_.reversals;
+        }
+        if (newValue != oldValue)
+        {
+            value_ = newValue;
+            param_.apply(newValue);
+            ++stats_.adjustments;
+        }
+        prevHitRate_ = hitRate;
+
+        ++stats_.windows;
+        stats_.currentValue = value_;
+        stats_.currentStep = step_;
+        stats_.lastHitRate = hitRate;
+        if (maxHistory_ > 0)
+        {
+            if (stats_.history.size() >= maxHistory_)
+                stats_.history.erase(stats_.history.begin());
+            stats_.history.push_back({stats_.windows, hitRate, oldValue, newValue, newValue - oldValue});
+        }
+    }
+
+private:
+    static constexpr double kStepDecay = 0.98;          // 每个窗口步长衰减系数
+    static constexpr double kRestartThreshold = 0.05;   // 命中率变化超过该值则重置步长
+
+    KTuneParam          param_;
+    size_t              sampleSize_;    // 采样窗口大小(访问次数)
+    size_t              maxHistory_;    // 保留的决策记录条数
+    std::atomic<size_t> hits_;          // 当前窗口命中次数
+    std::atomic<size_t> samples_;       // 当前窗口访问次数
+    mutable std::mutex  mutex_;         // 保护以下调参状态
+    int                 value_;         // 当前参数值
+    double              step_;          // 当前步长(带方向)
+    double              prevHitRate_;   // 上一个窗口的命中率(<0表示尚无)
+    KAutoTuneStats      stats_;
+};
+
+
+// 自动调参缓存：包装一个已有缓存(不持有其所有权)，按get的命中情况调整其参数
+template<typename Key, typename Value>
+class KAutoTuneCache : public KICachePolicy<Key, Value>
+{
+public:
+    KAutoTuneCache(KICachePolicy<Key, Value>& cache, KTuneParam param, size_t sampleSize = 1000)
+        : cache_(cache)
+        , tuner_(std::move(param), sampleSize)
+    {}
+
+    void put(Key key, Value value) override
+    {
+        cache_.put(key, value);
+    }
+
+    bool get(Key key, Value& value) override
+    {
+        bool hit = cache_.get(key, value);
+        tuner_.recordAccess(hit);
+        return hit;
+    }
+
+    Value get(Key key) override
+    {
+        Value value{};
+        get(key, value);
+        return value;
+    }
+
+    uint64_t compute(const Key& key, const typename KICachePolicy<Key, Value>::ComputeFunc& func) override
+    {
+        return cache_.compute(key, func);
+    }
+
+    void clear() override
+    {
+        cache_.clear();
+    }
+
+    void setEvictionListener(typename KICachePolicy<Key, Value>::EvictionListener listener) override
+    {
+        cache_.setEvictionListener(std::move(listener));
+    }
+
+    void snapshot(std::vector<std::pair<Key, Value>>& entries) override
+    {
+        cache_.snapshot(entries);
+    }
+
+    // 直接使用被调参缓存的批量加载
+    size_t bulkLoad(const std::vector<std::pair<Key, Value>>& entries) override
+    {
+        return cache_.bulkLoad(entries);
+    }
+
+    KMemoryUsage memoryUsage() override
+    {
+        return cache_.memoryUsage();
+    }
+
+    KAutoTuneStats stats() const { return tuner_.stats(); }
+
+private:
+    KICachePolicy<Key, Value>& cache_;  // 被调参的缓存
+    KAutoTuner tuner_;
+};
+
+
+// 以下为各缓存策略的可调参数，默认上下界为经验值，可按需覆盖
+
+// LRU-k：进入缓存所需的访问次数k
+template<typename Key, typename Value>
+KTuneParam makeLruKParam(KLruKCache<Key, Value>& cache, int minK = 1, int maxK = 8)
+{
+    return {[&cache](int k) { cache.setK(k); }, cache.getK(), minK, maxK, 1, 1};
+}
+
+// LRU-k：历史记录容量
+template<typename Key, typename Value>
+KTuneParam makeLruKHistoryParam(KLruKCache<Key, Value>& cache, int minCapacity, int maxCapacity)
+{
+    int initial = cache.getHistoryCapacity();
+    int step = std::max(1, (maxCapacity - minCapacity) / 20);
+    return {[&cache](int capacity) { cache.setHistoryCapacity(capacity); },
+            initial, minCapacity, maxCapacity, step, step * 4};
+}
+
+// LFU-Aging：最大平均访问次数
+template<typename Key, typename Value>
+KTuneParam makeLfuAgingParam(KLfuAgingCache<Key, Value>& cache, int minNum = 2, int maxNum = 1000)
+{
+    return {[&cache](int num) { cache.setMaxAverageNum(num); },
+            cache.getMaxAverageNum(), minNum, maxNum, 2, 32};
+}
+
+// LFU分片：最大平均访问次数
+template<typename Key, typename Value>
+KTuneParam makeHashLfuParam(KHashLfuCache<Key, Value>& cache, int minNum = 2, int maxNum = 1000)
+{
+    return {[&cache](int num) { cache.setMaxAverageNum(num); },
+            cache.getMaxAverageNum(), minNum, maxNum, 2, 32};
+}
+
+// ARC：lru转lfu的访问次数阈值
+template<typename Key, typename Value>
+KTuneParam makeArcThresholdParam(KArcCache<Key, Value>& cache, int minThreshold = 1, int maxThreshold = 16)
+{
+    return {[&cache](int threshold) { cache.setTransformThreshold(threshold); },
+            static_cast<int>(cache.getTransformThreshold()), minThreshold, maxThreshold, 1, 2};
+}
+
+} // namespace MyCache
@@ -0,0 +1,418 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <numeric>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <unistd.h>
+
+#include "KAppendLog.h"
+#include "KCacheServer.h"
+#include "KHashedKey.h"
+#include "KSocket.h"
+
+namespace MyCache
+{
+
+// 一致性哈希环：每个节点在环上放virtualNodes个虚拟节点，key顺时针找到的第一个虚拟节点即所属节点
+// - 增加/删除一个节点只影响环上与它相邻的区间，约1/n的key换了节点，其余不动
+// - 虚拟节点越多负载越均匀，160个时各节点的key数偏差通常在±15%以内
+class KHashRing
+{
+public:
+    explicit KHashRing(int virtualNodes = 160) : virtualNodes_(virtualNodes) {}
+
+    void addNode(const std::string& node)
+    {
+        if (std::find(nodes_.begin(), nodes_.end(), node) != nodes_.end())
+            return;
+        nodes_.push_back(node);
+        rebuild();
+    }
+
+    void removeNode(const std::string& node)
+    {
+        auto it = std::find(nodes_.begin(), nodes_.end(), node);
+        if (it == nodes_.end())
+            return;
+        nodes_.erase(it);
+        rebuild();
+    }
+
+    const std::vector<std::string>& nodes() const { return nodes_; }
+
+    bool empty() const { return nodes_.empty(); }
+
+    // 返回哈希值所属节点在nodes()中的下标，环为空时不能调用
+    size_t nodeFor(uint64_t hash) const
+    {
+        auto it = std::upper_bound(points_.begin(), points_.end(), std::make_pair(hash, SIZE_MAX));
+        if (it == points_.end())
+            it = points_.begin();   // 绕回环的起点
+        return it->second;
+    }
+
+private:
+    void rebuild()
+    {
+        points_.clear();
+        points_.reserve(nodes_.size() * virtualNodes_);
+        for (size_t i = 0; i < nodes_.size(); ++i)
+        {
+            for (int v = 0; v < virtualNodes_; ++v)
+            {
+                uint64_t hash = mixHash(std::hash<std::string>()(nodes_[i] + "#" + std::to_string(v)));
+                points_.emplace_back(hash, i);
+            }
+        }
+        std::sort(points_.begin(), points_.end());
+    }
+
+private:
+    int                                         virtualNodes_;
+    std::vector<std::string>                    nodes_;
+    std::vector<std::pair<uint64_t, size_t>>    points_;    // (虚拟节点的哈希值, 节点下标)，按哈希值排序
+};
+
+
+struct KCacheClientOptions
+{
+    int                         virtualNodes = 160;     // 每个服务器在哈希环上的虚拟节点数
+    size_t                      batchKeys = 1024;       // 每个请求最多带的key数，更多的key拆成多个请求流水线发送
+    std::chrono::milliseconds   timeout{1000};          // 单次读写的超时
+};
+
+struct KCacheClientStats
+{
+    uint64_t requests = 0;      // 发出的请求数(每个请求可带多个key)
+    uint64_t errors = 0;        // 连接失败或读写出错的次数
+    uint64_t connects = 0;      // 建立连接的次数
+};
+
+
+// 缓存服务器池的客户端：用一致性哈希把key分到各个KCacheServer
+// - 每个服务器一个持久连接，第一次使用时建立，出错后关闭，下次使用时重连
+// - 多key操作按服务器拆分，先把所有服务器的请求都发出去，再依次读响应，各服务器并行处理
+// - 服务器出错时：读当作未命中，写和删除当作没有生效(缓存语义，不重试)
+// - 增删服务器只替换哈希环，已有连接继续复用；可以与读写并发
+template<typename Key, typename Value>
+class KCacheClient
+{
+public:
+    explicit KCacheClient(const std::vector<std::string>& servers,
+                          KCacheClientOptions options = KCacheClientOptions())
+        : options_(options)
+        , nextConnectionId_(0)
+        , requests_(0)
+        , errors_(0)
+        , connects_(0)
+    {
+        auto topology = std::make_shared<Topology>(options_.virtualNodes);
+        for (const auto& server : servers)
+            addTo(*topology, server);
+        topology_ = topology;
+    }
+
+    KCacheClient(const KCacheClient&) = delete;
+    KCacheClient& operator=(const KCacheClient&) = delete;
+
+    void addServer(const std::string& address)
+    {
+        std::lock_guard<std::mutex> lock(topologyMutex_);
+        auto topology = std::make_shared<Topology>(*std::atomic_load(&topology_));
+        addTo(*topology, address);
+        std::atomic_store(&topology_, std::shared_ptr<const Topology>(topology));
+    }
+
+    void removeServer(const std::string& address)
+    {
+        std::lock_guard<std::mutex> lock(topologyMutex_);
+        auto topology = std::make_shared<Topology>(*std::atomic_load(&topology_));
+        auto& nodes = topology->ring.nodes();
+        auto it = std::find(nodes.begin(), nodes.end(), address);
+        if (it == nodes.end())
+            return;
+        topology->connections.erase(topology->connections.begin() + (it - nodes.begin()));
+        topology->ring.removeNode(address);
+        std::atomic_store(&topology_, std::shared_ptr<const Topology>(topology));
+    }
+
+    std::vector<std::string> servers() const
+    {
+        return std::atomic_load(&topology_)->ring.nodes();
+    }
+
+    // key所属的服务器，没有服务器时返回空串
+    std::string serverFor(const Key& key) const
+    {
+        auto topology = std::atomic_load(&topology_);
+        if (topology->ring.empty())
+            return std::string();
+        return topology->ring.nodes()[topology->ring.nodeFor(KHashedKey<Key>(key).hash)];
+    }
+
+    bool get(const Key& key, Value& value)
+    {
+        std::vector<std::pair<Key, Value>> found;
+        if (getMany(std::vector<Key>{key}, found) == 0)
+            return false;
+        value = std::move(found[0].second);
+        return true;
+    }
+
+    void put(const Key& key, const Value& value)
+    {
+        putMany(std::vector<std::pair<Key, Value>>{{key, value}});
+    }
+
+    bool remove(const Key& key)
+    {
+        return removeMany(std::vector<Key>{key}) > 0;
+    }
+
+    // 批量读：命中的条目按keys中的顺序追加到found，返回命中数
+    size_t getMany(const std::vector<Key>& keys, std::vector<std::pair<Key, Value>>& found)
+    {
+        std::vector<std::pair<size_t, Value>> hits;     // 各服务器的响应先按(下标, value)收集
+        execute(KCacheRequestOp::Get, keys.size(),
+            [&](size_t i) -> const Key& { return keys[i]; },
+            [&](size_t i, std::string& out) { KLogCodec<Key>::encode(out, keys[i]); },
+            [&](const std::vector<size_t>& positions, const char*& p, const char* end) {
+                for (size_t i : positions)
+                {
+                    if (p == end)
+                        return false;
+                    if (*p++ == 0)
+                        continue;
+                    hits.emplace_back(i, Value());
+                    if (!KLogCodec<Value>::decode(p, end, hits.back().second))
+                        return false;
+                }
+                return true;
+            });
+        std::sort(hits.begin(), hits.end(), [](const std::pair<size_t, Value>& a, const std::pair<size_t, Value>& b) {
+            return a.first < b.first;
+        });
+        found.reserve(found.size() + hits.size());
+        for (auto& hit : hits)
+            found.emplace_back(keys[hit.first], std::move(hit.second));
+        return hits.size();
+    }
+
+    // 批量写，返回服务器确认写入的条目数
+    size_t putMany(const std::vector<std::pair<Key, Value>>& entries)
+    {
+        return execute(KCacheRequestOp::Put, entries.size(),
+            [&](size_t i) -> const Key& { return entries[i].first; },
+            [&](size_t i, std::string& out) {
+                KLogCodec<Key>::encode(out, entries[i].first);
+                KLogCodec<Value>::encode(out, entries[i].second);
+            },
+            [](const std::vector<size_t>&, const char*&, const char*) { return true; });
+    }
+
+    // 批量删除，返回实际删除的条目数
+    size_t removeMany(const std::vector<Key>& keys)
+    {
+        return execute(KCacheRequestOp::Remove, keys.size(),
+            [&](size_t i) -> const Key& { return keys[i]; },
+            [&](size_t i, std::string& out) { KLogCodec<Key>::encode(out, keys[i]); },
+            [](const std::vector<size_t>&, const char*&, const char*) { return true; });
+    }
+
+    KCacheClientStats stats() const
+    {
+        KCacheClientStats stats;
+        stats.requests = requests_.load();
+        stats.errors = errors_.load();
+        stats.connects = connects_.load();
+        return stats;
+    }
+
+private:
+    // 到一个服务器的连接，同一时间只有一个线程使用(请求和响应必须成对)
+    struct Connection
+    {
+        std::string address;
+        uint64_t    id;         // 多个连接同时加锁时按id升序，避免死锁
+        std::mutex  mutex;
+        int         fd = -1;
+
+        Connection(const std::string& address, uint64_t id) : address(address), id(id) {}
+        ~Connection()
+        {
+            if (fd >= 0)
+                ::close(fd);
+        }
+    };
+
+    // 哈希环和与之一一对应的连接，修改时整体替换
+    struct Topology
+    {
+        KHashRing                                   ring;
+        std::vector<std::shared_ptr<Connection>>    connections;   // 与ring.nodes()下标一致
+
+        explicit Topology(int virtualNodes) : ring(virtualNodes) {}
+    };
+
+    void addTo(Topology& topology, const std::string& address)
+    {
+        const auto& nodes = topology.ring.nodes();
+        if (std::find(nodes.begin(), nodes.end(), address) != nodes.end())
+            return;
+        topology.ring.addNode(address);
+        topology.connections.push_back(std::make_shared<Connection>(address, nextConnectionId_++));
+    }
+
+    // 一个服务器上的一批key
+    struct Batch
+    {
+        Connection*             connection;
+        std::vector<size_t>     positions;      // 这些key在调用方数组中的下标
+        size_t                  requests = 0;   // 成功发出的请求数
+        bool                    failed = false;
+    };
+
+    // 按服务器拆分count个条目，发送请求并读取响应，返回写入/删除请求的响应条目数之和
+    // keyAt(i)返回第i个条目的key，encode(i, out)编码第i个条目，decode(positions, p, end)解析一个Get响应中的条目
+    template<typename KeyAt, typename Encode, typename Decode>
+    size_t execute(KCacheRequestOp op, size_t count, KeyAt&& keyAt, Encode&& encode, Decode&& decode)
+    {
+        auto topology = std::atomic_load(&topology_);
+        if (count == 0 || topology->ring.empty())
+            return 0;
+
+        // 按服务器分组
+        std::vector<Batch> batches;
+        std::vector<int> batchOf(topology->connections.size(), -1);
+        for (size_t i = 0; i < count; ++i)
+        {
+            size_t node = topology->ring.nodeFor(KHashedKey<Key>(keyAt(i)).hash);
+            if (batchOf[node] < 0)
+            {
+                batchOf[node] = static_cast<int>(batches.size());
+                batches.push_back(Batch{topology->connections[node].get(), {}});
+            }
+            batches[batchOf[node]].positions.push_back(i);
+        }
+        std::sort(batches.begin(), batches.end(), [](const Batch& a, const Batch& b) {
+            return a.connection->id < b.connection->id;
+        });
+
+        std::vector<std::unique_lock<std::mutex>> locks;
+        locks.reserve(batches.size());
+        for (auto& batch : batches)
+            locks.emplace_back(batch.connection->mutex);
+
+        // 先把所有请求发出去
+        std::string out;
+        for (auto& batch : batches)
+        {
+            if (!ensureConnected(*batch.connection))
+            {
+                batch.failed = true;
+                continue;
+            }
+            out.clear();
+            for (size_t begin = 0; begin < batch.positions.size(); begin += options_.batchKeys)
+            {
+                size_t end = std::min(batch.positions.size(), begin + options_.batchKeys);
+                size_t start = KCacheFrame::beginFrame(out);
+                out.push_back(static_cast<char>(op));
+                KLogCodec<uint32_t>::encode(out, static_cast<uint32_t>(end - begin));
+                for (size_t j = begin; j < end; ++j)
+                    encode(batch.positions[j], out);
+                KCacheFrame::finishFrame(out, start);
+                ++batch.requests;
+            }
+            if (!KSocket::writeAll(batch.connection->fd, out.data(), out.size()))
+                fail(batch);
+        }
+        requests_ += std::accumulate(batches.begin(), batches.end(), uint64_t(0),
+            [](uint64_t sum, const Batch& batch) { return sum + batch.requests; });
+
+        // 再依次读各服务器的响应
+        size_t total = 0;
+        std::string response;
+        std::vector<size_t> positions;
+        for (auto& batch : batches)
+        {
+            for (size_t r = 0; r < batch.requests && !batch.failed; ++r)
+            {
+                uint32_t size;
+                if (!KSocket::readAll(batch.connection->fd, reinterpret_cast<char*>(&size), 4)
+                    || size > kCacheMaxFrameBytes || size < 4)
+                {
+                    fail(batch);
+                    break;
+                }
+                response.resize(size);
+                if (!KSocket::readAll(batch.connection->fd, &response[0], size))
+                {
+                    fail(batch);
+                    break;
+                }
+                const char* p = response.data();
+                const char* end = p + size;
+                uint32_t entries;
+                KLogCodec<uint32_t>::decode(p, end, entries);
+                size_t begin = r * options_.batchKeys;
+                positions.assign(batch.positions.begin() + begin,
+                    batch.positions.begin() + std::min(batch.positions.size(), begin + options_.batchKeys));
+                if (!decode(positions, p, end) || p != end)
+                {
+                    fail(batch);
+                    break;
+                }
+                if (op != KCacheRequestOp::Get)
+                    total += entries;
+            }
+        }
+        return total;
+    }
+
+    bool ensureConnected(Connection& connection)
+    {
+        if (connection.fd >= 0)
+            return true;
+        connection.fd = KSocket::connect(connection.address);
+        if (connection.fd < 0)
+        {
+            ++errors_;
+            return false;
+        }
+        KSocket::setTimeout(connection.fd, options_.timeout);
+        ++connects_;
+        return true;
+    }
+
+    // 出错后关闭连接(可能还有未读的响应，不能再复用)，下次使用时重连
+    void fail(Batch& batch)
+    {
+        batch.failed = true;
+        ::close(batch.connection->fd);
+        batch.connection->fd = -1;
+        ++errors_;
+    }
+
+private:
+    const KCacheClientOptions       options_;
+    std::mutex                      topologyMutex_;     // 串行化拓扑的修改
+    std::shared_ptr<const Topology> topology_;          // 用std::atomic_load/atomic_store读写
+    uint64_t                        nextConnectionId_;  // 受topologyMutex_保护
+
+    std::atomic<uint64_t>           requests_;
+    std::atomic<uint64_t>           errors_;
+    std::atomic<uint64_t>           connects_;
+};
+
+} // namespace MyCache
@@ -0,0 +1,241 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "KAppendLog.h"
+#include "KICachePolicy.h"
+#include "KSocket.h"
+
+namespace MyCache
+{
+
+// 缓存服务：把一个KICachePolicy通过Unix域套接字或TCP提供给其他进程(客户端见KCacheClient.h)
+// - 每个连接一个线程，请求按到达顺序处理，响应按同样的顺序返回，客户端可以不等响应连续发送多个请求(流水线)
+// - 一次读到的所有完整请求处理完后，响应合并成一次写
+// - 每个请求可以带多个key：批量读、批量写(bulkLoad)、批量删除
+// 使用POSIX套接字接口
+
+
+// 请求：[4字节正文长度][正文：1字节操作 + 4字节条目数 + 条目]
+//   Get/Remove的条目是key，Put的条目是key + value
+// 响应：[4字节正文长度][正文：4字节条目数 + 条目]
+//   Get的条目是1字节是否命中 + value(命中时)，Put/Remove的条目数为写入/删除的个数，没有条目
+// key/value用KLogCodec编码
+enum class KCacheRequestOp : uint8_t
+{
+    Get = 1,
+    Put = 2,
+    Remove = 3,
+};
+
+constexpr uint32_t kCacheMaxFrameBytes = 64 << 20;   // 单个请求/响应的上限，超过视为协议错误
+
+
+// 帧的读写
+struct KCacheFrame
+{
+    // 开始一个帧，返回长度字段的位置，写完正文后调用finishFrame
+    static size_t beginFrame(std::string& out)
+    {
+        size_t start = out.size();
+        out.append(4, '\0');
+        return start;
+    }
+
+    static void finishFrame(std::string& out, size_t start)
+    {
+        uint32_t size = static_cast<uint32_t>(out.size() - start - 4);
+        std::memcpy(&out[start], &size, 4);
+    }
+
+    // 从data中取出一个完整帧的正文，数据不完整返回false；帧过大时frameBytes置为0表示出错
+    static bool nextFrame(const char* data, size_t size, const char*& body, uint32_t& bodySize, size_t& frameBytes)
+    {
+        frameBytes = 0;
+        if (size < 4)
+            return false;
+        std::memcpy(&bodySize, data, 4);
+        if (bodySize > kCacheMaxFrameBytes)
+            return true;
+        if (size - 4 < bodySize)
+            return false;
+        body = data + 4;
+        frameBytes = 4 + bodySize;
+        return true;
+    }
+};
+
+
+template<typename Key, typename Value>
+class KCacheServer
+{
+public:
+    // 监听address，失败抛出std::system_error
+    KCacheServer(KICachePolicy<Key, Value>& cache, const std::string& address)
+        : cache_(cache)
+        , address_(address)
+        , stopping_(false)
+    {
+        listenFd_ = KSocket::listen(address_);
+        acceptor_ = std::thread(&KCacheServer::acceptLoop, this);
+    }
+
+    ~KCacheServer()
+    {
+        stop();
+    }
+
+    KCacheServer(const KCacheServer&) = delete;
+    KCacheServer& operator=(const KCacheServer&) = delete;
+
+    // 停止监听并断开所有连接
+    void stop()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (stopping_)
+                return;
+            stopping_ = true;
+            sessions_.shutdownAll();
+        }
+        ::shutdown(listenFd_, SHUT_RDWR);
+        acceptor_.join();
+        sessions_.closeAll();
+        ::close(listenFd_);
+        KSocket::unlinkAddress(address_);
+    }
+
+private:
+    using Session = KSocketSession;
+
+    void acceptLoop()
+    {
+        sessions_.acceptLoop(listenFd_, mutex_, stopping_, [this](Session* session) {
+            session->thread = std::thread(&KCacheServer::serve, this, session);
+        });
+    }
+
+    void serve(Session* session)
+    {
+        std::string pending;
+        std::string out;
+        char buf[64 * 1024];
+        bool ok = true;
+        while (ok)
+        {
+            ssize_t n = ::recv(session->fd, buf, sizeof(buf), 0);
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n <= 0)
+                break;
+            pending.append(buf, static_cast<size_t>(n));
+
+            size_t consumed = 0;
+            const char* body;
+            uint32_t bodySize;
+            size_t frameBytes;
+            out.clear();
+            while (KCacheFrame::nextFrame(pending.data() + consumed, pending.size() - consumed, body, bodySize, frameBytes))
+            {
+                if (frameBytes == 0 || !handle(body, bodySize, out))
+                {
+                    ok = false;     // 协议错误，断开连接
+                    break;
+                }
+                consumed += frameBytes;
+            }
+            pending.erase(0, consumed);
+            if (!out.empty() && !KSocket::writeAll(session->fd, out.data(), out.size()))
+                break;
+        }
+        ::shutdown(session->fd, SHUT_RDWR);
+        std::lock_guard<std::mutex> lock(mutex_);
+        session->active = false;
+    }
+
+    // 处理一个请求，把响应追加到out，请求格式错误返回false
+    bool handle(const char* p, uint32_t size, std::string& out)
+    {
+        const char* end = p + size;
+        if (size < 5)
+            return false;
+        KCacheRequestOp op = static_cast<KCacheRequestOp>(*p++);
+        uint32_t count;
+        KLogCodec<uint32_t>::decode(p, end, count);
+        if (count > size)
+            return false;   // 每个条目至少一个字节，防止按伪造的条目数分配内存
+
+        size_t start = KCacheFrame::beginFrame(out);
+        switch (op)
+        {
+        case KCacheRequestOp::Get:
+        {
+            KLogCodec<uint32_t>::encode(out, count);
+            Key key{};
+            Value value{};
+            for (uint32_t i = 0; i < count; ++i)
+            {
+                if (!KLogCodec<Key>::decode(p, end, key))
+                    return false;
+                bool found = cache_.get(key, value);
+                out.push_back(static_cast<char>(found));
+                if (found)
+                    KLogCodec<Value>::encode(out, value);
+            }
+            break;
+        }
+        case KCacheRequestOp::Put:
+        {
+            std::vector<std::pair<Key, Value>> entries(count);
+            for (auto& entry : entries)
+            {
+                if (!KLogCodec<Key>::decode(p, end, entry.first) || !KLogCodec<Value>::decode(p, end, entry.second))
+                    return false;
+            }
+            KLogCodec<uint32_t>::encode(out, static_cast<uint32_t>(cache_.bulkLoad(entries)));
+            break;
+        }
+        case KCacheRequestOp::Remove:
+        {
+            uint32_t removed = 0;
+            Key key{};
+            for (uint32_t i = 0; i < count; ++i)
+            {
+                if (!KLogCodec<Key>::decode(p, end, key))
+                    return false;
+                cache_.compute(key, [&](bool present, Value&, uint64_t) {
+                    removed += present;
+                    return present ? KComputeAction::Remove : KComputeAction::Keep;
+                });
+            }
+            KLogCodec<uint32_t>::encode(out, removed);
+            break;
+        }
+        default:
+            return false;
+        }
+        KCacheFrame::finishFrame(out, start);
+        return p == end;
+    }
+
+private:
+    KICachePolicy<Key, Value>&  cache_;
+    const std::string           address_;
+    int                         listenFd_;
+
+    std::mutex                  mutex_;     // 保护会话列表和停止标志
+    KSocketSessions<Session>    sessions_;
+    bool                        stopping_;
+    std::thread                 acceptor_;
+};
+
+} // namespace MyCache
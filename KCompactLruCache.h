@@ -0,0 +1,456 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "KEventTrace.h"
+#include "KICachePolicy.h"
+#include "KLockProfiler.h"
+#include "KMemoryUsage.h"
+
+namespace MyCache
+{
+
+// 紧凑布局的分片LRU缓存，KStringLruCache(KStringKeyCache.h)和KIntLruCache(KIntLruCache.h)的公共部分
+// - 节点连续存放在数组中，LRU链表和空闲链表用32位下标，没有逐个分配的节点和控制块
+// - 索引是线性探测的开放寻址表，每个槽8字节：高32位是哈希指纹，低32位是节点下标+1(0为空槽)
+// - 容量固定，节点数组和索引在构造时按容量分配，之后不会扩容；不支持标签和命名空间失效
+// key怎样存放、比较和哈希由KeyStore决定：
+//   Key/KeyView                  接口上的key类型和查找时使用的key类型
+//   NodeKey                      节点中保存的key部分
+//   ShardKeys                    每个分片共享的key存储(例如arena)，reset()清空
+//   kInlineKeyBytes              节点中计入有效数据的key字节数
+//   hashOf(KeyView)              与KHashedKey<Key>相同的哈希
+//   hashOf(keys, nodeKey)        节点key的哈希(删除槽位时重新定位起始位置)
+//   equals(keys, nodeKey, key, hash)
+//   assign(keys, nodeKey, key, hash) / release(keys, nodeKey)
+//   keyOf(keys, nodeKey)         还原出Key(快照和驱逐通知)
+//   liveKeyBytes(keys) / keyCapacityBytes(keys)
+//   compactIfNeeded(keys, forEachNodeKey)  插入前整理key存储，forEachNodeKey按LRU顺序访问所有节点key
+template<typename KeyStore, typename Value>
+class KCompactLruCache : public KICachePolicy<typename KeyStore::Key, Value>
+{
+public:
+    using Key = typename KeyStore::Key;
+    using KeyView = typename KeyStore::KeyView;
+    using ComputeFunc = typename KICachePolicy<Key, Value>::ComputeFunc;
+
+    // name用于锁名和事件跟踪
+    KCompactLruCache(size_t capacity, int shardNum, const char* name)
+        : name_(name)
+        , shardNum_(shardNum > 0 ? shardNum : std::thread::hardware_concurrency())     // <=0时使用CPU核心数
+    {
+        size_t shardCapacity = std::ceil(capacity / static_cast<double>(shardNum_));
+        for (int i = 0; i < shardNum_; ++i)
+        {
+            shards_.emplace_back(new Shard(shardCapacity));
+            MyCache::setLockName(shards_.back()->mutex, std::string(name_) + "[" + std::to_string(i) + "]");
+        }
+    }
+
+    ~KCompactLruCache() override = default;
+
+    void put(Key key, Value value) override
+    {
+        putView(KeyView(key), std::move(value));
+    }
+
+    bool get(Key key, Value& value) override
+    {
+        return getView(KeyView(key), value);
+    }
+
+    Value get(Key key) override
+    {
+        Value value{};
+        getView(KeyView(key), value);
+        return value;
+    }
+
+    bool remove(KeyView key)
+    {
+        uint64_t hash = KeyStore::hashOf(key);
+        Shard& shard = shardOf(hash);
+        std::lock_guard<KCacheMutex> lock(shard.mutex);
+        uint32_t index = find(shard, key, hash);
+        if (index == kNone)
+            return false;
+        erase(shard, index);
+        return true;
+    }
+
+    uint64_t compute(const Key& key, const ComputeFunc& func) override
+    {
+        return computeView(KeyView(key), func);
+    }
+
+    // 逐个分片清空(O(容量))，保留已分配的数组
+    void clear() override
+    {
+        for (auto& shard : shards_)
+        {
+            std::lock_guard<KCacheMutex> lock(shard->mutex);
+            shard->reset();
+        }
+    }
+
+    // 每个分片从旧到新
+    void snapshot(std::vector<std::pair<Key, Value>>& entries) override
+    {
+        for (auto& shard : shards_)
+        {
+            std::lock_guard<KCacheMutex> lock(shard->mutex);
+            for (uint32_t i = shard->tail; i != kNone; i = shard->nodes[i].prev)
+            {
+                const Node& node = shard->nodes[i];
+                entries.emplace_back(KeyStore::keyOf(shard->keys, node.key), node.value);
+            }
+        }
+    }
+
+    // 按分片分组，每个分片只加一次锁
+    size_t bulkLoad(const std::vector<std::pair<Key, Value>>& entries) override
+    {
+        std::vector<std::vector<size_t>> groups(shardNum_);
+        std::vector<uint64_t> hashes(entries.size());
+        for (size_t i = 0; i < entries.size(); ++i)
+        {
+            hashes[i] = KeyStore::hashOf(KeyView(entries[i].first));
+            groups[shardIndexOf(hashes[i])].push_back(i);
+        }
+        size_t loaded = 0;
+        for (int s = 0; s < shardNum_; ++s)
+        {
+            Shard& shard = *shards_[s];
+            if (groups[s].empty() || shard.capacity == 0)
+                continue;
+            std::lock_guard<KCacheMutex> lock(shard.mutex);
+            for (size_t i : groups[s])
+            {
+                KeyView key(entries[i].first);
+                uint32_t index = find(shard, key, hashes[i]);
+                if (index == kNone)
+                    index = insert(shard, key, hashes[i]);
+                Node& node = shard.nodes[index];
+                node.value = entries[i].second;
+                node.version = ++shard.versionCounter;
+                moveToMostRecent(shard, index);
+                ++loaded;
+            }
+        }
+        return loaded;
+    }
+
+    // 索引为开放寻址表；有效数据为value、节点中的key和key存储中的有效字节；
+    // 管理开销为节点中的其余部分、未使用的节点和key存储中的空闲部分
+    KMemoryUsage memoryUsage() override
+    {
+        KMemoryUsage usage;
+        for (auto& shard : shards_)
+        {
+            std::lock_guard<KCacheMutex> lock(shard->mutex);
+            size_t inlineBytes = shard->count * (KeyStore::kInlineKeyBytes + sizeof(Value));
+            size_t keyBytes = KeyStore::liveKeyBytes(shard->keys);
+            usage.entries += shard->count;
+            usage.indexBytes += shard->slots.capacity() * sizeof(uint64_t);
+            usage.payloadBytes += inlineBytes + keyBytes;
+            usage.metadataBytes += shard->nodes.capacity() * sizeof(Node) - inlineBytes
+                                 + KeyStore::keyCapacityBytes(shard->keys) - keyBytes;
+            for (uint32_t i = shard->head; i != kNone; i = shard->nodes[i].next)
+                usage.payloadBytes += heapBytesOf(shard->nodes[i].value);
+        }
+        return usage;
+    }
+
+    size_t size()
+    {
+        size_t count = 0;
+        for (auto& shard : shards_)
+        {
+            std::lock_guard<KCacheMutex> lock(shard->mutex);
+            count += shard->count;
+        }
+        return count;
+    }
+
+    void collectLockStats(std::vector<KLockStats>& out) const
+    {
+        for (const auto& shard : shards_)
+            MyCache::collectLockStats(shard->mutex, out);
+    }
+
+protected:
+    template<typename V>
+    void putView(KeyView key, V&& value)
+    {
+        uint64_t hash = KeyStore::hashOf(key);
+        Shard& shard = shardOf(hash);
+        if (shard.capacity == 0)
+            return;
+        std::lock_guard<KCacheMutex> lock(shard.mutex);
+        uint32_t index = find(shard, key, hash);
+        if (index == kNone)
+            index = insert(shard, key, hash);
+        Node& node = shard.nodes[index];
+        node.value = std::forward<V>(value);
+        node.version = ++shard.versionCounter;
+        moveToMostRecent(shard, index);
+    }
+
+    bool getView(KeyView key, Value& value)
+    {
+        uint64_t hash = KeyStore::hashOf(key);
+        Shard& shard = shardOf(hash);
+        std::lock_guard<KCacheMutex> lock(shard.mutex);
+        uint32_t index = find(shard, key, hash);
+        if (index == kNone)
+            return false;
+        moveToMostRecent(shard, index);
+        value = shard.nodes[index].value;
+        return true;
+    }
+
+    // 原子读-改-写：在分片锁内只查找一次
+    uint64_t computeView(KeyView key, const ComputeFunc& func)
+    {
+        uint64_t hash = KeyStore::hashOf(key);
+        Shard& shard = shardOf(hash);
+        std::lock_guard<KCacheMutex> lock(shard.mutex);
+        uint32_t index = find(shard, key, hash);
+        if (index != kNone)
+        {
+            Node& node = shard.nodes[index];
+            Value value = node.value;
+            switch (func(true, value, node.version))
+            {
+            case KComputeAction::Keep:
+                moveToMostRecent(shard, index);
+                return node.version;
+            case KComputeAction::Store:
+                node.value = std::move(value);
+                node.version = ++shard.versionCounter;
+                moveToMostRecent(shard, index);
+                return node.version;
+            case KComputeAction::Remove:
+                erase(shard, index);
+                return 0;
+            }
+            return 0;
+        }
+
+        Value value{};
+        if (func(false, value, 0) != KComputeAction::Store || shard.capacity == 0)
+            return 0;
+        index = insert(shard, key, hash);
+        Node& node = shard.nodes[index];
+        node.value = std::move(value);
+        node.version = ++shard.versionCounter;
+        return node.version;
+    }
+
+private:
+    static constexpr uint32_t kNone = UINT32_MAX;
+
+    struct Node
+    {
+        typename KeyStore::NodeKey key;
+        uint32_t prev;          // LRU链表：prev指向更新的节点
+        uint32_t next;          // LRU链表中更旧的节点，或空闲链表中的下一个
+        uint64_t version;
+        Value    value;
+    };
+
+    struct Shard
+    {
+        explicit Shard(size_t capacity)
+            : capacity(capacity)
+        {
+            nodes.reserve(capacity);
+            size_t slotCount = 16;
+            while (slotCount < capacity * 2)   // 负载因子不超过0.5
+                slotCount <<= 1;
+            slots.assign(capacity ? slotCount : 0, 0);
+            reset();
+        }
+
+        void reset()
+        {
+            std::fill(slots.begin(), slots.end(), 0);
+            nodes.clear();
+            keys.reset();
+            head = tail = freeHead = kNone;
+            count = 0;
+        }
+
+        KCacheMutex                     mutex;
+        const size_t                    capacity;
+        std::vector<uint64_t>           slots;      // 指纹<<32 | (节点下标+1)
+        std::vector<Node>               nodes;
+        typename KeyStore::ShardKeys    keys;
+        uint32_t                        head;       // 最近访问
+        uint32_t                        tail;       // 最久未访问
+        uint32_t                        freeHead;
+        size_t                          count;
+        uint64_t                        versionCounter = 0;
+    };
+
+    // 与KHashedKey::shardOf一致：高32位选择分片，低位选择槽位，指纹取高32位
+    size_t shardIndexOf(uint64_t hash) const
+    {
+        return static_cast<size_t>(((hash >> 32) * shardNum_) >> 32);
+    }
+
+    Shard& shardOf(uint64_t hash) { return *shards_[shardIndexOf(hash)]; }
+
+    static uint32_t fingerprintOf(uint64_t hash) { return static_cast<uint32_t>(hash >> 32); }
+
+    // 返回节点下标，不存在返回kNone
+    static uint32_t find(const Shard& shard, KeyView key, uint64_t hash)
+    {
+        if (shard.slots.empty())
+            return kNone;
+        size_t mask = shard.slots.size() - 1;
+        uint32_t fingerprint = fingerprintOf(hash);
+        for (size_t i = hash & mask; shard.slots[i] != 0; i = (i + 1) & mask)
+        {
+            uint64_t slot = shard.slots[i];
+            if (static_cast<uint32_t>(slot >> 32) != fingerprint)
+                continue;
+            uint32_t index = static_cast<uint32_t>(slot) - 1;
+            if (KeyStore::equals(shard.keys, shard.nodes[index].key, key, hash))
+                return index;
+        }
+        return kNone;
+    }
+
+    // 插入一个新节点并挂到链表头(value和版本号由调用方设置)，分片已满时先淘汰最久未访问的节点
+    uint32_t insert(Shard& shard, KeyView key, uint64_t hash)
+    {
+        if (shard.count >= shard.capacity)
+            evict(shard);
+        KeyStore::compactIfNeeded(shard.keys, [&shard](auto&& visit) {
+            for (uint32_t i = shard.head; i != kNone; i = shard.nodes[i].next)
+                visit(shard.nodes[i].key);
+        });
+
+        uint32_t index;
+        if (shard.freeHead != kNone)
+        {
+            index = shard.freeHead;
+            shard.freeHead = shard.nodes[index].next;
+        }
+        else
+        {
+            index = static_cast<uint32_t>(shard.nodes.size());
+            shard.nodes.emplace_back();
+        }
+        Node& node = shard.nodes[index];
+        KeyStore::assign(shard.keys, node.key, key, hash);
+
+        size_t mask = shard.slots.size() - 1;
+        size_t i = hash & mask;
+        while (shard.slots[i] != 0)
+            i = (i + 1) & mask;
+        shard.slots[i] = (static_cast<uint64_t>(fingerprintOf(hash)) << 32) | (index + 1);
+
+        node.prev = kNone;
+        node.next = shard.head;
+        if (shard.head != kNone)
+            shard.nodes[shard.head].prev = index;
+        shard.head = index;
+        if (shard.tail == kNone)
+            shard.tail = index;
+        ++shard.count;
+        return index;
+    }
+
+    void evict(Shard& shard)
+    {
+        uint32_t index = shard.tail;
+        MYCACHE_TRACE_INSTANT(Evict, name_, 1);
+        if (this->hasEvictionListener())
+        {
+            const Node& node = shard.nodes[index];
+            this->notifyEvicted(KeyStore::keyOf(shard.keys, node.key), node.value);
+        }
+        erase(shard, index);
+    }
+
+    // 从索引、LRU链表中删除节点，放回空闲链表
+    void erase(Shard& shard, uint32_t index)
+    {
+        Node& node = shard.nodes[index];
+        eraseSlot(shard, index);
+        unlinkNode(shard, index);
+        KeyStore::release(shard.keys, node.key);
+        node.value = Value();       // 释放value持有的资源
+        node.next = shard.freeHead;
+        shard.freeHead = index;
+        --shard.count;
+    }
+
+    // 线性探测的删除：把后面探测链上的槽前移填补空位(不使用墓碑)
+    void eraseSlot(Shard& shard, uint32_t index)
+    {
+        size_t mask = shard.slots.size() - 1;
+        size_t hole = KeyStore::hashOf(shard.keys, shard.nodes[index].key) & mask;
+        while (static_cast<uint32_t>(shard.slots[hole]) != index + 1)
+            hole = (hole + 1) & mask;
+        for (size_t i = (hole + 1) & mask; shard.slots[i] != 0; i = (i + 1) & mask)
+        {
+            const Node& moved = shard.nodes[static_cast<uint32_t>(shard.slots[i]) - 1];
+            size_t home = KeyStore::hashOf(shard.keys, moved.key) & mask;
+            // home在(hole, i]之间时该槽不能前移到hole
+            bool reachable = hole <= i ? (hole < home && home <= i) : (hole < home || home <= i);
+            if (!reachable)
+            {
+                shard.slots[hole] = shard.slots[i];
+                hole = i;
+            }
+        }
+        shard.slots[hole] = 0;
+    }
+
+    void unlinkNode(Shard& shard, uint32_t index)
+    {
+        Node& node = shard.nodes[index];
+        if (node.prev != kNone)
+            shard.nodes[node.prev].next = node.next;
+        else
+            shard.head = node.next;
+        if (node.next != kNone)
+            shard.nodes[node.next].prev = node.prev;
+        else
+            shard.tail = node.prev;
+        node.prev = node.next = kNone;
+    }
+
+    void moveToMostRecent(Shard& shard, uint32_t index)
+    {
+        if (shard.head == index)
+            return;
+        unlinkNode(shard, index);
+        Node& node = shard.nodes[index];
+        node.next = shard.head;
+        if (shard.head != kNone)
+            shard.nodes[shard.head].prev = index;
+        shard.head = index;
+        if (shard.tail == kNone)
+            shard.tail = index;
+    }
+
+private:
+    const char*                         name_;
+    int                                 shardNum_;
+    std::vector<std::unique_ptr<Shard>> shards_;
+};
+
+} // namespace MyCache
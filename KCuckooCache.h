@@ -0,0 +1,602 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "KHashedKey.h"
+#include "KICachePolicy.h"
+#include "KLockProfiler.h"
+#include "KSeqlockValue.h"
+
+namespace MyCache
+{
+
+// 乐观并发的布谷鸟哈希缓存(参考MemC3)，适合读多写少的场景
+// - 索引为4路组相联的布谷鸟哈希表，每个槽位保存1字节tag和条目指针，每个key有两个候选桶
+// - 读操作不加锁：按桶所在分段的版本号做乐观读，版本号为奇数或读前后不一致则重试
+// - 写操作由一把写锁串行化；插入时在两个候选桶都满的情况下用BFS寻找布谷鸟路径，
+//   沿路径把条目挪到备用桶，挪动期间相关分段的版本号为奇数
+// - 条目的key发布后不再修改。小的可平凡复制value由seqlock保护、就地更新；
+//   其他value更新时替换为新条目，被替换/删除的条目在确认没有读者后才释放(双计数器epoch)
+// - 淘汰采用CLOCK：命中时置位访问标记，写满时时钟指针扫描槽位，淘汰第一个未被标记的条目
+template<typename Key, typename Value>
+class KCuckooCache : public KICachePolicy<Key, Value>
+{
+private:
+    // 条目：key和hash发布后只读，value的并发读写由KValueCell处理
+    struct Entry
+    {
+        Key      key;
+        KValueCell<Value> value;
+        uint64_t hash;
+        uint64_t version;               // 只在写锁内读写
+        std::atomic<uint8_t> referenced;   // CLOCK访问标记
+
+        Entry(const Key& key, const Value& value, uint64_t hash, uint64_t version)
+            : key(key), value(value), hash(hash), version(version), referenced(0)
+        {}
+    };
+
+    struct Slot
+    {
+        std::atomic<uint8_t> tag{0};        // 0表示空槽
+        std::atomic<Entry*>  entry{nullptr};
+    };
+
+    // 读者计数，按线程分散到不同缓存行，避免所有读者争抢同一个计数器
+    struct alignas(64) ReaderSlot
+    {
+        std::atomic<uint64_t> active[2] = {{0}, {0}};   // 按epoch奇偶分别计数
+    };
+
+    // BFS搜索布谷鸟路径时的节点
+    struct PathNode
+    {
+        size_t bucket;
+        int    parent;  // 父节点下标，-1表示起点
+        int    slot;    // 从父节点桶中挪出的槽位
+        int    depth;
+    };
+
+public:
+    static constexpr size_t kSlotsPerBucket = 4;
+
+    explicit KCuckooCache(size_t capacity)
+        : capacity_(capacity)
+        , bucketMask_(bucketCountFor(capacity) - 1)
+        , buckets_((bucketMask_ + 1) * kSlotsPerBucket)
+        , stripes_(kStripeCount)
+        , size_(0)
+        , clockHand_(0)
+        , versionCounter_(0)
+        , epoch_(0)
+    {
+        MyCache::setLockName(mutex_, "KCuckooCache");
+    }
+
+    ~KCuckooCache() override
+    {
+        for (auto& slot : buckets_)
+            delete slot.entry.load(std::memory_order_relaxed);
+        for (Entry* entry : retired_)
+            delete entry;
+    }
+
+    KCuckooCache(const KCuckooCache&) = delete;
+    KCuckooCache& operator=(const KCuckooCache&) = delete;
+
+    void put(Key key, Value value) override
+    {
+        compute(key, [&](bool, Value& current, uint64_t) {
+            current = value;
+            return KComputeAction::Store;
+        });
+    }
+
+    // 无锁读
+    bool get(Key key, Value& value) override
+    {
+        return get(KHashedKey<Key>(key), value);
+    }
+
+    bool get(const KHashedKey<Key>& key, Value& value)
+    {
+        ReadGuard guard(*this);
+        Entry* entry = find(key);
+        if (!entry)
+            return false;
+        if (!entry->referenced.load(std::memory_order_relaxed))
+            entry->referenced.store(1, std::memory_order_relaxed);  // 已置位时不写，避免缓存行来回失效
+        entry->value.load(value);
+        return true;
+    }
+
+    Value get(Key key) override
+    {
+        Value value{};
+        get(key, value);
+        return value;
+    }
+
+    // 写操作在写锁内完成，读者看到的始终是完整的旧值或新值
+    uint64_t compute(const Key& key, const typename KICachePolicy<Key, Value>::ComputeFunc& func) override
+    {
+        KHashedKey<Key> hashedKey(key);
+        std::lock_guard<KCacheMutex> lock(mutex_);
+        Slot* slot = findSlot(hashedKey);
+        if (slot)
+        {
+            Entry* old = slot->entry.load(std::memory_order_relaxed);
+            Value value;
+            old->value.load(value);
+            switch (func(true, value, old->version))
+            {
+            case KComputeAction::Keep:
+                old->referenced.store(1, std::memory_order_relaxed);
+                return old->version;
+            case KComputeAction::Store:
+            {
+                if constexpr (KValueCell<Value>::kInPlace)
+                {
+                    old->value.store(value);
+                    old->version = ++versionCounter_;
+                    old->referenced.store(1, std::memory_order_relaxed);
+                    return old->version;
+                }
+                Entry* entry = new Entry(key, value, hashedKey.hash, ++versionCounter_);
+                entry->referenced.store(1, std::memory_order_relaxed);
+                slot->entry.store(entry);
+                retire(old);
+                return entry->version;
+            }
+            case KComputeAction::Remove:
+                clearSlot(*slot);
+                --size_;
+                retire(old);
+                return 0;
+            }
+            return 0;
+        }
+
+        Value value{};
+        if (func(false, value, 0) != KComputeAction::Store || capacity_ == 0)
+            return 0;
+        Entry* entry = new Entry(key, value, hashedKey.hash, ++versionCounter_);
+        insert(entry);
+        return entry->version;
+    }
+
+    // 删除所有条目(O(n))
+    void clear() override
+    {
+        std::lock_guard<KCacheMutex> lock(mutex_);
+        for (auto& slot : buckets_)
+        {
+            Entry* entry = slot.entry.load(std::memory_order_relaxed);
+            if (!entry)
+                continue;
+            clearSlot(slot);
+            retire(entry);
+        }
+        size_ = 0;
+        reclaim();
+    }
+
+    // 批量加载：条目在锁外创建，整批只加一次写锁
+    size_t bulkLoad(const std::vector<std::pair<Key, Value>>& entries) override
+    {
+        if (capacity_ == 0)
+            return 0;
+        std::vector<Entry*> created;
+        created.reserve(entries.size());
+        for (const auto& entry : entries)
+            created.push_back(new Entry(entry.first, entry.second, KHashedKey<Key>(entry.first).hash, 0));
+
+        std::lock_guard<KCacheMutex> lock(mutex_);
+        for (Entry* entry : created)
+        {
+            Slot* slot = findSlot(KHashedKey<Key>(entry->key, entry->hash));
+            if (!slot)
+            {
+                entry->version = ++versionCounter_;
+                insert(entry);
+                continue;
+            }
+            // 已存在的key：与compute的Store相同
+            Entry* old = slot->entry.load(std::memory_order_relaxed);
+            if constexpr (KValueCell<Value>::kInPlace)
+            {
+                Value value;
+                entry->value.load(value);
+                old->value.store(value);
+                old->version = ++versionCounter_;
+                old->referenced.store(1, std::memory_order_relaxed);
+                delete entry;
+            }
+            else
+            {
+                entry->version = ++versionCounter_;
+                entry->referenced.store(1, std::memory_order_relaxed);
+                slot->entry.store(entry);
+                retire(old);
+            }
+        }
+        return entries.size();
+    }
+
+    // 快照(按槽位顺序，CLOCK没有全局的冷热顺序)
+    void snapshot(std::vector<std::pair<Key, Value>>& entries) override
+    {
+        std::lock_guard<KCacheMutex> lock(mutex_);
+        entries.reserve(entries.size() + size_);
+        for (const auto& slot : buckets_)
+        {
+            Entry* entry = slot.entry.load(std::memory_order_relaxed);
+            if (!entry)
+                continue;
+            Value value;
+            entry->value.load(value);
+            entries.emplace_back(entry->key, value);
+        }
+    }
+
+    size_t size()
+    {
+        std::lock_guard<KCacheMutex> lock(mutex_);
+        return size_;
+    }
+
+    void setLockName(const std::string& name)
+    {
+        MyCache::setLockName(mutex_, name);
+    }
+
+    // 内存统计：槽位数组为索引；条目中除key/value以外的字段、分段版本号、读者计数和待回收条目计为管理开销
+    KMemoryUsage memoryUsage() override
+    {
+        std::lock_guard<KCacheMutex> lock(mutex_);
+        KMemoryUsage usage;
+        usage.entries = size_;
+        usage.indexBytes = buckets_.capacity() * sizeof(Slot);
+        usage.payloadBytes = size_ * (sizeof(Key) + sizeof(Value));
+        usage.metadataBytes = size_ * sizeof(Entry) - usage.payloadBytes
+            + stripes_.capacity() * sizeof(std::atomic<uint64_t>) + sizeof(readerSlots_)
+            + retired_.capacity() * sizeof(Entry*) + path_.capacity() * sizeof(PathNode)
+            + retired_.size() * sizeof(Entry);
+        for (const auto& slot : buckets_)
+        {
+            Entry* entry = slot.entry.load(std::memory_order_relaxed);
+            if (!entry)
+                continue;
+            Value value;
+            entry->value.load(value);
+            usage.payloadBytes += heapBytesOf(entry->key) + heapBytesOf(value);
+        }
+        return usage;
+    }
+
+    // 写锁的竞争统计(读操作不加锁)
+    void collectLockStats(std::vector<KLockStats>& out) const
+    {
+        MyCache::collectLockStats(mutex_, out);
+    }
+
+private:
+    // 读者登记：进入时按当前epoch的奇偶计数，登记后epoch已变化则重新登记，
+    // 保证写者翻转epoch后只需等待旧奇偶的计数归零
+    class ReadGuard
+    {
+    public:
+        explicit ReadGuard(KCuckooCache& cache)
+            : slot_(cache.readerSlots_[readerIndex()])
+        {
+            while (true)
+            {
+                uint64_t epoch = cache.epoch_.load();
+                parity_ = epoch & 1;
+                slot_.active[parity_].fetch_add(1);
+                if (cache.epoch_.load() == epoch)
+                    break;
+                slot_.active[parity_].fetch_sub(1);
+            }
+        }
+
+        ~ReadGuard()
+        {
+            slot_.active[parity_].fetch_sub(1, std::memory_order_release);
+        }
+
+    private:
+        static size_t readerIndex()
+        {
+            static thread_local size_t index = std::hash<std::thread::id>()(std::this_thread::get_id()) % kReaderSlots;
+            return index;
+        }
+
+        ReaderSlot& slot_;
+        size_t parity_;
+    };
+
+    static size_t bucketCountFor(size_t capacity)
+    {
+        // 装载率不超过约85%，桶数取2的幂
+        size_t needed = static_cast<size_t>(capacity / (kSlotsPerBucket * 0.85)) + 1;
+        size_t count = 2;
+        while (count < needed)
+            count <<= 1;
+        return count;
+    }
+
+    static uint8_t tagOf(uint64_t hash)
+    {
+        uint8_t tag = static_cast<uint8_t>(hash >> 56);
+        return tag ? tag : 1;
+    }
+
+    size_t primaryBucket(uint64_t hash) const
+    {
+        return static_cast<size_t>(hash) & bucketMask_;
+    }
+
+    // 备用桶：与tag异或，两次计算互为对方，挪动条目时不需要原始key
+    size_t altBucket(size_t bucket, uint8_t tag) const
+    {
+        return (bucket ^ (static_cast<size_t>(tag) * 0x5bd1e995)) & bucketMask_;
+    }
+
+    std::atomic<uint64_t>& stripeOf(size_t bucket)
+    {
+        return stripes_[bucket & (kStripeCount - 1)];
+    }
+
+    Slot* bucketSlots(size_t bucket)
+    {
+        return &buckets_[bucket * kSlotsPerBucket];
+    }
+
+    // 在一个桶中查找key(读写路径共用)，找到时通过entry返回比对过的条目
+    // (槽位随时可能被写者替换，读者只能使用比对时读到的那个指针)
+    Slot* scanBucket(size_t bucket, uint8_t tag, const KHashedKey<Key>& key, Entry*& entry)
+    {
+        Slot* slots = bucketSlots(bucket);
+        for (size_t i = 0; i < kSlotsPerBucket; ++i)
+        {
+            if (slots[i].tag.load(std::memory_order_acquire) != tag)
+                continue;
+            entry = slots[i].entry.load();
+            if (entry && entry->hash == key.hash && entry->key == key.key)
+                return &slots[i];
+        }
+        entry = nullptr;
+        return nullptr;
+    }
+
+    // 乐观读：两个候选桶所在分段的版本号读前后一致才认为结果有效
+    Entry* find(const KHashedKey<Key>& key)
+    {
+        uint8_t tag = tagOf(key.hash);
+        size_t b1 = primaryBucket(key.hash);
+        size_t b2 = altBucket(b1, tag);
+        auto& s1 = stripeOf(b1);
+        auto& s2 = stripeOf(b2);
+        while (true)
+        {
+            uint64_t v1 = s1.load(std::memory_order_acquire);
+            uint64_t v2 = s2.load(std::memory_order_acquire);
+            if ((v1 | v2) & 1)
+            {
+                std::this_thread::yield();  // 有条目正在挪动
+                continue;
+            }
+            Entry* entry = nullptr;
+            if (!scanBucket(b1, tag, key, entry))
+                scanBucket(b2, tag, key, entry);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (s1.load(std::memory_order_relaxed) == v1 && s2.load(std::memory_order_relaxed) == v2)
+                return entry;
+        }
+    }
+
+    // 写锁内查找(不会有并发的挪动，不需要版本号)
+    Slot* findSlot(const KHashedKey<Key>& key)
+    {
+        uint8_t tag = tagOf(key.hash);
+        size_t b1 = primaryBucket(key.hash);
+        Entry* entry = nullptr;
+        Slot* slot = scanBucket(b1, tag, key, entry);
+        return slot ? slot : scanBucket(altBucket(b1, tag), tag, key, entry);
+    }
+
+    void clearSlot(Slot& slot)
+    {
+        slot.tag.store(0, std::memory_order_release);
+        slot.entry.store(nullptr);
+    }
+
+    void fillSlot(Slot& slot, Entry* entry)
+    {
+        slot.entry.store(entry);
+        slot.tag.store(tagOf(entry->hash), std::memory_order_release);
+    }
+
+    Slot* emptySlot(size_t bucket)
+    {
+        Slot* slots = bucketSlots(bucket);
+        for (size_t i = 0; i < kSlotsPerBucket; ++i)
+        {
+            if (!slots[i].entry.load(std::memory_order_relaxed))
+                return &slots[i];
+        }
+        return nullptr;
+    }
+
+    void insert(Entry* entry)
+    {
+        if (size_ >= capacity_)
+            evictOne();
+
+        uint8_t tag = tagOf(entry->hash);
+        size_t b1 = primaryBucket(entry->hash);
+        size_t b2 = altBucket(b1, tag);
+        Slot* slot = emptySlot(b1);
+        if (!slot)
+            slot = emptySlot(b2);
+        if (!slot)
+            slot = makeRoom(b1, b2);
+        if (!slot)
+        {
+            // 找不到布谷鸟路径：直接淘汰候选桶中的一个条目
+            slot = &bucketSlots(b1)[clockHand_ % kSlotsPerBucket];
+            Entry* victim = slot->entry.load(std::memory_order_relaxed);
+            notifyEntryEvicted(victim);
+            clearSlot(*slot);
+            --size_;
+            retire(victim);
+        }
+        fillSlot(*slot, entry);
+        ++size_;
+    }
+
+    // BFS寻找一条以空槽结尾的布谷鸟路径，并从路径末端开始逐个挪动条目，返回腾出的槽位
+    Slot* makeRoom(size_t b1, size_t b2)
+    {
+        path_.clear();
+        path_.push_back({b1, -1, -1, 0});
+        path_.push_back({b2, -1, -1, 0});
+        for (size_t head = 0; head < path_.size() && path_.size() < kMaxPathNodes; ++head)
+        {
+            PathNode node = path_[head];
+            Slot* slots = bucketSlots(node.bucket);
+            for (size_t i = 0; i < kSlotsPerBucket; ++i)
+            {
+                Entry* entry = slots[i].entry.load(std::memory_order_relaxed);
+                size_t alt = altBucket(node.bucket, tagOf(entry->hash));
+                if (emptySlot(alt))
+                {
+                    path_.push_back({alt, static_cast<int>(head), static_cast<int>(i), node.depth + 1});
+                    return applyPath(path_.size() - 1);
+                }
+                if (node.depth + 1 < kMaxPathDepth)
+                    path_.push_back({alt, static_cast<int>(head), static_cast<int>(i), node.depth + 1});
+            }
+        }
+        return nullptr;
+    }
+
+    Slot* applyPath(size_t last)
+    {
+        Slot* hole = emptySlot(path_[last].bucket);
+        for (size_t index = last; path_[index].parent >= 0; index = path_[index].parent)
+        {
+            const PathNode& node = path_[index];
+            size_t from = path_[node.parent].bucket;
+            Slot& source = bucketSlots(from)[node.slot];
+            // 路径中同一个桶出现两次时，前面的挪动可能已改变该槽位，此时放弃(已完成的挪动仍然有效)
+            Entry* entry = source.entry.load(std::memory_order_relaxed);
+            if (!hole || !entry || altBucket(from, tagOf(entry->hash)) != node.bucket)
+                return nullptr;
+            moveEntry(source, *hole, from, node.bucket);
+            hole = &source;
+        }
+        return hole;
+    }
+
+    // 挪动条目期间把两个桶所在分段的版本号置为奇数，读者会重试
+    void moveEntry(Slot& from, Slot& to, size_t fromBucket, size_t toBucket)
+    {
+        auto& s1 = stripeOf(fromBucket);
+        auto& s2 = stripeOf(toBucket);
+        s1.fetch_add(1);
+        if (&s2 != &s1)
+            s2.fetch_add(1);
+        fillSlot(to, from.entry.load(std::memory_order_relaxed));
+        clearSlot(from);
+        s1.fetch_add(1);
+        if (&s2 != &s1)
+            s2.fetch_add(1);
+    }
+
+    // CLOCK淘汰：清除途经条目的访问标记，淘汰第一个未被标记的条目
+    void evictOne()
+    {
+        size_t slotCount = buckets_.size();
+        for (size_t step = 0; step < slotCount * 2; ++step)
+        {
+            Slot& slot = buckets_[clockHand_];
+            clockHand_ = (clockHand_ + 1) % slotCount;
+            Entry* entry = slot.entry.load(std::memory_order_relaxed);
+            if (!entry)
+                continue;
+            if (entry->referenced.load(std::memory_order_relaxed))
+            {
+                entry->referenced.store(0, std::memory_order_relaxed);
+                continue;
+            }
+            MYCACHE_TRACE_INSTANT(Evict, "KCuckooCache", 1);
+            notifyEntryEvicted(entry);
+            clearSlot(slot);
+            --size_;
+            retire(entry);
+            return;
+        }
+    }
+
+    void notifyEntryEvicted(Entry* entry)
+    {
+        if (!this->hasEvictionListener())
+            return;
+        Value value;
+        entry->value.load(value);
+        this->notifyEvicted(entry->key, value);
+    }
+
+    // 被摘下的条目攒够一批后统一回收
+    void retire(Entry* entry)
+    {
+        retired_.push_back(entry);
+        if (retired_.size() >= kReclaimBatch)
+            reclaim();
+    }
+
+    // 翻转epoch并等待旧奇偶的读者全部退出：之后不可能再有读者持有翻转前摘下的条目
+    void reclaim()
+    {
+        uint64_t oldParity = epoch_.fetch_add(1) & 1;
+        for (auto& slot : readerSlots_)
+        {
+            while (slot.active[oldParity].load() != 0)
+                std::this_thread::yield();
+        }
+        for (Entry* entry : retired_)
+            delete entry;
+        retired_.clear();
+    }
+
+private:
+    static constexpr size_t kStripeCount = 1024;    // 版本号分段数
+    static constexpr size_t kReaderSlots = 64;      // 读者计数分散的槽数
+    static constexpr size_t kReclaimBatch = 128;    // 攒够多少个待回收条目触发一次回收
+    static constexpr int    kMaxPathDepth = 5;      // 布谷鸟路径最大长度
+    static constexpr size_t kMaxPathNodes = 512;    // BFS最多访问的节点数
+
+    size_t              capacity_;
+    size_t              bucketMask_;    // 桶数-1
+    std::vector<Slot>   buckets_;       // 桶数*4个槽位
+    std::vector<std::atomic<uint64_t>> stripes_;    // 分段版本号
+    ReaderSlot          readerSlots_[kReaderSlots];
+    KCacheMutex         mutex_;         // 写锁
+    size_t              size_;          // 以下成员只在写锁内访问
+    size_t              clockHand_;
+    uint64_t            versionCounter_;
+    std::vector<Entry*> retired_;       // 待回收的条目
+    std::vector<PathNode> path_;        // BFS工作区
+    std::atomic<uint64_t> epoch_;
+};
+
+} // namespace MyCache
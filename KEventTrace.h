@@ -0,0 +1,280 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <thread>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+namespace MyCache
+{
+
+// 事件追踪
+// 定义 MYCACHE_EVENT_TRACING 后，缓存在锁等待、驱逐、降频(aging)、扩缩容、加载、刷新等位置
+// 记录带TSC时间戳的二进制事件。每个线程写自己的环形缓冲区：记录路径不加锁、不分配内存，
+// 缓冲区写满后覆盖最旧的事件。需要时调用KEventTracer::dumpChromeTrace导出为
+// Chrome trace / Perfetto 可以打开的JSON
+// 未定义时 MYCACHE_TRACE_* 宏展开为空
+
+
+// 事件类型
+enum class KTraceEvent : uint8_t
+{
+    LockWait,       // 等待锁(持续事件)
+    Evict,          // 驱逐一个节点
+    Aging,          // 一次全量降频(持续事件)
+    Resize,         // 容量/索引大小变化
+    Load,           // 从外部加载数据(持续事件)
+    Refresh,        // 刷新数据(持续事件)
+};
+
+inline const char* traceEventName(KTraceEvent type)
+{
+    switch (type)
+    {
+    case KTraceEvent::LockWait: return "lock_wait";
+    case KTraceEvent::Evict:    return "evict";
+    case KTraceEvent::Aging:    return "aging";
+    case KTraceEvent::Resize:   return "resize";
+    case KTraceEvent::Load:     return "load";
+    case KTraceEvent::Refresh:  return "refresh";
+    }
+    return "unknown";
+}
+
+// 一条事件记录(32字节)
+struct KTraceRecord
+{
+    uint64_t    start;      // 开始时间(TSC)
+    uint64_t    duration;   // 持续时间(TSC)，瞬时事件为0
+    uint64_t    arg;        // 附加参数(如被驱逐节点数、新容量)
+    const char* source;     // 事件来源(静态字符串，如锁名/缓存名)
+    KTraceEvent type;
+};
+
+
+// 读取时间戳计数器，非x86平台退化为steady_clock
+inline uint64_t readTsc()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+
+// 单线程的事件环形缓冲区，只有所属线程写入
+// 导出线程可能与写入并发：记录按8字节拆成原子字做relaxed读写(同KSeqlockValue)，
+// 导出复制完后重新读head_，丢弃复制期间可能被覆盖的槽位
+class KTraceRing
+{
+public:
+    static constexpr size_t kCapacity = 1 << 14;    // 每线程保留最近16384条事件
+
+    explicit KTraceRing(uint32_t threadId)
+        : threadId_(threadId)
+        , head_(0)
+    {}
+
+    void record(KTraceEvent type, const char* source, uint64_t start, uint64_t duration, uint64_t arg)
+    {
+        uint64_t head = head_.load(std::memory_order_relaxed);
+        KTraceRecord record{start, duration, arg, source, type};
+        uint64_t buf[kWords] = {};
+        std::memcpy(buf, &record, sizeof(KTraceRecord));
+        // 上一次写入发布的head_先于槽位的改写可见：导出线程读到新数据时，重新读head_一定不小于head
+        std::atomic_thread_fence(std::memory_order_release);
+        auto& slot = slots_[head & (kCapacity - 1)];
+        for (size_t i = 0; i < kWords; ++i)
+            slot[i].store(buf[i], std::memory_order_relaxed);
+        head_.store(head + 1, std::memory_order_release);
+    }
+
+    // 导出时的快照：与写入并发时，最旧的少量事件可能已被覆盖，导出时跳过
+    void snapshot(std::vector<KTraceRecord>& out) const
+    {
+        uint64_t head = head_.load(std::memory_order_acquire);
+        uint64_t begin = head > kCapacity ? head - kCapacity : 0;
+        size_t first = out.size();
+        uint64_t buf[kWords];
+        for (uint64_t i = begin; i < head; ++i)
+        {
+            const auto& slot = slots_[i & (kCapacity - 1)];
+            for (size_t w = 0; w < kWords; ++w)
+                buf[w] = slot[w].load(std::memory_order_relaxed);
+            KTraceRecord record;
+            std::memcpy(&record, buf, sizeof(KTraceRecord));
+            out.push_back(record);
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        // 写入线程此时可能正在写第newHead条，它与第newHead-kCapacity条共用槽位，
+        // 所以只保留序号大于newHead-kCapacity的事件
+        uint64_t newHead = head_.load(std::memory_order_relaxed);
+        if (newHead + 1 > begin + kCapacity)
+        {
+            size_t overwritten = static_cast<size_t>(std::min<uint64_t>(newHead + 1 - kCapacity - begin, head - begin));
+            out.erase(out.begin() + first, out.begin() + first + overwritten);
+        }
+    }
+
+    uint32_t threadId() const { return threadId_; }
+
+private:
+    static constexpr size_t kWords = (sizeof(KTraceRecord) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+
+    uint32_t                threadId_;
+    std::atomic<uint64_t>   head_;      // 已写入的事件总数
+    std::array<std::array<std::atomic<uint64_t>, kWords>, kCapacity> slots_;
+};
+
+
+// 全局追踪器：管理各线程的环形缓冲区并负责导出
+class KEventTracer
+{
+public:
+    static KEventTracer& instance()
+    {
+        static KEventTracer tracer;
+        return tracer;
+    }
+
+    void setEnabled(bool enabled) { enabled_.store(enabled, std::memory_order_relaxed); }
+    bool enabled() const { return enabled_.load(std::memory_order_relaxed); }
+
+    // 记录一个事件。线程第一次记录时创建并登记自己的缓冲区(仅此一次加锁和分配)
+    void record(KTraceEvent type, const char* source, uint64_t start, uint64_t duration, uint64_t arg = 0)
+    {
+        if (!enabled())
+            return;
+        thread_local KTraceRing* ring = registerThread();
+        ring->record(type, source, start, duration, arg);
+    }
+
+    // 导出为Chrome trace JSON(chrome://tracing 或 ui.perfetto.dev 打开)
+    void dumpChromeTrace(std::ostream& os) const
+    {
+        double ticksPerUs = ticksPerMicrosecond();
+        std::vector<std::shared_ptr<KTraceRing>> rings;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            rings = rings_;
+        }
+
+        os << "{\"traceEvents\":[";
+        bool first = true;
+        std::vector<KTraceRecord> records;
+        for (const auto& ring : rings)
+        {
+            records.clear();
+            ring->snapshot(records);
+            for (const auto& r : records)
+            {
+                os << (first ? "" : ",") << "\n{\"name\":\"" << traceEventName(r.type)
+                   << "\",\"cat\":\"" << (r.source ? r.source : "cache")
+                   << "\",\"ph\":\"" << (r.duration ? "X" : "i")
+                   << "\",\"ts\":" << (r.start - baseTsc_) / ticksPerUs;
+                if (r.duration)
+                    os << ",\"dur\":" << r.duration / ticksPerUs;
+                else
+                    os << ",\"s\":\"t\"";
+                os << ",\"pid\":1,\"tid\":" << ring->threadId()
+                   << ",\"args\":{\"arg\":" << r.arg << "}}";
+                first = false;
+            }
+        }
+        os << "\n],\"displayTimeUnit\":\"ns\"}\n";
+    }
+
+private:
+    KEventTracer()
+        : enabled_(true)
+        , nextThreadId_(1)
+        , baseTsc_(readTsc())
+        , baseTime_(std::chrono::steady_clock::now())
+    {}
+
+    KTraceRing* registerThread()
+    {
+        auto ring = std::make_shared<KTraceRing>(nextThreadId_.fetch_add(1));
+        std::lock_guard<std::mutex> lock(mutex_);
+        rings_.push_back(ring);     // 线程退出后缓冲区保留，仍可导出
+        return ring.get();
+    }
+
+    // 用追踪开始以来经过的时间估算TSC频率
+    double ticksPerMicrosecond() const
+    {
+#if defined(__x86_64__) || defined(__i386__)
+        auto elapsedUs = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - baseTime_).count();
+        uint64_t ticks = readTsc() - baseTsc_;
+        if (elapsedUs <= 0 || ticks == 0)
+            return 1000.0;
+        return static_cast<double>(ticks) / elapsedUs;
+#else
+        return 1000.0;  // 退化为纳秒计时
+#endif
+    }
+
+private:
+    std::atomic<bool>       enabled_;
+    std::atomic<uint32_t>   nextThreadId_;
+    uint64_t                baseTsc_;
+    std::chrono::steady_clock::time_point baseTime_;
+    mutable std::mutex      mutex_;     // 只保护rings_的登记和导出
+    std::vector<std::shared_ptr<KTraceRing>> rings_;
+};
+
+
+// 持续事件的作用域计时器
+class KTraceScope
+{
+public:
+    KTraceScope(KTraceEvent type, const char* source, uint64_t arg = 0)
+        : type_(type), source_(source), arg_(arg), start_(readTsc())
+    {}
+
+    ~KTraceScope()
+    {
+        KEventTracer::instance().record(type_, source_, start_, readTsc() - start_, arg_);
+    }
+
+private:
+    KTraceEvent type_;
+    const char* source_;
+    uint64_t    arg_;
+    uint64_t    start_;
+};
+
+
+#ifdef MYCACHE_EVENT_TRACING
+#define MYCACHE_TRACE_CONCAT_INNER(a, b) a##b
+#define MYCACHE_TRACE_CONCAT(a, b) MYCACHE_TRACE_CONCAT_INNER(a, b)
+// 记录从当前位置到作用域结束的持续事件
+#define MYCACHE_TRACE_SCOPE(type, source, arg) \
+    ::MyCache::KTraceScope MYCACHE_TRACE_CONCAT(mycacheTraceScope_, __LINE__)(::MyCache::KTraceEvent::type, source, arg)
+// 记录瞬时事件
+#define MYCACHE_TRACE_INSTANT(type, source, arg) \
+    ::MyCache::KEventTracer::instance().record(::MyCache::KTraceEvent::type, source, ::MyCache::readTsc(), 0, arg)
+// 记录已知起止时间的持续事件
+#define MYCACHE_TRACE_SPAN(type, source, start, duration, arg) \
+    ::MyCache::KEventTracer::instance().record(::MyCache::KTraceEvent::type, source, start, duration, arg)
+#else
+#define MYCACHE_TRACE_SCOPE(type, source, arg) ((void)0)
+#define MYCACHE_TRACE_INSTANT(type, source, arg) ((void)0)
+#define MYCACHE_TRACE_SPAN(type, source, start, duration, arg) ((void)0)
+#endif
+
+} // namespace MyCache
@@ -0,0 +1,160 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+#include "KHashedKey.h"
+
+namespace MyCache
+{
+
+// 代数(generation)管理：实现O(1)清空和按命名空间失效
+// 每个节点插入时记录当前代数和所属命名空间，清空/失效只需把代数下限抬高，
+// 低于下限的节点立即对查询不可见(视为未命中)，实际的回收在查询命中过期节点、
+// 驱逐或sweep时惰性完成。由缓存在自己的锁内使用(本类不加锁)
+template<typename Key>
+class KGeneration
+{
+public:
+    using NamespaceFunc = std::function<uint32_t(const Key&)>;   // key -> 命名空间
+
+    KGeneration()
+        : current_(0)
+        , clearFloor_(0)
+        , staleHint_(false)
+        , cursor_(0)
+        , sweptBuckets_(0)
+        , sweepBucketCount_(0)
+    {}
+
+    // 新节点应记录的代数
+    uint64_t current() const { return current_; }
+
+    // 设置key到命名空间的映射，未设置时所有key都属于命名空间0
+    void setNamespaceFunc(NamespaceFunc func) { namespaceFunc_ = std::move(func); }
+
+    uint32_t namespaceOf(const Key& key) const
+    {
+        return namespaceFunc_ ? namespaceFunc_(key) : 0;
+    }
+
+    // 节点是否已被清空或所在命名空间已失效
+    bool isStale(uint32_t ns, uint64_t gen) const
+    {
+        if (gen < clearFloor_)
+            return true;
+        if (namespaceFloors_.empty())
+            return false;
+        auto it = namespaceFloors_.find(ns);
+        return it != namespaceFloors_.end() && gen < it->second;
+    }
+
+    // 使所有现有节点失效，nodeCount为当前节点数(为0时无需回收)
+    void invalidateAll(size_t nodeCount)
+    {
+        clearFloor_ = ++current_;
+        namespaceFloors_.clear();   // 已被整体下限覆盖
+        markStale(nodeCount);
+    }
+
+    // 使某个命名空间的现有节点失效
+    void invalidateNamespace(uint32_t ns, size_t nodeCount)
+    {
+        namespaceFloors_[ns] = ++current_;
+        markStale(nodeCount);
+    }
+
+    // 是否可能还有未回收的过期节点
+    bool hasStale() const { return staleHint_; }
+
+    // 从上次的位置继续扫描最多maxBuckets个哈希桶，回收其中的过期节点，返回回收数量
+    // staleNode(节点) 判断节点是否过期，eraseKey(key) 由缓存负责把节点从各结构中删除
+    // 自最近一次失效起完整扫描过一轮所有桶后，说明过期节点已全部回收
+    // 渐进式rehash的表(KIncrementalHashMap)在扫描期间暂停迁移，否则eraseKey中的查找/删除可能完成迁移、改变桶数
+    template<typename Map, typename StaleFunc, typename EraseFunc>
+    size_t sweep(Map& map, size_t maxBuckets, StaleFunc staleNode, EraseFunc eraseKey)
+    {
+        if (!staleHint_)
+            return 0;
+
+        struct RehashPause
+        {
+            Map& map;
+            explicit RehashPause(Map& m) : map(m) { pauseRehash(map, true, 0); }
+            ~RehashPause() { pauseRehash(map, false, 0); }
+        } pause(map);
+
+        size_t reclaimed = 0;
+        for (size_t i = 0; i < maxBuckets && staleHint_; ++i)
+        {
+            // 每个桶都重新读取桶数：期间发生过rehash则重新开始一轮
+            size_t bucketCount = map.bucket_count();
+            if (bucketCount == 0)
+            {
+                staleHint_ = false;
+                break;
+            }
+            if (bucketCount != sweepBucketCount_)
+            {
+                sweepBucketCount_ = bucketCount;
+                sweptBuckets_ = 0;
+            }
+
+            size_t bucket = cursor_ % bucketCount;
+            cursor_ = bucket + 1;
+            for (auto it = map.begin(bucket); it != map.end(bucket); ++it)
+            {
+                if (staleNode(it->second))
+                    staleKeys_.push_back(unwrapKey(it->first));
+            }
+            for (const auto& key : staleKeys_)
+            {
+                eraseKey(key);
+                ++reclaimed;
+            }
+            staleKeys_.clear();
+
+            if (++sweptBuckets_ >= bucketCount)
+            {
+                staleHint_ = false;
+                sweptBuckets_ = 0;
+            }
+        }
+        return reclaimed;
+    }
+
+private:
+    // 支持暂停迁移的表才调用pauseRehash，std::unordered_map删除时不会rehash
+    template<typename Map>
+    static auto pauseRehash(Map& map, bool paused, int) -> decltype(map.pauseRehash(paused))
+    {
+        return map.pauseRehash(paused);
+    }
+
+    template<typename Map>
+    static void pauseRehash(Map&, bool, long) {}
+
+    void markStale(size_t nodeCount)
+    {
+        if (nodeCount == 0)
+            return;
+        staleHint_ = true;
+        sweptBuckets_ = 0;
+    }
+
+private:
+    uint64_t        current_;           // 当前代数，每次失效+1
+    uint64_t        clearFloor_;        // 全局代数下限(clear时抬高)
+    std::unordered_map<uint32_t, uint64_t> namespaceFloors_;   // 命名空间 -> 代数下限
+    NamespaceFunc   namespaceFunc_;
+
+    bool            staleHint_;         // 可能存在未回收的过期节点
+    size_t          cursor_;            // 下一个要扫描的桶
+    size_t          sweptBuckets_;      // 本轮已扫描的桶数
+    size_t          sweepBucketCount_;  // 本轮开始时的桶数
+    std::vector<Key> staleKeys_;        // 扫描时暂存过期key
+};
+
+} // namespace MyCache
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+namespace MyCache
+{
+
+// 预先计算哈希值的key
+// 分片缓存在路由时算一次哈希，之后分片内的哈希表直接使用携带的哈希值，不再对key重新哈希；
+// 哈希值的高位用于选择分片，整体取模用于选择哈希桶，两者互不相关
+
+
+// 64位混合函数(MurmurHash3的fmix64)，std::hash<int>等恒等哈希经过混合后高位也足够均匀
+inline uint64_t mixHash(uint64_t h)
+{
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+template<typename Key>
+struct KHashedKey
+{
+    Key      key;
+    uint64_t hash;      // 混合后的64位哈希值
+
+    KHashedKey() : key(), hash(0) {}
+    explicit KHashedKey(const Key& key)
+        : key(key)
+        , hash(mixHash(static_cast<uint64_t>(std::hash<Key>()(key))))
+    {}
+    // 调用方已算好哈希值(必须与上面的计算方式一致)
+    KHashedKey(const Key& key, uint64_t hash) : key(key), hash(hash) {}
+
+    bool operator==(const KHashedKey& other) const
+    {
+        return hash == other.hash && key == other.key;
+    }
+
+    // 用哈希值的高32位选择分片(乘法取范围，不需要取模)
+    size_t shardOf(size_t shardCount) const
+    {
+        return static_cast<size_t>(((hash >> 32) * shardCount) >> 32);
+    }
+};
+
+// 哈希表使用的哈希函数：直接返回携带的哈希值
+template<typename Key>
+struct KHashedKeyHasher
+{
+    size_t operator()(const KHashedKey<Key>& key) const noexcept
+    {
+        return static_cast<size_t>(key.hash);
+    }
+};
+
+// 取出原始key，使KGeneration等工具对普通key和KHashedKey都适用
+template<typename Key>
+const Key& unwrapKey(const Key& key) { return key; }
+
+template<typename Key>
+const Key& unwrapKey(const KHashedKey<Key>& key) { return key.key; }
+
+} // namespace MyCache
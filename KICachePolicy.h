@@ -1,12 +1,34 @@
 #pragma once
 
+#include <cstdint>
+#include <functional>
+#include <utility>
+#include <vector>
+
+#include "KMemoryUsage.h"
+
 namespace MyCache
 {
 
+// compute回调的返回值：决定对该key执行的操作
+enum class KComputeAction
+{
+    Keep,       // 保持原样(已存在则视为一次访问，不存在则不插入)
+    Store,      // 写入回调修改后的value(版本号更新)
+    Remove,     // 删除该key
+};
+
 template <typename Key, typename Value>
 class KICachePolicy
 {
 public:
+    // compute回调：present表示key是否存在；value存在时为当前值的副本，不存在时为默认值，
+    // 回调可修改它并返回Store写回；version为当前版本号，不存在时为0
+    using ComputeFunc = std::function<KComputeAction(bool present, Value& value, uint64_t version)>;
+
+    // 淘汰监听：条目因容量不足被淘汰时调用，删除、覆盖、清空和过期回收不调用
+    using EvictionListener = std::function<void(const Key& key, const Value& value)>;
+
     virtual ~KICachePolicy() {};
 
     // 添加缓存接口
@@ -17,6 +39,128 @@ public:
     // 如果缓存中能找到key，则直接返回value
     virtual Value get(Key key) = 0;
 
+    // 清空缓存：之前的数据立即不可见，节点可延迟回收
+    virtual void clear() = 0;
+
+    // 原子读-改-写原语：在一个临界区内只查找一次key，调用func并按其返回值保留/写入/删除
+    // 返回操作后该key的版本号(不存在为0)。func在缓存锁内执行，不能再访问同一个缓存
+    virtual uint64_t compute(const Key& key, const ComputeFunc& func) = 0;
+
+    // 内存占用统计：索引/管理开销/有效数据各占多少字节(遍历所有条目，O(n)，用于容量规划)
+    virtual KMemoryUsage memoryUsage() = 0;
+
+    // 快照：把所有有效条目追加到entries，按从旧到新(或从冷到热)的顺序，可直接用于bulkLoad
+    // 没有全局访问顺序的缓存(CLOCK、组相联等)只能尽力而为，按存储位置的顺序返回
+    // 持锁复制(分片缓存逐个分片加锁)，O(n)
+    virtual void snapshot(std::vector<std::pair<Key, Value>>& entries) = 0;
+
+    // 批量加载(从快照恢复、预热)：按顺序写入，靠后的条目视为较新的访问，返回写入的条目数
+    // 默认逐个put；基于链表/哈希表的缓存会重写为锁外创建节点、整批只加一次锁，装得下时不触发淘汰
+    virtual size_t bulkLoad(const std::vector<std::pair<Key, Value>>& entries)
+    {
+        for (const auto& entry : entries)
+        {
+            put(entry.first, entry.second);
+        }
+        return entries.size();
+    }
+
+    // 设置淘汰监听(如多级缓存把L1淘汰的条目降级到L2)，应在并发访问之前设置
+    // listener在缓存锁内执行，不能再访问同一个缓存；组合缓存和分片缓存重写为转发给内部的缓存
+    virtual void setEvictionListener(EvictionListener listener)
+    {
+        evictionListener_ = std::move(listener);
+    }
+
+    // 以下操作都由compute实现，保证原子性
+
+    // key不存在时用loader生成value并写入，返回最终的value
+    Value computeIfAbsent(const Key& key, const std::function<Value(const Key&)>& loader)
+    {
+        Value result{};
+        compute(key, [&](bool present, Value& value, uint64_t) {
+            if (!present)
+                value = loader(key);
+            result = value;
+            return present ? KComputeAction::Keep : KComputeAction::Store;
+        });
+        return result;
+    }
+
+    // 用remap修改value(不存在时传入默认值)，remap返回false则删除该key，返回操作后key是否存在
+    bool computeValue(const Key& key, const std::function<bool(bool present, Value& value)>& remap)
+    {
+        return compute(key, [&](bool present, Value& value, uint64_t) {
+            return remap(present, value) ? KComputeAction::Store : KComputeAction::Remove;
+        }) != 0;
+    }
+
+    // 不存在时写入value，存在时写入fn(旧值, value)，返回写入后的值(如计数器累加)
+    Value merge(const Key& key, const Value& value, const std::function<Value(const Value&, const Value&)>& fn)
+    {
+        Value result{};
+        compute(key, [&](bool present, Value& current, uint64_t) {
+            current = present ? fn(current, value) : value;
+            result = current;
+            return KComputeAction::Store;
+        });
+        return result;
+    }
+
+    // key不存在时才写入，返回是否写入(容量为0等写入未生效的情况返回false)
+    bool putIfAbsent(const Key& key, const Value& value)
+    {
+        bool inserted = false;
+        uint64_t version = compute(key, [&](bool present, Value& current, uint64_t) {
+            if (present)
+                return KComputeAction::Keep;
+            current = value;
+            inserted = true;
+            return KComputeAction::Store;
+        });
+        return inserted && version != 0;
+    }
+
+    // 读取value及其版本号，供compareAndSet使用
+    bool getVersioned(const Key& key, Value& value, uint64_t& version)
+    {
+        bool found = false;
+        version = compute(key, [&](bool present, Value& current, uint64_t) {
+            if (present)
+                value = current;
+            found = present;
+            return KComputeAction::Keep;
+        });
+        return found;
+    }
+
+    // 版本号等于expectedVersion时才写入(expectedVersion为0表示要求key不存在)，返回是否写入(未生效返回false)
+    bool compareAndSet(const Key& key, uint64_t expectedVersion, const Value& value)
+    {
+        bool swapped = false;
+        uint64_t newVersion = compute(key, [&](bool present, Value& current, uint64_t version) {
+            if ((present ? version : 0) != expectedVersion)
+                return KComputeAction::Keep;
+            current = value;
+            swapped = true;
+            return KComputeAction::Store;
+        });
+        return swapped && newVersion != 0;
+    }
+
+protected:
+    // 淘汰一个条目时由实现调用(在移除之前，value仍有效)
+    void notifyEvicted(const Key& key, const Value& value) const
+    {
+        if (evictionListener_)
+            evictionListener_(key, value);
+    }
+
+    // 取出value需要额外复制/解码的实现先判断是否有监听
+    bool hasEvictionListener() const { return static_cast<bool>(evictionListener_); }
+
+private:
+    EvictionListener evictionListener_;
 };
 
-} // namespace MyCache
\ No newline at end of file
+} // namespace MyCache
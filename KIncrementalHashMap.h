@@ -0,0 +1,448 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdlib>
+#include <functional>
+#include <memory>
+#include <new>
+#include <utility>
+
+namespace MyCache
+{
+
+// 渐进式rehash的哈希表(参考Redis的dict)
+// std::unordered_map扩容时一次性把所有元素搬到新的桶数组，百万级元素时会在缓存锁内停顿上百毫秒。
+// 本表扩容时同时保留新旧两张表：新元素只插入新表，之后每次查找/插入/删除顺带把旧表的几个桶
+// 搬到新表，旧表搬空后释放，单次操作的最坏耗时与表的大小无关
+// - 拉链法，装载因子达到1时把桶数翻倍
+// - 迁移只移动节点指针，元素地址不变，iterator在迁移后仍然有效(只有被删除的元素失效)
+// - 提供缓存用到的unordered_map接口子集，包括KGeneration::sweep使用的按桶遍历
+// 不加锁，由缓存在自己的锁内使用
+template<typename Key, typename T, typename Hash = std::hash<Key>, typename KeyEqual = std::equal_to<Key>>
+class KIncrementalHashMap
+{
+public:
+    using key_type = Key;
+    using mapped_type = T;
+    using value_type = std::pair<const Key, T>;
+
+private:
+    struct Node
+    {
+        value_type value;
+        size_t     hash;
+        Node*      next;
+
+        template<typename K, typename V>
+        Node(K&& key, V&& mapped, size_t hash)
+            : value(std::forward<K>(key), std::forward<V>(mapped)), hash(hash), next(nullptr)
+        {}
+    };
+
+    struct FreeDeleter
+    {
+        void operator()(Node** buckets) const { std::free(buckets); }
+    };
+
+    struct Table
+    {
+        std::unique_ptr<Node*[], FreeDeleter> buckets;
+        size_t                   size = 0;     // 桶数(0或2的幂)
+
+        size_t indexOf(size_t hash) const { return hash & (size - 1); }
+
+        // 用calloc分配：大块内存直接映射为零页，不需要逐页清零，扩容本身也是O(1)
+        void allocate(size_t count)
+        {
+            Node** memory = static_cast<Node**>(std::calloc(count, sizeof(Node*)));
+            if (!memory)
+                throw std::bad_alloc();
+            buckets.reset(memory);
+            size = count;
+        }
+
+        void release()
+        {
+            buckets.reset();
+            size = 0;
+        }
+    };
+
+public:
+    class iterator
+    {
+    public:
+        iterator() : map_(nullptr), node_(nullptr) {}
+
+        value_type& operator*() const { return node_->value; }
+        value_type* operator->() const { return &node_->value; }
+
+        iterator& operator++()
+        {
+            node_ = node_->next ? node_->next : map_->nextNonEmpty(node_);
+            return *this;
+        }
+
+        iterator operator++(int)
+        {
+            iterator old = *this;
+            ++*this;
+            return old;
+        }
+
+        bool operator==(const iterator& other) const { return node_ == other.node_; }
+        bool operator!=(const iterator& other) const { return node_ != other.node_; }
+
+    private:
+        friend class KIncrementalHashMap;
+        iterator(const KIncrementalHashMap* map, Node* node) : map_(map), node_(node) {}
+
+        const KIncrementalHashMap* map_;
+        Node* node_;
+    };
+
+    // 单个桶内的遍历
+    class local_iterator
+    {
+    public:
+        explicit local_iterator(Node* node = nullptr) : node_(node) {}
+
+        value_type& operator*() const { return node_->value; }
+        value_type* operator->() const { return &node_->value; }
+        local_iterator& operator++() { node_ = node_->next; return *this; }
+
+        bool operator==(const local_iterator& other) const { return node_ == other.node_; }
+        bool operator!=(const local_iterator& other) const { return node_ != other.node_; }
+
+    private:
+        Node* node_;
+    };
+
+    KIncrementalHashMap()
+        : rehashIndex_(kNotRehashing)
+        , rehashPaused_(false)
+        , size_(0)
+    {}
+
+    ~KIncrementalHashMap()
+    {
+        freeNodes();
+    }
+
+    KIncrementalHashMap(const KIncrementalHashMap&) = delete;
+    KIncrementalHashMap& operator=(const KIncrementalHashMap&) = delete;
+
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+
+    iterator begin() const { return iterator(this, firstFrom(0, 0)); }
+    iterator end() const { return iterator(this, nullptr); }
+
+    iterator find(const Key& key)
+    {
+        rehashStep();
+        return iterator(this, findNode(key, hasher_(key)));
+    }
+
+    std::pair<iterator, bool> emplace(const Key& key, const T& mapped)
+    {
+        rehashStep();
+        size_t hash = hasher_(key);
+        if (Node* node = findNode(key, hash))
+            return {iterator(this, node), false};
+        return {iterator(this, insertNode(new Node(key, mapped, hash))), true};
+    }
+
+    T& operator[](const Key& key)
+    {
+        return emplace(key, T()).first->second;
+    }
+
+    size_t erase(const Key& key)
+    {
+        rehashStep();
+        Node* node = findNode(key, hasher_(key));
+        if (!node)
+            return 0;
+        unlinkNode(node);
+        return 1;
+    }
+
+    // 删除iterator指向的元素(不触发迁移，其他iterator保持有效)，返回下一个元素
+    iterator erase(iterator it)
+    {
+        iterator next = it;
+        ++next;
+        unlinkNode(it.node_);
+        return next;
+    }
+
+    // 删除哈希值等于hash的所有元素(不比较key，用于只知道哈希值的失效通知)，
+    // 删除前对每个元素调用func(value)，返回删除数
+    template<typename Func>
+    size_t eraseHash(size_t hash, Func&& func)
+    {
+        rehashStep();
+        size_t erased = 0;
+        for (int t = 0; t < 2; ++t)
+        {
+            Table& table = tables_[t];
+            if (table.size == 0)
+                continue;
+            Node** link = &table.buckets[table.indexOf(hash)];
+            while (Node* node = *link)
+            {
+                if (node->hash != hash)
+                {
+                    link = &node->next;
+                    continue;
+                }
+                func(node->value);
+                *link = node->next;
+                delete node;
+                --size_;
+                ++erased;
+            }
+        }
+        return erased;
+    }
+
+    // 清空所有元素，保留当前的桶数组
+    void clear()
+    {
+        freeNodes();
+        if (rehashIndex_ != kNotRehashing)
+            finishRehash();
+        for (size_t i = 0; i < tables_[0].size; ++i)
+            tables_[0].buckets[i] = nullptr;
+        size_ = 0;
+    }
+
+    // 预留能容纳count个元素的桶(构造时按容量预留，之后正常使用不会再扩容)
+    void reserve(size_t count)
+    {
+        size_t target = bucketCountFor(count);
+        if (target <= tables_[0].size && rehashIndex_ == kNotRehashing)
+            return;
+        // 预留是一次性的显式操作，直接完成迁移
+        if (rehashIndex_ == kNotRehashing)
+            startRehash(target);
+        else if (target > tables_[1].size)
+        {
+            migrateAll();
+            startRehash(target);
+        }
+        migrateAll();
+    }
+
+    // 按桶遍历：正在迁移时旧表的桶在前，新表的桶接在后面
+    size_t bucket_count() const
+    {
+        return tables_[0].size + tables_[1].size;
+    }
+
+    local_iterator begin(size_t bucket) const
+    {
+        if (bucket < tables_[0].size)
+            return local_iterator(tables_[0].buckets[bucket]);
+        if (bucket - tables_[0].size < tables_[1].size)
+            return local_iterator(tables_[1].buckets[bucket - tables_[0].size]);
+        return local_iterator();    // 越界(迁移完成后桶数变少)视为空桶
+    }
+
+    local_iterator end(size_t) const { return local_iterator(); }
+
+    bool rehashing() const { return rehashIndex_ != kNotRehashing; }
+
+    // 暂停/恢复查找、删除时顺带的迁移，使按桶遍历期间桶的编号保持不变(如KGeneration::sweep边遍历边删除)
+    // 暂停期间插入仍可能在迁移赶不上时一次性完成迁移
+    void pauseRehash(bool paused) { rehashPaused_ = paused; }
+
+    // 桶数组和节点占用的字节数(元素在堆上的数据不含在内)
+    size_t memoryBytes() const
+    {
+        return bucket_count() * sizeof(Node*) + size_ * sizeof(Node);
+    }
+
+private:
+    static constexpr size_t kNotRehashing = static_cast<size_t>(-1);
+    static constexpr size_t kInitialBuckets = 16;
+    static constexpr size_t kRehashBuckets = 4;        // 每次操作迁移的非空桶数
+    static constexpr size_t kMaxEmptyVisits = 40;      // 每次操作最多跳过的空桶数，限制单次耗时
+
+    static size_t bucketCountFor(size_t count)
+    {
+        size_t buckets = kInitialBuckets;
+        while (buckets < count)
+            buckets <<= 1;
+        return buckets;
+    }
+
+    Node* findNode(const Key& key, size_t hash) const
+    {
+        for (int t = 0; t < 2; ++t)
+        {
+            const Table& table = tables_[t];
+            if (table.size == 0)
+                continue;
+            for (Node* node = table.buckets[table.indexOf(hash)]; node; node = node->next)
+            {
+                if (node->hash == hash && equal_(node->value.first, key))
+                    return node;
+            }
+        }
+        return nullptr;
+    }
+
+    Node* insertNode(Node* node)
+    {
+        if (tables_[0].size == 0)
+            tables_[0].allocate(kInitialBuckets);
+        else if (rehashIndex_ == kNotRehashing && size_ >= tables_[0].size)
+            startRehash(tables_[0].size * 2);
+        else if (rehashIndex_ != kNotRehashing && size_ >= tables_[1].size)
+            migrateAll();   // 迁移赶不上插入(正常使用下不会发生)
+        // 迁移期间新元素只进新表
+        Table& table = rehashIndex_ != kNotRehashing ? tables_[1] : tables_[0];
+        Node*& head = table.buckets[table.indexOf(node->hash)];
+        node->next = head;
+        head = node;
+        ++size_;
+        return node;
+    }
+
+    // 节点所在的表以及链表中指向它的链接
+    // 迁移期间旧表中未迁移的桶里的节点还在旧表，但迁移开始后插入的节点即使对应旧表中未迁移的桶也在新表，
+    // 所以先在旧表的桶里找，找不到再到新表
+    std::pair<int, Node**> locate(const Node* node) const
+    {
+        if (rehashIndex_ == kNotRehashing || tables_[0].indexOf(node->hash) >= rehashIndex_)
+        {
+            for (Node** link = &tables_[0].buckets[tables_[0].indexOf(node->hash)]; *link; link = &(*link)->next)
+            {
+                if (*link == node)
+                    return {0, link};
+            }
+        }
+        Node** link = &tables_[1].buckets[tables_[1].indexOf(node->hash)];
+        while (*link != node)
+            link = &(*link)->next;
+        return {1, link};
+    }
+
+    void unlinkNode(Node* node)
+    {
+        Node** link = locate(node).second;
+        *link = node->next;
+        delete node;
+        --size_;
+    }
+
+    // iterator前进：从节点所在桶的下一个桶开始找
+    Node* nextNonEmpty(const Node* node) const
+    {
+        int t = locate(node).first;
+        return firstFrom(t, tables_[t].indexOf(node->hash) + 1);
+    }
+
+    Node* firstFrom(int t, size_t index) const
+    {
+        for (; t < 2; ++t, index = 0)
+        {
+            const Table& table = tables_[t];
+            for (; index < table.size; ++index)
+            {
+                if (table.buckets[index])
+                    return table.buckets[index];
+            }
+        }
+        return nullptr;
+    }
+
+    void startRehash(size_t buckets)
+    {
+        tables_[1].allocate(buckets);
+        rehashIndex_ = 0;
+    }
+
+    // 迁移旧表的一个桶到新表
+    void migrateBucket(size_t index)
+    {
+        Node* node = tables_[0].buckets[index];
+        while (node)
+        {
+            Node* next = node->next;
+            Node*& head = tables_[1].buckets[tables_[1].indexOf(node->hash)];
+            node->next = head;
+            head = node;
+            node = next;
+        }
+        tables_[0].buckets[index] = nullptr;
+    }
+
+    // 每次操作顺带迁移少量桶
+    void rehashStep()
+    {
+        if (rehashIndex_ == kNotRehashing || rehashPaused_)
+            return;
+        size_t moved = 0;
+        size_t emptyVisits = 0;
+        while (rehashIndex_ < tables_[0].size && moved < kRehashBuckets)
+        {
+            if (tables_[0].buckets[rehashIndex_])
+            {
+                migrateBucket(rehashIndex_);
+                ++moved;
+            }
+            else if (++emptyVisits > kMaxEmptyVisits)
+            {
+                break;
+            }
+            ++rehashIndex_;
+        }
+        if (rehashIndex_ >= tables_[0].size)
+            finishRehash();
+    }
+
+    void migrateAll()
+    {
+        for (; rehashIndex_ < tables_[0].size; ++rehashIndex_)
+            migrateBucket(rehashIndex_);
+        finishRehash();
+    }
+
+    void finishRehash()
+    {
+        tables_[0] = std::move(tables_[1]);
+        tables_[1].release();
+        rehashIndex_ = kNotRehashing;
+    }
+
+    void freeNodes()
+    {
+        for (Table& table : tables_)
+        {
+            for (size_t i = 0; i < table.size; ++i)
+            {
+                Node* node = table.buckets[i];
+                while (node)
+                {
+                    Node* next = node->next;
+                    delete node;
+                    node = next;
+                }
+                table.buckets[i] = nullptr;
+            }
+        }
+    }
+
+private:
+    Table       tables_[2];     // tables_[0]为当前表，迁移期间tables_[1]为新表
+    size_t      rehashIndex_;   // 旧表中下一个要迁移的桶，不在迁移时为kNotRehashing
+    bool        rehashPaused_;  // 是否暂停顺带的迁移
+    size_t      size_;
+    Hash        hasher_;
+    KeyEqual    equal_;
+};
+
+} // namespace MyCache
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <type_traits>
+
+#include "KCompactLruCache.h"
+#include "KHashedKey.h"
+
+namespace MyCache
+{
+
+// 整数key的存放方式：key直接存在节点里，哈希在需要时由key重新计算
+template<typename IntKey>
+struct KInlineKeyStore
+{
+    using Key = IntKey;
+    using KeyView = IntKey;
+    using NodeKey = IntKey;
+
+    struct ShardKeys
+    {
+        void reset() {}
+    };
+
+    static constexpr size_t kInlineKeyBytes = sizeof(Key);
+
+    // 与KHashedKey<Key>相同的哈希：std::hash对整数是恒等映射，经mixHash混合后高低位都均匀
+    static uint64_t hashOf(Key key)
+    {
+        return mixHash(static_cast<uint64_t>(std::hash<Key>()(key)));
+    }
+
+    static uint64_t hashOf(const ShardKeys&, Key nodeKey) { return hashOf(nodeKey); }
+
+    static bool equals(const ShardKeys&, Key nodeKey, Key key, uint64_t) { return nodeKey == key; }
+
+    static void assign(ShardKeys&, Key& nodeKey, Key key, uint64_t) { nodeKey = key; }
+    static void release(ShardKeys&, Key) {}
+    static Key keyOf(const ShardKeys&, Key nodeKey) { return nodeKey; }
+
+    static size_t liveKeyBytes(const ShardKeys&) { return 0; }
+    static size_t keyCapacityBytes(const ShardKeys&) { return 0; }
+
+    template<typename ForEachNodeKey>
+    static void compactIfNeeded(ShardKeys&, ForEachNodeKey) {}
+};
+
+// 整数key的分片LRU缓存(key为int、uint64_t等整数类型)
+// KLruCache中key在哈希表和节点里各存一份，每个节点单独分配并带shared_ptr控制块和两个8字节指针；这里：
+// - 节点连续存放在数组中，key只存在节点里(KInlineKeyStore)，LRU链表和空闲链表用32位下标
+// - 节点中value之前的部分(key、两个下标、版本号)不超过一个缓存行
+// - 索引是线性探测的开放寻址表，直接用混合后的整数哈希定位，每个槽8字节：高32位是哈希指纹，低32位是节点下标+1(0为空槽)
+// 不支持标签和命名空间失效；容量固定，节点数组和索引在构造时按容量分配，之后不会扩容
+template<typename Key, typename Value>
+class KIntLruCache : public KCompactLruCache<KInlineKeyStore<Key>, Value>
+{
+    static_assert(std::is_integral<Key>::value, "KIntLruCache只支持整数类型的key");
+
+public:
+    KIntLruCache(size_t capacity, int shardNum = 0)
+        : KCompactLruCache<KInlineKeyStore<Key>, Value>(capacity, shardNum, "KIntLruCache")
+    {}
+};
+
+} // namespace MyCache
@@ -0,0 +1,376 @@
+#pragma once
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <climits>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "KHashedKey.h"
+
+namespace MyCache
+{
+
+// 同一主机上多个进程之间的缓存失效总线
+// 各进程各自内嵌缓存(例如KHashLruCaches)、背后是同一份数据时，一个进程写入后用总线广播key的哈希值，
+// 其他进程按批删除对应的条目，不经过网络，传播延迟在微秒级
+// - 共享内存(shm_open)中的广播环形缓冲区：发布者用fetch_add领取位置后写入槽位，
+//   每个订阅者维护自己的读位置，互不影响；槽位带序列号(seqlock)，读到一半被覆盖能够发现
+// - 门铃是共享内存中的一个32位计数器：订阅者没有新事件时在上面futex等待，发布者加一后有人等待才唤醒
+// - 订阅者落后超过一圈(或等待的槽位迟迟未写完，例如发布者在写入中途崩溃)时无法知道丢了哪些key，
+//   交给overrun回调(通常是清空整个缓存)，然后从当前位置继续
+// - 自己发布的事件不会交给自己的订阅回调
+// 只支持Linux(futex)
+
+
+struct KInvalidationBusStats
+{
+    uint64_t published = 0;     // 本实例发布的哈希值数
+    uint64_t received = 0;      // 本实例收到的(其他实例发布的)哈希值数
+    uint64_t batches = 0;       // 调用订阅回调的次数
+    uint64_t overruns = 0;      // 落后太多、只能整体失效的次数
+};
+
+class KInvalidationBus
+{
+public:
+    using Handler = std::function<void(const std::vector<uint64_t>& hashes)>;
+    using OverrunHandler = std::function<void()>;
+
+    // 打开(不存在时创建)名为name的总线，name的格式同shm_open("/xxx")
+    // capacity向上取整为2的幂，同一总线的所有进程必须使用相同的capacity，失败抛出std::system_error
+    explicit KInvalidationBus(const std::string& name, size_t capacity = 65536, size_t batchSize = 1024)
+        : capacity_(roundUp(capacity))
+        , batchSize_(batchSize)
+        , senderId_(makeSenderId())
+        , cursor_(0)
+        , stopping_(false)
+        , published_(0)
+        , received_(0)
+        , batches_(0)
+        , overruns_(0)
+    {
+        mapSize_ = sizeof(Header) + capacity_ * sizeof(Slot);
+        // 创建和初始化都在共享内存文件的flock下进行，创建者在写入魔数前崩溃时锁随之释放，
+        // 下一个拿到锁的进程读不到魔数，清零后重新创建(同KShmCache)
+        int fd = ::shm_open(name.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+        if (fd < 0)
+            throw std::system_error(errno, std::generic_category(), "打开共享内存失败: " + name);
+        uint64_t magic = 0;
+        if (::flock(fd, LOCK_EX) != 0 || ::pread(fd, &magic, sizeof(magic), 0) < 0)
+        {
+            int error = errno;
+            ::close(fd);
+            throw std::system_error(error, std::generic_category(), "锁定共享内存失败: " + name);
+        }
+        bool creator = magic != kMagic;
+        if (creator && (::ftruncate(fd, 0) != 0 || ::ftruncate(fd, static_cast<off_t>(mapSize_)) != 0))
+        {
+            int error = errno;
+            ::close(fd);
+            ::shm_unlink(name.c_str());
+            throw std::system_error(error, std::generic_category(), "设置共享内存大小失败: " + name);
+        }
+        if (!creator && fileSize(fd) != mapSize_)
+        {
+            ::close(fd);
+            throw std::system_error(EINVAL, std::generic_category(), "总线容量与已有的不一致: " + name);
+        }
+        void* memory = ::mmap(nullptr, mapSize_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (memory == MAP_FAILED)
+        {
+            int error = errno;
+            ::close(fd);
+            throw std::system_error(error, std::generic_category(), "映射共享内存失败: " + name);
+        }
+
+        header_ = static_cast<Header*>(memory);
+        slots_ = reinterpret_cast<Slot*>(header_ + 1);
+        if (creator)
+        {
+            // 先截断为0再设置大小，得到的内存全为0，序列号0表示槽位从未写过
+            header_->capacity = capacity_;
+            header_->magic.store(kMagic, std::memory_order_release);
+        }
+        // 映射持有文件的引用，close不会释放flock，需要显式解锁
+        ::flock(fd, LOCK_UN);
+        ::close(fd);
+    }
+
+    ~KInvalidationBus()
+    {
+        stop();
+        ::munmap(header_, mapSize_);
+    }
+
+    KInvalidationBus(const KInvalidationBus&) = delete;
+    KInvalidationBus& operator=(const KInvalidationBus&) = delete;
+
+    // 删除共享内存的名字，已打开的进程不受影响
+    static void unlink(const std::string& name)
+    {
+        ::shm_unlink(name.c_str());
+    }
+
+    void publish(uint64_t hash)
+    {
+        write(hash);
+        ring();
+    }
+
+    // 批量发布，只敲一次门铃
+    void publish(const std::vector<uint64_t>& hashes)
+    {
+        for (uint64_t hash : hashes)
+            write(hash);
+        if (!hashes.empty())
+            ring();
+    }
+
+    // 发布key的哈希值(与缓存中KHashedKey的计算方式相同)
+    template<typename Key>
+    void publishKey(const Key& key)
+    {
+        publish(KHashedKey<Key>(key).hash);
+    }
+
+    // 启动订阅线程：其他实例发布的哈希值按批(最多batchSize个)交给handler，落后太多时调用overrun
+    // 只收到订阅之后发布的事件
+    void subscribe(Handler handler, OverrunHandler overrun)
+    {
+        if (thread_.joinable())
+            return;
+        handler_ = std::move(handler);
+        overrun_ = std::move(overrun);
+        cursor_ = header_->writePos.load(std::memory_order_acquire);
+        stopping_ = false;
+        thread_ = std::thread(&KInvalidationBus::run, this);
+    }
+
+    // 订阅一个缓存：收到的哈希值交给cache.invalidateHashes，落后太多时cache.clear()
+    template<typename Cache>
+    void subscribe(Cache& cache)
+    {
+        subscribe([&cache](const std::vector<uint64_t>& hashes) { cache.invalidateHashes(hashes); },
+                  [&cache] { cache.clear(); });
+    }
+
+    void stop()
+    {
+        if (!thread_.joinable())
+            return;
+        stopping_ = true;
+        futexWake(&header_->doorbell);
+        thread_.join();
+    }
+
+    KInvalidationBusStats stats() const
+    {
+        KInvalidationBusStats stats;
+        stats.published = published_.load();
+        stats.received = received_.load();
+        stats.batches = batches_.load();
+        stats.overruns = overruns_.load();
+        return stats;
+    }
+
+private:
+    struct Header
+    {
+        std::atomic<uint64_t>               magic;
+        uint64_t                            capacity;
+        alignas(64) std::atomic<uint64_t>   writePos;   // 已领取的位置数
+        alignas(64) std::atomic<uint32_t>   doorbell;   // 门铃计数器(futex字)
+        std::atomic<uint32_t>               sleepers;   // 正在门铃上等待的订阅者数
+    };
+
+    // 序列号：0为从未写过，kWriting为正在写，否则为位置+1
+    struct Slot
+    {
+        std::atomic<uint64_t> sequence;
+        std::atomic<uint64_t> hash;
+        std::atomic<uint64_t> sender;
+    };
+
+    static_assert(std::atomic<uint64_t>::is_always_lock_free && std::atomic<uint32_t>::is_always_lock_free,
+        "共享内存中的原子变量必须是无锁的");
+
+    static constexpr uint64_t kMagic = 0x4b494e5642555331ULL;     // "KINVBUS1"
+    static constexpr uint64_t kWriting = UINT64_MAX;
+    static constexpr std::chrono::milliseconds kWaitTimeout{50};            // 门铃等待的最长时间
+    static constexpr std::chrono::milliseconds kStallTimeout{100};          // 槽位迟迟未写完时视为丢失
+
+    static size_t roundUp(size_t capacity)
+    {
+        size_t size = 2;
+        while (size < capacity)
+            size <<= 1;
+        return size;
+    }
+
+    // 进程号 + 进程内序号，同一进程内的多个实例也能区分
+    static uint64_t makeSenderId()
+    {
+        static std::atomic<uint32_t> counter(0);
+        return (static_cast<uint64_t>(::getpid()) << 32) | (counter.fetch_add(1) + 1);
+    }
+
+    // 等待创建者设置好共享内存的大小，返回该大小
+    static size_t fileSize(int fd)
+    {
+        struct stat st;
+        return ::fstat(fd, &st) == 0 ? static_cast<size_t>(st.st_size) : 0;
+    }
+
+    void write(uint64_t hash)
+    {
+        uint64_t pos = header_->writePos.fetch_add(1, std::memory_order_relaxed);
+        Slot& slot = slots_[pos & (capacity_ - 1)];
+        slot.sequence.store(kWriting, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        slot.hash.store(hash, std::memory_order_relaxed);
+        slot.sender.store(senderId_, std::memory_order_relaxed);
+        slot.sequence.store(pos + 1, std::memory_order_release);
+        published_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // 门铃加一；与订阅者的sleepers加一、futex检查门铃构成Dekker式的配对，都用seq_cst，不会漏唤醒
+    void ring()
+    {
+        header_->doorbell.fetch_add(1);
+        if (header_->sleepers.load() > 0)
+            futexWake(&header_->doorbell);
+    }
+
+    static void futexWake(std::atomic<uint32_t>* word)
+    {
+        ::syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+    }
+
+    static void futexWait(std::atomic<uint32_t>* word, uint32_t expected, std::chrono::milliseconds timeout)
+    {
+        timespec ts{};
+        ts.tv_sec = static_cast<time_t>(timeout.count() / 1000);
+        ts.tv_nsec = static_cast<long>(timeout.count() % 1000 * 1000000);
+        ::syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), FUTEX_WAIT, expected, &ts, nullptr, 0);
+    }
+
+    enum class ReadResult { Ok, Empty, Overrun };
+
+    // 读cursor_处的事件
+    ReadResult read(uint64_t& hash, uint64_t& sender)
+    {
+        Slot& slot = slots_[cursor_ & (capacity_ - 1)];
+        uint64_t sequence = slot.sequence.load(std::memory_order_acquire);
+        if (sequence == cursor_ + 1)
+        {
+            hash = slot.hash.load(std::memory_order_relaxed);
+            sender = slot.sender.load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (slot.sequence.load(std::memory_order_relaxed) == sequence)
+                return ReadResult::Ok;
+            return ReadResult::Overrun;     // 读的过程中被下一圈覆盖
+        }
+        if (sequence != kWriting && sequence > cursor_ + 1)
+            return ReadResult::Overrun;
+        if (header_->writePos.load(std::memory_order_acquire) - cursor_ > capacity_)
+            return ReadResult::Overrun;
+        return ReadResult::Empty;
+    }
+
+    void run()
+    {
+        std::vector<uint64_t> batch;
+        batch.reserve(batchSize_);
+        auto stallStart = std::chrono::steady_clock::time_point();
+        while (!stopping_)
+        {
+            batch.clear();
+            ReadResult result = ReadResult::Empty;
+            uint64_t hash, sender;
+            while (batch.size() < batchSize_ && (result = read(hash, sender)) == ReadResult::Ok)
+            {
+                ++cursor_;
+                if (sender != senderId_)
+                    batch.push_back(hash);
+            }
+            if (!batch.empty())
+            {
+                received_ += batch.size();
+                ++batches_;
+                handler_(batch);
+            }
+
+            if (result == ReadResult::Empty && header_->writePos.load(std::memory_order_acquire) > cursor_)
+            {
+                // 位置已被领取但还没写完：稍等，太久则视为丢失
+                auto now = std::chrono::steady_clock::now();
+                if (stallStart == std::chrono::steady_clock::time_point())
+                    stallStart = now;
+                else if (now - stallStart > kStallTimeout)
+                    result = ReadResult::Overrun;
+                if (result != ReadResult::Overrun)
+                {
+                    std::this_thread::yield();
+                    continue;
+                }
+            }
+            stallStart = std::chrono::steady_clock::time_point();
+
+            if (result == ReadResult::Overrun)
+            {
+                // 先跳到当前位置再整体失效：此后重新加载的数据一定不早于被跳过的写入
+                cursor_ = header_->writePos.load(std::memory_order_acquire);
+                ++overruns_;
+                overrun_();
+                continue;
+            }
+            if (result == ReadResult::Ok)
+                continue;   // 批满了，继续读
+
+            // 没有新事件：先读门铃，再确认一次，然后在门铃上等待
+            uint32_t bell = header_->doorbell.load();
+            if (header_->writePos.load() > cursor_)
+                continue;
+            header_->sleepers.fetch_add(1);
+            if (!stopping_)
+                futexWait(&header_->doorbell, bell, kWaitTimeout);
+            header_->sleepers.fetch_sub(1);
+        }
+    }
+
+private:
+    const size_t            capacity_;
+    const size_t            batchSize_;
+    const uint64_t          senderId_;
+    size_t                  mapSize_;
+    Header*                 header_;
+    Slot*                   slots_;
+
+    uint64_t                cursor_;    // 下一个要读的位置，只在订阅线程中访问
+    Handler                 handler_;
+    OverrunHandler          overrun_;
+    std::atomic<bool>       stopping_;
+    std::thread             thread_;
+
+    std::atomic<uint64_t>   published_;
+    std::atomic<uint64_t>   received_;
+    std::atomic<uint64_t>   batches_;
+    std::atomic<uint64_t>   overruns_;
+};
+
+} // namespace MyCache
@@ -1,13 +1,22 @@
 #pragma once
 
+#include <algorithm>
+#include <climits>
 #include <cmath>
+#include <cstdint>
 #include <memory>
 #include <mutex>
+#include <string>
 #include <thread>
 #include <unordered_map>
 #include <vector>
 
+#include "KGeneration.h"
+#include "KHashedKey.h"
 #include "KICachePolicy.h"
+#include "KIncrementalHashMap.h"
+#include "KLockProfiler.h"
+#include "KTagIndex.h"
 
 namespace MyCache
 {
@@ -17,88 +26,93 @@ template<typename Key, typename Value> class KLfuCache;
 template<typename Key, typename Value> class KLfuAgingCache;
 
 
+// 节点按冷热拆成两个数组(struct-of-arrays)，同一个节点在两个数组中的下标相同：
+// - 元数据(热)：频次链表的链接、频次、过期判断用的命名空间和代数、哈希值，每个32字节，一个缓存行放两个
+// - 数据(冷)：key、value和版本号，只在命中、写入和淘汰回调时访问
+// 淘汰时找链表头、升频时摘链/挂链、老化时遍历所有节点都只访问元数据数组，不会把大的value读进缓存
+constexpr uint32_t kLfuNoNode = UINT32_MAX;   // 空链接
 
-// 频率链表
-template<typename Key, typename Value>
-class FreqList
+struct LfuNodeMeta
 {
-private:
-	//频率链表中的节点结构
-    struct Node
-    {
-    	int freq;    //节点访问频率(次数)
-		Key key;
-		Value value;
-		std::shared_ptr<Node> pre;  //前驱节点指针
-		std::shared_ptr<Node> next;	//后继节点指针
-
-		Node() 
-		: freq(1), pre(nullptr), next(nullptr) {}
-		Node(Key key, Value value) 
-		: freq(1), key(key), value(value), pre(nullptr), next(nullptr) {}
-    };
+	uint32_t pre;		// 同一频次链表中的前驱(更早访问)
+	uint32_t next;		// 后继(更晚访问)，空闲节点用它串成空闲链表
+	int      freq;		// 访问频率(次数)，0表示空闲节点
+	uint32_t ns;		// 所属命名空间
+	uint64_t gen;		// 插入时的代数
+	uint64_t hash;		// key的哈希值，淘汰时无需重新计算
+};
 
-	using NodePtr = std::shared_ptr<Node>;
-    int freq_; 		// 该链表对应的频率值
-    NodePtr head_; 	// 假头结点
-    NodePtr tail_; 	// 假尾结点
+template<typename Key, typename Value>
+struct LfuNodeData
+{
+	Key key;
+	Value value;
+	uint64_t version = 0;	// 版本号，每次写入value时更新(用于compareAndSet)
+};
 
 
-public:
-	//构造函数，初始化指定频率的链表
-	explicit FreqList(int n) 	//explicit 表示禁止隐性类型转换
-     : freq_(n) 
-    {
-      head_ = std::make_shared<Node>();
-      tail_ = std::make_shared<Node>();
-      head_->next = tail_;
-      tail_->pre = head_;
-    }
+// 频率链表：同一访问频次的节点按访问先后串成双向链表，节点用下标表示
+struct FreqList
+{
+	uint32_t head = kLfuNoNode;	// 最久未被访问的节点
+	uint32_t tail = kLfuNoNode;	// 最近访问的节点
 
 	//判断链表是否为空
 	bool isEmpty() const
 	{
-		return head_->next == tail_;
+		return head == kLfuNoNode;
 	}
 
-
 	// 将节点添加到链表尾部(最近访问)
-    void addNode(NodePtr node) 
+	void addNode(std::vector<LfuNodeMeta>& meta, uint32_t index)
 	{
-		if (!node || !head_ || !tail_) 
-            return;
-
-		node->pre = tail_->pre;
-		node->next = tail_;
-		tail_->pre->next = node;
-		tail_->pre = node;
+		meta[index].pre = tail;
+		meta[index].next = kLfuNoNode;
+		if (tail != kLfuNoNode)
+			meta[tail].next = index;
+		else
+			head = index;
+		tail = index;
 	}
 
 	// 从链表中移除节点
-	void removeNode(NodePtr node)
-    {
-        if (!node || !head_ || !tail_)
-            return;
-        if (!node->pre || !node->next) 
-            return;
+	void removeNode(std::vector<LfuNodeMeta>& meta, uint32_t index)
+	{
+		LfuNodeMeta& node = meta[index];
+		if (node.pre != kLfuNoNode)
+			meta[node.pre].next = node.next;
+		else
+			head = node.next;
+		if (node.next != kLfuNoNode)
+			meta[node.next].pre = node.pre;
+		else
+			tail = node.pre;
+		node.pre = node.next = kLfuNoNode;
+	}
 
-        node->pre->next = node->next;
-        node->next->pre = node->pre;
-        node->pre = nullptr;
-        node->next = nullptr;
-    }
+	// 把other整个接到本链表尾部(O(1))，other变为空
+	void splice(std::vector<LfuNodeMeta>& meta, FreqList& other)
+	{
+		if (other.isEmpty())
+			return;
+		if (isEmpty())
+		{
+			head = other.head;
+		}
+		else
+		{
+			meta[tail].next = other.head;
+			meta[other.head].pre = tail;
+		}
+		tail = other.tail;
+		other.head = other.tail = kLfuNoNode;
+	}
 
 	// 获取链表实际首节点(该链表中最久未被访问的节点)
-	NodePtr getFirstNode() const 
-	{ 
-		return head_->next; 
+	uint32_t getFirstNode() const
+	{
+		return head;
 	}
-
-	//缓存类可以直接操作各频率链表
-	friend class KLfuCache<Key, Value>;
-	friend class KLfuAgingCache<Key, Value>;
-
-    
 };
 
 
@@ -108,31 +122,45 @@ template <typename Key, typename Value>
 class KLfuCache : public KICachePolicy<Key, Value>
 {
 public:
-    using Node = typename FreqList<Key, Value>::Node;
-    using NodePtr = std::shared_ptr<Node>;
-    using NodeMap = std::unordered_map<Key, NodePtr>;
+    using NodeData = LfuNodeData<Key, Value>;
+    using HashedKey = KHashedKey<Key>;
+    using NodeMap = KIncrementalHashMap<HashedKey, uint32_t, KHashedKeyHasher<Key>>;	// key -> 节点下标，直接使用key携带的哈希值，渐进式rehash
 
 	//构造函数
 	KLfuCache(int capacity)
-    : capacity_(capacity), minFreq_(INT8_MAX)
-    {}
+    : capacity_(capacity), minFreq_(INT_MAX), freeHead_(kLfuNoNode), versionCounter_(0)
+    , evictionSlack_(0), maintenanceSignaled_(false)
+    {
+		if (capacity_ > 0)
+		{
+			nodeMap_.reserve(capacity_);	// 按容量预留桶和节点数组，填充过程中不再扩容
+			meta_.reserve(capacity_);
+			data_.reserve(capacity_);
+		}
+		MyCache::setLockName(mutex_, "KLfuCache");
+	}
 
-	//析构函数
 	~KLfuCache() override = default;
 
 	//添加缓存 接口
 	void put(Key key, Value value) override
+	{
+		put(HashedKey(key), value);
+	}
+
+	// 添加缓存(key的哈希值已由调用方算好，如分片缓存的路由)
+	void put(const HashedKey& key, Value value)
 	{
 		if (capacity_ == 0)
             return;
-		std::lock_guard<std::mutex> lock(mutex_);	//加锁，保证线程安全
+		std::lock_guard<KCacheMutex> lock(mutex_);	//加锁，保证线程安全
 
 		//先看看要添加的节点的key是否存在
-		auto it = nodeMap_.find(key);
+		auto it = findLive(key);
         if (it != nodeMap_.end())
 		{
 			//如果存在 把该节点的value值改为新节点的value值
-			it->second->value = value;
+			setNodeValue(it->second, value);
 			getInternal(it->second, value);
 			return;
 		}
@@ -141,18 +169,82 @@ public:
 		putInternal(key, value);
 	}
 
-	//获取缓存 接口 value值为传出参数
-    bool get(Key key, Value& value) override
+	// 添加缓存并设置标签(覆盖原有标签)，之后可通过invalidateTag批量删除
+	void put(Key key, Value value, const std::vector<std::string>& tags)
 	{
-		std::lock_guard<std::mutex> lock(mutex_);
-		auto it = nodeMap_.find(key);
+		put(HashedKey(key), value, tags);
+	}
+
+	void put(const HashedKey& key, Value value, const std::vector<std::string>& tags)
+	{
+		if (capacity_ == 0)
+			return;
+		std::lock_guard<KCacheMutex> lock(mutex_);
+		auto it = findLive(key);
 		if (it != nodeMap_.end())
 		{
+			setNodeValue(it->second, value);
 			getInternal(it->second, value);
-			return true;
 		}
+		else
+		{
+			putInternal(key, value);
+		}
+		tagIndex_.set(key.key, tags);
+	}
 
-		return false;
+	//获取缓存 接口 value值为传出参数
+    bool get(Key key, Value& value) override
+	{
+		return get(HashedKey(key), value);
+	}
+
+	bool get(const HashedKey& key, Value& value)
+	{
+		std::lock_guard<KCacheMutex> lock(mutex_);
+		return getLocked(key, value);
+	}
+
+	// 批量获取：只加一次锁。indices为空时获取全部keys，否则只获取其中指定下标的key
+	// values和hits按keys的下标写入(调用方需保证大小与keys一致)，返回命中数
+	size_t getBatch(const std::vector<HashedKey>& keys, std::vector<Value>& values,
+					std::vector<bool>& hits, const std::vector<size_t>* indices = nullptr)
+	{
+		std::lock_guard<KCacheMutex> lock(mutex_);
+		size_t hitCount = 0;
+		size_t count = indices ? indices->size() : keys.size();
+		for (size_t i = 0; i < count; ++i)
+		{
+			size_t index = indices ? (*indices)[i] : i;
+			hits[index] = getLocked(keys[index], values[index]);
+			hitCount += hits[index];
+		}
+		return hitCount;
+	}
+
+	// 批量添加：只加一次锁，indices的含义同getBatch
+	void putBatch(const std::vector<std::pair<HashedKey, Value>>& entries,
+				  const std::vector<size_t>* indices = nullptr)
+	{
+		if (capacity_ == 0)
+			return;
+		std::lock_guard<KCacheMutex> lock(mutex_);
+		size_t count = indices ? indices->size() : entries.size();
+		for (size_t i = 0; i < count; ++i)
+		{
+			const auto& entry = entries[indices ? (*indices)[i] : i];
+			auto it = findLive(entry.first);
+			if (it != nodeMap_.end())
+			{
+				Value value = entry.second;
+				setNodeValue(it->second, value);
+				getInternal(it->second, value);
+			}
+			else
+			{
+				putInternal(entry.first, entry.second);
+			}
+		}
 	}
 
 	// 获取缓存 用返回值接收
@@ -163,23 +255,330 @@ public:
 		return value;
     }
 
-	// 清空缓存,回收资源
-    void purge()
+	// 原子读-改-写：一次加锁、一次查找，访问和写入与get/put一样计入频次
+	uint64_t compute(const Key& key, const typename KICachePolicy<Key, Value>::ComputeFunc& func) override
+	{
+		return compute(HashedKey(key), func);
+	}
+
+	uint64_t compute(const HashedKey& key, const typename KICachePolicy<Key, Value>::ComputeFunc& func)
+	{
+		std::lock_guard<KCacheMutex> lock(mutex_);
+		auto it = findLive(key);
+		if (it != nodeMap_.end())
+		{
+			uint32_t node = it->second;
+			Value value = data_[node].value;
+			switch (func(true, value, data_[node].version))
+			{
+			case KComputeAction::Keep:
+				getInternal(node, value);
+				return data_[node].version;
+			case KComputeAction::Store:
+				setNodeValue(node, value);
+				getInternal(node, value);
+				return data_[node].version;
+			case KComputeAction::Remove:
+				removeInternal(node);
+				return 0;
+			}
+			return 0;
+		}
+
+		Value value{};
+		if (func(false, value, 0) != KComputeAction::Store || capacity_ <= 0)
+			return 0;
+		putInternal(key, value);
+		return versionCounter_;		// 新节点的版本号就是最近分配的版本号
+	}
+
+	// 删除指定元素
+	void remove(Key key)
+	{
+		std::lock_guard<KCacheMutex> lock(mutex_);
+		auto it = nodeMap_.find(HashedKey(key));
+		if (it != nodeMap_.end())
+			removeInternal(it->second);
+	}
+
+	// 删除所有带有tag的节点，返回删除的节点数
+	// 每批最多删除batchSize个节点，批与批之间释放锁，避免长时间阻塞其他请求
+	size_t invalidateTag(const std::string& tag, size_t batchSize = 64)
+	{
+		size_t removed = 0;
+		std::vector<Key> keys;
+		while (true)
+		{
+			std::lock_guard<KCacheMutex> lock(mutex_);
+			tagIndex_.collect(tag, std::max<size_t>(batchSize, 1), keys);
+			if (keys.empty())
+				break;
+			for (const auto& key : keys)
+			{
+				auto it = nodeMap_.find(HashedKey(key));
+				if (it != nodeMap_.end())
+				{
+					if (!isStale(it->second))
+						++removed;	// 只统计真正从缓存中删除的条目，已过期的节点只是顺便回收
+					removeInternal(it->second);
+				}
+				else
+				{
+					tagIndex_.erase(key);	// 节点已不在缓存中，只清理索引
+				}
+			}
+		}
+		return removed;
+	}
+
+	// O(1)清空缓存：现有节点立即不可见，在之后的访问、驱逐或sweepStale中回收
+	void clear() override
+	{
+		std::lock_guard<KCacheMutex> lock(mutex_);
+		generation_.invalidateAll(nodeMap_.size());
+	}
+
+	// 设置key到命名空间的映射(应在插入数据前设置)
+	void setNamespaceFunc(typename KGeneration<Key>::NamespaceFunc func)
+	{
+		std::lock_guard<KCacheMutex> lock(mutex_);
+		generation_.setNamespaceFunc(std::move(func));
+	}
+
+	// O(1)使某个命名空间下的所有节点失效
+	void invalidateNamespace(uint32_t ns)
+	{
+		std::lock_guard<KCacheMutex> lock(mutex_);
+		generation_.invalidateNamespace(ns, nodeMap_.size());
+	}
+
+	// 回收过期节点，每次最多扫描maxBuckets个哈希桶(可由后台线程定期调用)，返回回收数量
+	size_t sweepStale(size_t maxBuckets = 64)
+	{
+		std::lock_guard<KCacheMutex> lock(mutex_);
+		return sweepStaleLocked(maxBuckets);
+	}
+
+	// 进入后台维护模式(见KMaintenanceScheduler)：写入时允许暂时超出容量slack个条目，
+	// 超出容量+slack/2(高水位)时调用wake，由后台的runMaintenance驱逐回容量(低水位)以内
+	void enableBackgroundMaintenance(size_t slack, std::function<void()> wake)
+	{
+		std::lock_guard<KCacheMutex> lock(mutex_);
+		evictionSlack_ = slack;
+		wakeMaintenance_ = std::move(wake);
+		if (capacity_ > 0)
+		{
+			nodeMap_.reserve(capacity_ + slack);
+			meta_.reserve(capacity_ + slack);
+			data_.reserve(capacity_ + slack);
+		}
+	}
+
+	// 后台维护的一步：驱逐超出容量的节点、回收过期节点等，每项最多budget个单位的工作，返回是否还有剩余工作
+	bool runMaintenance(size_t budget)
+	{
+		std::lock_guard<KCacheMutex> lock(mutex_);
+		return maintainLocked(budget);
+	}
+
+	// 设置锁的名字，用于锁竞争统计
+	void setLockName(const std::string& name)
+	{
+		MyCache::setLockName(mutex_, name);
+	}
+
+	// 收集锁竞争统计(需定义MYCACHE_LOCK_PROFILING，否则为空)
+	void collectLockStats(std::vector<KLockStats>& out) const
+	{
+		MyCache::collectLockStats(mutex_, out);
+	}
+
+	// 快照：按访问频次从低到高，同一频次内从旧到新
+	void snapshot(std::vector<std::pair<Key, Value>>& entries) override
+	{
+		std::lock_guard<KCacheMutex> lock(mutex_);
+		std::vector<int> freqs;
+		for (const auto& pair : freqToFreqList_)
+			freqs.push_back(pair.first);
+		std::sort(freqs.begin(), freqs.end());
+		entries.reserve(entries.size() + nodeMap_.size());
+		for (int freq : freqs)
+		{
+			const FreqList& list = freqToFreqList_[freq];
+			for (uint32_t node = list.head; node != kLfuNoNode; node = meta_[node].next)
+			{
+				if (!isStale(node))
+					entries.emplace_back(data_[node].key, data_[node].value);
+			}
+		}
+	}
+
+	// 内存统计：节点中的key/value计为有效数据，元数据数组、数据数组中的其余部分和频次链表计为管理开销
+	KMemoryUsage memoryUsage() override
+	{
+		std::lock_guard<KCacheMutex> lock(mutex_);
+		KMemoryUsage usage;
+		usage.entries = nodeMap_.size();
+		usage.indexBytes = nodeMap_.memoryBytes();
+		usage.payloadBytes = usage.entries * (sizeof(Key) + sizeof(Value));
+		usage.metadataBytes = meta_.capacity() * sizeof(LfuNodeMeta) + data_.capacity() * sizeof(NodeData)
+			- usage.payloadBytes + tagIndex_.memoryBytes() + hashMapBytes(freqToFreqList_);
+		for (const auto& pair : nodeMap_)
+		{
+			usage.indexBytes += heapBytesOf(pair.first.key);
+			usage.payloadBytes += heapBytesOf(data_[pair.second].key) + heapBytesOf(data_[pair.second].value);
+		}
+		return usage;
+	}
+
+	// 批量加载：整批只加一次锁，新节点按输入顺序加入频次为1的链表
+	// 缓存装得下时不会触发淘汰；已存在的key按put的语义更新并计一次访问
+	size_t bulkLoad(const std::vector<std::pair<Key, Value>>& entries) override
+	{
+		std::vector<uint64_t> hashes;
+		hashes.reserve(entries.size());
+		for (const auto& entry : entries)
+			hashes.push_back(HashedKey(entry.first).hash);
+		return bulkLoad(entries, hashes);
+	}
+
+	// 哈希值已由调用方算好(hashes与entries一一对应)，indices的含义同getBatch
+	size_t bulkLoad(const std::vector<std::pair<Key, Value>>& entries, const std::vector<uint64_t>& hashes,
+					const std::vector<size_t>* indices = nullptr)
+	{
+		if (capacity_ <= 0)
+			return 0;
+		size_t count = indices ? indices->size() : entries.size();
+
+		std::lock_guard<KCacheMutex> lock(mutex_);
+		nodeMap_.reserve(std::min(nodeMap_.size() + count, static_cast<size_t>(capacity_)));
+		for (size_t i = 0; i < count; ++i)
+		{
+			size_t index = indices ? (*indices)[i] : i;
+			HashedKey key(entries[index].first, hashes[index]);
+			auto it = findLive(key);
+			if (it != nodeMap_.end())
+			{
+				Value value = entries[index].second;
+				setNodeValue(it->second, value);
+				getInternal(it->second, value);
+			}
+			else
+			{
+				putInternal(key, entries[index].second);
+			}
+		}
+		return count;
+	}
+
+	// 清空缓存并立即回收所有节点和频次链表(O(n))
+    virtual void purge()
     {
-		nodeMap_.clear();
+		std::lock_guard<KCacheMutex> lock(mutex_);
 		freqToFreqList_.clear();
+		nodeMap_.clear();
+		meta_.clear();
+		data_.clear();
+		freeHead_ = kLfuNoNode;
+		tagIndex_ = KTagIndex<Key>();
+		minFreq_ = INT_MAX;
     }
 
-
-
 protected:
-	virtual void putInternal(Key key, Value value); // 添加缓存
-	virtual void getInternal(NodePtr node, Value& value); // 获取缓存
-	
+	virtual void putInternal(const HashedKey& key, Value value); // 添加缓存
+	virtual void linkNewNode(const HashedKey& key, uint32_t node); // 把已分配好的节点加入缓存(添加缓存的一步)
+	virtual void getInternal(uint32_t node, Value& value); // 获取缓存
+
     virtual void kickOut(); // 移除缓存中的过期数据
+	virtual void removeInternal(uint32_t node); // 删除指定节点
+
+	virtual bool maintainLocked(size_t budget); // 后台维护的一步(持有锁)
+	void recomputeMinFreq(); // 重新计算最小频次
+	uint32_t evictionCandidate(); // 下一个要淘汰的节点，没有节点时返回kLfuNoNode
+
+    void removeFromFreqList(uint32_t node); // 从频率列表中移除节点
+    void addToFreqList(uint32_t node); // 把节点添加到对应频率列表(是添加缓存、获取缓存的一步)
+
+	// 查找未过期的节点，找到过期节点时顺便回收
+	typename NodeMap::iterator findLive(const HashedKey& key)
+	{
+		auto it = nodeMap_.find(key);
+		if (it != nodeMap_.end() && isStale(it->second))
+		{
+			removeInternal(it->second);
+			return nodeMap_.end();
+		}
+		return it;
+	}
+
+	bool isStale(uint32_t node) const
+	{
+		return generation_.isStale(meta_[node].ns, meta_[node].gen);
+	}
+
+	size_t sweepStaleLocked(size_t maxBuckets)
+	{
+		return generation_.sweep(nodeMap_, maxBuckets,
+			[this](uint32_t node) { return isStale(node); },
+			[this](const Key& key) { removeInternal(nodeMap_[HashedKey(key)]); });
+	}
+
+	bool getLocked(const HashedKey& key, Value& value)
+	{
+		auto it = findLive(key);
+		if (it != nodeMap_.end())
+		{
+			getInternal(it->second, value);
+			return true;
+		}
+		return false;
+	}
 
-    void removeFromFreqList(NodePtr node); // 从频率列表中移除节点
-    void addToFreqList(NodePtr node); // 把节点添加到对应频率列表(是添加缓存、获取缓存的一步)
+	// 从空闲链表取一个节点(没有则在数组末尾追加)并写入key/value，频次为1
+	uint32_t allocNode(const Key& key, const Value& value)
+	{
+		uint32_t node;
+		if (freeHead_ != kLfuNoNode)
+		{
+			node = freeHead_;
+			freeHead_ = meta_[node].next;
+			data_[node].key = key;
+			data_[node].value = value;
+		}
+		else
+		{
+			node = static_cast<uint32_t>(meta_.size());
+			meta_.emplace_back();
+			data_.push_back(NodeData{key, value});
+		}
+		meta_[node].freq = 1;
+		meta_[node].pre = meta_[node].next = kLfuNoNode;
+		return node;
+	}
+
+	// 节点已从链表、索引中摘除后放回空闲链表，释放value持有的资源
+	void freeNode(uint32_t node)
+	{
+		meta_[node].freq = 0;
+		meta_[node].next = freeHead_;
+		freeHead_ = node;
+		data_[node].key = Key();
+		data_[node].value = Value();
+	}
+
+	// 后台维护模式下唤醒调度器
+	void wakeMaintenance()
+	{
+		if (wakeMaintenance_)
+			wakeMaintenance_();
+	}
+
+	// 修改节点的value并更新版本号
+	void setNodeValue(uint32_t node, const Value& value)
+	{
+		data_[node].value = value;
+		data_[node].version = ++versionCounter_;
+	}
 
 
 
@@ -187,62 +586,109 @@ protected:
 protected:
 	int capacity_;		//缓存容量
 	int minFreq_;		//缓存中现存的最小访问频次(用于找到最小访问频次结点)
-	std::mutex mutex_;	//互斥锁
-	NodeMap nodeMap_;	//key 到缓存节点 的映射    key -> Node
-	std::unordered_map<int, FreqList<Key,Value>*> freqToFreqList_;	// 访问频次 到该频次链表 的映射
+	KCacheMutex mutex_;	//互斥锁
+	std::vector<LfuNodeMeta> meta_;	// 节点元数据(热数据)
+	std::vector<NodeData> data_;	// 节点的key/value(冷数据)，与meta_下标一一对应
+	uint32_t freeHead_;	// 空闲节点链表
+	NodeMap nodeMap_;	//key 到缓存节点下标 的映射    key -> node
+	std::unordered_map<int, FreqList> freqToFreqList_;	// 访问频次 到该频次链表 的映射
+	KTagIndex<Key> tagIndex_;	// 标签索引：tag -> key
+	KGeneration<Key> generation_;	// 代数：O(1)清空和命名空间失效
+	uint64_t versionCounter_;	// 版本号计数器
+	size_t evictionSlack_;	// 后台维护模式下允许超出容量的条目数
+	std::function<void()> wakeMaintenance_;	// 需要后台维护时唤醒调度器
+	bool maintenanceSignaled_;	// 本次超出容量后是否已唤醒过
+
+	static constexpr size_t kEvictSweepBuckets = 8;	// 驱逐前顺带回收过期节点时扫描的桶数
 };
 
 
 // 把节点添加到对应频率列表 (是添加缓存、获取缓存的其中一步)
 template<typename Key, typename Value>
-void KLfuCache<Key, Value>::addToFreqList(NodePtr node)
+void KLfuCache<Key, Value>::addToFreqList(uint32_t node)
 {
-	//检查是否是空节点
-	if(!node)
-		return;
-
-	// 添加进入相应的频次链表前需要判断该频次链表是否存在
-	if(freqToFreqList_.find(node->freq) == freqToFreqList_.end())
-	{
-		//如果不存在，先建立频次链表
-		freqToFreqList_[node->freq] = new FreqList<Key, Value>(node->freq);
-	}
-
-	freqToFreqList_[node->freq]->addNode(node);
+	// 频次链表不存在时operator[]会先建立一个空链表
+	freqToFreqList_[meta_[node].freq].addNode(meta_, node);
 }
 
 // 从某一节点的频率列表中移除该节点
 template<typename Key, typename Value>
-void KLfuCache<Key, Value>::removeFromFreqList(NodePtr node)
+void KLfuCache<Key, Value>::removeFromFreqList(uint32_t node)
 {
-	if(!node)
-		return;
-	freqToFreqList_[node->freq]->removeNode(node);
+	freqToFreqList_[meta_[node].freq].removeNode(meta_, node);
 };
 
 // 移除缓存中的最不常使用的数据 (是添加缓存操作的一步)
 template<typename Key, typename Value>
 void KLfuCache<Key, Value>::kickOut()
 {
-	NodePtr node = freqToFreqList_[minFreq_]->getFirstNode();	//获取最低频次列表中最久未使用的节点指针
+	uint32_t node = evictionCandidate();	//获取最低频次列表中最久未使用的节点
+	if (node == kLfuNoNode)
+		return;
+	MYCACHE_TRACE_INSTANT(Evict, "KLfuCache", meta_[node].freq);
+	if (!isStale(node))
+		this->notifyEvicted(data_[node].key, data_[node].value);
 	removeFromFreqList(node);	//从该节点的频率列表中移除该节点
-	nodeMap_.erase(node->key);	//从map中移除该节点
-	//decreaseFreqNum(node->freq);
+	tagIndex_.erase(data_[node].key);	//从标签索引中移除
+	nodeMap_.erase(HashedKey(data_[node].key, meta_[node].hash));	//从map中移除该节点(使用节点保存的哈希值)
+	freeNode(node);
+}
+
+// 删除指定节点 (kickOut总是删除最小频次链表的首节点，这里可能删除任意节点，需要重新计算最小频次)
+template<typename Key, typename Value>
+void KLfuCache<Key, Value>::removeInternal(uint32_t node)
+{
+	int freq = meta_[node].freq;
+	removeFromFreqList(node);
+	tagIndex_.erase(data_[node].key);
+	nodeMap_.erase(HashedKey(data_[node].key, meta_[node].hash));
+	freeNode(node);
+
+	if (freq == minFreq_ && freqToFreqList_[minFreq_].isEmpty())
+		recomputeMinFreq();
+}
+
+// 重新计算最小频次(缓存为空时为INT_MAX)
+template<typename Key, typename Value>
+void KLfuCache<Key, Value>::recomputeMinFreq()
+{
+	minFreq_ = INT_MAX;
+	for (const auto& pair : freqToFreqList_)
+	{
+		if (!pair.second.isEmpty())
+			minFreq_ = std::min(minFreq_, pair.first);
+	}
+}
+
+// 最小频次链表的首节点；连续驱逐可能把最小频次链表取空，这时先重新计算最小频次
+template<typename Key, typename Value>
+uint32_t KLfuCache<Key, Value>::evictionCandidate()
+{
+	auto it = freqToFreqList_.find(minFreq_);
+	if (it == freqToFreqList_.end() || it->second.isEmpty())
+	{
+		recomputeMinFreq();
+		it = freqToFreqList_.find(minFreq_);
+		if (it == freqToFreqList_.end())
+			return kLfuNoNode;
+	}
+	return it->second.getFirstNode();
 }
 
 //获取缓存
 template<typename Key, typename Value>
-void KLfuCache<Key, Value>::getInternal(NodePtr node, Value& value)
+void KLfuCache<Key, Value>::getInternal(uint32_t node, Value& value)
 {
 	// 找到之后需要将其从低访问频次的链表中删除，并且添加到+1的访问频次链表中，
     // 访问频次+1, 然后把value值返回
-    value = node->value;
+    value = data_[node].value;
 	removeFromFreqList(node);
-	node->freq++;
+	meta_[node].freq++;
 	addToFreqList(node);
 	// 如果当前node的访问频次如果等于minFreq+1，并且其前驱链表为空，则说明
-    // freqToFreqList_[node->freq - 1]链表因node的迁移已经空了，需要更新最小访问频次
-    if (node->freq - 1 == minFreq_ && freqToFreqList_[node->freq - 1]->isEmpty())
+    // freqToFreqList_[freq - 1]链表因node的迁移已经空了，需要更新最小访问频次
+	int freq = meta_[node].freq;
+    if (freq - 1 == minFreq_ && freqToFreqList_[freq - 1].isEmpty())
         minFreq_++;
 
 	// 总访问频次和当前平均访问频次都随之增加
@@ -251,16 +697,53 @@ void KLfuCache<Key, Value>::getInternal(NodePtr node, Value& value)
 
 //添加缓存
 template<typename Key, typename Value>
-void KLfuCache<Key, Value>::putInternal(Key key, Value value)
+void KLfuCache<Key, Value>::putInternal(const HashedKey& key, Value value)
 {
-	//如果缓存满了，就驱逐一个缓存中最不常用的数据
-	if(nodeMap_.size() == capacity_)
+	//缓存满了先尝试回收过期节点，仍然满就驱逐一个缓存中最不常用的数据(先腾出节点再分配)
+	//后台维护模式下到达容量+余量(硬上限)才内联驱逐，超出容量的部分由后台驱逐
+	size_t limit = capacity_ + evictionSlack_;
+	if(nodeMap_.size() >= limit && generation_.hasStale())
+		sweepStaleLocked(kEvictSweepBuckets);
+	if(nodeMap_.size() >= limit)
 		kickOut();
-	
-	// 创建新结点，将新结点添加进入，更新最小访问频次
-    NodePtr node = std::make_shared<Node>(key, value);
+	linkNewNode(key, allocNode(key.key, value));
+	if(wakeMaintenance_ && !maintenanceSignaled_ && nodeMap_.size() > capacity_ + evictionSlack_ / 2)
+	{
+		maintenanceSignaled_ = true;	// 超过高水位(容量+余量的一半)：唤醒一次，驱逐回容量后才会再次唤醒
+		wakeMaintenance_();
+	}
+}
+
+// 后台维护：驱逐回容量以内，再回收一部分过期节点
+template<typename Key, typename Value>
+bool KLfuCache<Key, Value>::maintainLocked(size_t budget)
+{
+	size_t limit = static_cast<size_t>(std::max(capacity_, 0));
+	for (size_t i = 0; i < budget && nodeMap_.size() > limit; ++i)
+	{
+		size_t before = nodeMap_.size();
+		kickOut();
+		if (nodeMap_.size() == before)
+			break;	// 频次链表中已没有可淘汰的节点
+	}
+	if (nodeMap_.size() <= limit)
+		maintenanceSignaled_ = false;
+	if (generation_.hasStale())
+		sweepStaleLocked(budget);
+	return nodeMap_.size() > limit || generation_.hasStale();
+}
+
+// 把已分配好的节点加入缓存
+template<typename Key, typename Value>
+void KLfuCache<Key, Value>::linkNewNode(const HashedKey& key, uint32_t node)
+{
+	// 将新结点添加进入，更新最小访问频次
+	meta_[node].ns = generation_.namespaceOf(key.key);
+	meta_[node].gen = generation_.current();
+	meta_[node].hash = key.hash;
+	data_[node].version = ++versionCounter_;
 	//将节点添加至map和该节点相对应的频率链表(频率已被初始化为1)
-	nodeMap_[key] = node;
+	nodeMap_.emplace(key, node);
 	addToFreqList(node);
 	//addFreqNum();
 	minFreq_ = std::min(minFreq_,1);
@@ -277,37 +760,87 @@ template <typename Key, typename Value>
 class KLfuAgingCache : public KLfuCache<Key, Value>
 {
 public:
-	using Node = typename FreqList<Key, Value>::Node;
-    using NodePtr = std::shared_ptr<Node>;
-    using NodeMap = std::unordered_map<Key, NodePtr>;
+    using HashedKey = KHashedKey<Key>;
+    using NodeMap = typename KLfuCache<Key, Value>::NodeMap;
     // 构造函数需要额外接收 maxAverageNum 参数
     KLfuAgingCache(int capacity, int maxAverageNum)
         : KLfuCache<Key, Value>(capacity),  // 调用基类构造函数
           maxAverageNum_(maxAverageNum),
           curTotalNum_(0),
-          curAverageNum_(0) {}
+          curAverageNum_(0),
+          agingPending_(false),
+          agingCursor_(0),
+          agingDecrease_(0)
+    {
+        this->setLockName("KLfuAgingCache");
+    }
+
+    // 运行时调整最大平均访问次数(供自动调参使用)
+    void setMaxAverageNum(int maxAverageNum)
+    {
+        std::lock_guard<KCacheMutex> lock(this->mutex_);
+        maxAverageNum_ = std::max(maxAverageNum, 1);
+        if (curAverageNum_ > maxAverageNum_)
+            handleOverMaxAverageNum();
+    }
+
+    int getMaxAverageNum()
+    {
+        std::lock_guard<KCacheMutex> lock(this->mutex_);
+        return maxAverageNum_;
+    }
+
+    // 清空后访问次数统计归零
+    void purge() override
+    {
+        KLfuCache<Key, Value>::purge();
+        std::lock_guard<KCacheMutex> lock(this->mutex_);
+        curTotalNum_ = 0;
+        curAverageNum_ = 0;
+        agingPending_ = false;
+    }
 
 protected:	//重写父类部分方法
     // 覆盖基类的 获取缓存方法，添加频率统计逻辑
-    void getInternal(typename KLfuCache<Key, Value>::NodePtr node, Value& value) override
+    void getInternal(uint32_t node, Value& value) override
 	{
         KLfuCache<Key, Value>::getInternal(node, value);
         addFreqNum();	// 更新访问次数统计
     }
 
-    // 覆盖基类的 添加缓存方法，添加频率统计逻辑
-    void putInternal(Key key, Value value) override
+    // 覆盖基类的 添加缓存方法，添加频率统计逻辑(put和批量加载都经过这里)
+    void linkNewNode(const HashedKey& key, uint32_t node) override
 	{
-        KLfuCache<Key, Value>::putInternal(key, value);  
+        KLfuCache<Key, Value>::linkNewNode(key, node);
         addFreqNum();	// 更新访问次数统计
     }
 
     // 覆盖淘汰逻辑，减少总访问次数
     void kickOut() override
 	{
-        auto node = this->freqToFreqList_[this->minFreq_]->getFirstNode();	// 先复制一份要淘汰的节点
+        uint32_t node = this->evictionCandidate();
+        if (node == kLfuNoNode)
+            return;
+        int freq = this->meta_[node].freq;	// 先记下要淘汰节点的频次，淘汰后节点会被回收
         KLfuCache<Key, Value>::kickOut();	//移除该节点
-        decreaseFreqNum(node->freq);		// 减少总访问次数（优化新增逻辑）
+        decreaseFreqNum(freq);		// 减少总访问次数（优化新增逻辑）
+    }
+
+    // 覆盖删除逻辑，减少总访问次数
+    void removeInternal(uint32_t node) override
+	{
+        int freq = this->meta_[node].freq;
+        KLfuCache<Key, Value>::removeInternal(node);
+        decreaseFreqNum(freq);
+    }
+
+    // 后台维护模式下老化也在这里分步完成
+    bool maintainLocked(size_t budget) override
+    {
+        bool pending = KLfuCache<Key, Value>::maintainLocked(budget);
+        if (agingPending_ && agingStep(budget))
+            pending = true;
+        return pending;
     }
 
 private:
@@ -315,57 +848,69 @@ private:
     void decreaseFreqNum(int num); // 减少平均访问等频率
     void handleOverMaxAverageNum(); // 处理当前平均访问频率超过上限的情况
     void updateMinFreq();
+    bool agingStep(size_t budget); // 分步老化：处理budget个节点，返回是否还有剩余
 
 private:
     int maxAverageNum_;  // 最大允许的平均访问次数
     int curTotalNum_;    // 总访问次数
     int curAverageNum_;  // 当前平均访问次数
+    bool agingPending_;     // 后台维护模式下是否有未完成的老化
+    size_t agingCursor_;    // 分步老化处理到的节点下标
+    int agingDecrease_;     // 本轮老化每个节点降低的频次
 };
 
 
 // 重新计算最小频次
 template<typename Key, typename Value>
-void KLfuAgingCache<Key, Value>::updateMinFreq() 
+void KLfuAgingCache<Key, Value>::updateMinFreq()
 {
-	this->minFreq_ = INT8_MAX;
-	for (const auto& pair : this->freqToFreqList_) 
+	this->minFreq_ = INT_MAX;
+	for (const auto& pair : this->freqToFreqList_)
 	{
-		if(pair.second && !pair.second->isEmpty())	//该频次的链表存在，且不为空
+		if(!pair.second.isEmpty())	//该频次的链表不为空
 		{
 			this->minFreq_ = std::min(this->minFreq_, pair.first);
 		}
 	}
-	if (this->minFreq_ == INT8_MAX) 
+	if (this->minFreq_ == INT_MAX)
 		this->minFreq_ = 1;
 }
 
 // 处理超过最大平均访问次数的情况
+// 所有节点的频次减去同一个值，同一频次的节点降频后仍在同一频次，所以按频次从低到高把整条链表接到新频次的链表上(O(1))，
+// 再顺序扫一遍元数据数组修改每个节点的频次，整个过程不访问key/value
 template<typename Key, typename Value>
 void KLfuAgingCache<Key, Value>::handleOverMaxAverageNum()
 {
 	if(this->nodeMap_.empty())
 		return;
-	
-	//遍历所有节点，降低其频次
-	for(auto it = this->nodeMap_.begin(); it != this->nodeMap_.end(); it++)
+	MYCACHE_TRACE_SCOPE(Aging, "KLfuAgingCache", this->nodeMap_.size());
+
+	int decrease = maxAverageNum_ / 2;
+	std::vector<int> freqs;
+	for (const auto& pair : this->freqToFreqList_)
 	{
-		// 检查结点是否为空
-        if (!it->second)
-            continue;
-		
-		NodePtr node = it->second;
+		if (!pair.second.isEmpty())
+			freqs.push_back(pair.first);
+	}
+	std::sort(freqs.begin(), freqs.end());
 
-		// 先从当前频次列表中移除
-		this->removeFromFreqList(node);
+	// 低频的链表先接入，合并后仍排在前面先被淘汰
+	std::unordered_map<int, FreqList> aged;
+	for (int freq : freqs)
+		aged[std::max(freq - decrease, 1)].splice(this->meta_, this->freqToFreqList_[freq]);
+	this->freqToFreqList_.swap(aged);
 
-		// 减少频次
-		node->freq -= maxAverageNum_/2;
-		if(node->freq < 1)
-			node->freq = 1;
-		
-		//添加到新对应的频次链表
-		this->addToFreqList(node);
+	// 降低频次，并重新统计总访问次数(否则平均值仍超过上限，之后每次访问都会再次触发)
+	curTotalNum_ = 0;
+	for (LfuNodeMeta& meta : this->meta_)
+	{
+		if (meta.freq == 0)
+			continue;	// 空闲节点
+		meta.freq = std::max(meta.freq - decrease, 1);
+		curTotalNum_ += meta.freq;
 	}
+	curAverageNum_ = curTotalNum_ / static_cast<int>(this->nodeMap_.size());
 
 	//更新最小频次
 	updateMinFreq();
@@ -381,13 +926,51 @@ void KLfuAgingCache<Key, Value>::addFreqNum()
 	else
 		curAverageNum_ = curTotalNum_ / this->nodeMap_.size();
 	
-	// 若超过阈值，触发全局降频
+	// 若超过阈值，触发全局降频；后台维护模式下只记下待老化，由后台分步完成
 	if(curAverageNum_ > maxAverageNum_)
 	{
-		handleOverMaxAverageNum();
+		if (!this->wakeMaintenance_)
+		{
+			handleOverMaxAverageNum();
+		}
+		else if (!agingPending_)
+		{
+			agingPending_ = true;
+			agingCursor_ = 0;
+			agingDecrease_ = maxAverageNum_ / 2;
+			this->wakeMaintenance();
+		}
 	}
 }
 
+// 分步老化：按下标顺序逐个把节点移到降频后的链表，每步之间缓存始终一致(只是部分节点已老化)
+// 本轮开始后新加入的节点频次为1，不受影响；不能像handleOverMaxAverageNum那样整条链表拼接，
+// 因为两步之间链表会被前台修改
+template<typename Key, typename Value>
+bool KLfuAgingCache<Key, Value>::agingStep(size_t budget)
+{
+	MYCACHE_TRACE_SCOPE(Aging, "KLfuAgingCache", budget);
+	size_t end = std::min(this->meta_.size(), agingCursor_ + budget);
+	for (size_t i = agingCursor_; i < end; ++i)
+	{
+		int freq = this->meta_[i].freq;
+		if (freq <= 1)
+			continue;	// 空闲节点或已是最低频次
+		int aged = std::max(freq - agingDecrease_, 1);
+		this->removeFromFreqList(static_cast<uint32_t>(i));
+		this->meta_[i].freq = aged;
+		this->addToFreqList(static_cast<uint32_t>(i));
+		curTotalNum_ -= freq - aged;
+	}
+	agingCursor_ = end;
+	if (agingCursor_ >= this->meta_.size())
+		agingPending_ = false;
+
+	curAverageNum_ = this->nodeMap_.empty() ? 0 : curTotalNum_ / static_cast<int>(this->nodeMap_.size());
+	updateMinFreq();
+	return agingPending_;
+}
+
 // 减少总访问次数（当节点被淘汰时调用）
 template<typename Key, typename Value>
 void KLfuAgingCache<Key, Value>::decreaseFreqNum(int num)
@@ -421,21 +1004,31 @@ public:
         for (int i = 0; i < sliceNum_; ++i)
         {
             lfuSliceCaches_.emplace_back(new KLfuAgingCache<Key, Value>(sliceSize, maxAverageNum));
+            lfuSliceCaches_.back()->setLockName("KHashLfuCache[" + std::to_string(i) + "]");
         }
     }
 
+    using HashedKey = KHashedKey<Key>;
+
     void put(Key key, Value value)
     {
-        // 根据key找出对应的lfu分片
-        size_t sliceIndex = Hash(key) % sliceNum_;
-        return lfuSliceCaches_[sliceIndex]->put(key, value);
+        put(HashedKey(key), value);
+    }
+
+    // key的哈希值只计算一次：高位选择分片，分片内的哈希表直接使用同一个哈希值
+    void put(const HashedKey& key, Value value)
+    {
+        lfuSliceCaches_[sliceOf(key)]->put(key, value);
     }
 
     bool get(Key key, Value& value)
     {
-        // 根据key找出对应的lfu分片
-        size_t sliceIndex = Hash(key) % sliceNum_;
-        return lfuSliceCaches_[sliceIndex]->get(key, value);
+        return get(HashedKey(key), value);
+    }
+
+    bool get(const HashedKey& key, Value& value)
+    {
+        return lfuSliceCaches_[sliceOf(key)]->get(key, value);
     }
 
     Value get(Key key)
@@ -445,6 +1038,99 @@ public:
         return value;
     }
 
+    uint64_t compute(const Key& key, const typename KICachePolicy<Key, Value>::ComputeFunc& func) override
+    {
+        HashedKey hashedKey(key);
+        return lfuSliceCaches_[sliceOf(hashedKey)]->compute(hashedKey, func);
+    }
+
+    // 批量获取(哈希值已预先算好)：按分片分组，每个分片只加一次锁
+    // values和hits会被调整为与keys相同的大小，返回命中数
+    size_t getBatch(const std::vector<HashedKey>& keys, std::vector<Value>& values, std::vector<bool>& hits)
+    {
+        values.assign(keys.size(), Value{});
+        hits.assign(keys.size(), false);
+        std::vector<std::vector<size_t>> groups(sliceNum_);
+        for (size_t i = 0; i < keys.size(); ++i)
+            groups[sliceOf(keys[i])].push_back(i);
+
+        size_t hitCount = 0;
+        for (int i = 0; i < sliceNum_; ++i)
+        {
+            if (!groups[i].empty())
+                hitCount += lfuSliceCaches_[i]->getBatch(keys, values, hits, &groups[i]);
+        }
+        return hitCount;
+    }
+
+    // 批量添加(哈希值已预先算好)：按分片分组，每个分片只加一次锁
+    void putBatch(const std::vector<std::pair<HashedKey, Value>>& entries)
+    {
+        std::vector<std::vector<size_t>> groups(sliceNum_);
+        for (size_t i = 0; i < entries.size(); ++i)
+            groups[sliceOf(entries[i].first)].push_back(i);
+
+        for (int i = 0; i < sliceNum_; ++i)
+        {
+            if (!groups[i].empty())
+                lfuSliceCaches_[i]->putBatch(entries, &groups[i]);
+        }
+    }
+
+    // 批量加载：按分片分组，每个分片只加一次锁
+    size_t bulkLoad(const std::vector<std::pair<Key, Value>>& entries) override
+    {
+        std::vector<uint64_t> hashes;
+        hashes.reserve(entries.size());
+        std::vector<std::vector<size_t>> groups(sliceNum_);
+        for (size_t i = 0; i < entries.size(); ++i)
+        {
+            HashedKey hashedKey(entries[i].first);
+            hashes.push_back(hashedKey.hash);
+            groups[sliceOf(hashedKey)].push_back(i);
+        }
+
+        size_t loaded = 0;
+        for (int i = 0; i < sliceNum_; ++i)
+        {
+            if (!groups[i].empty())
+                loaded += lfuSliceCaches_[i]->bulkLoad(entries, hashes, &groups[i]);
+        }
+        return loaded;
+    }
+
+    // 添加带标签的缓存
+    void put(Key key, Value value, const std::vector<std::string>& tags)
+    {
+        HashedKey hashedKey(key);
+        lfuSliceCaches_[sliceOf(hashedKey)]->put(hashedKey, value, tags);
+    }
+
+    // 在所有分片中删除带有tag的节点，各分片按批删除，同一时刻只持有一个分片的锁
+    size_t invalidateTag(const std::string& tag, size_t batchSize = 64)
+    {
+        size_t removed = 0;
+        for (auto& lfuSliceCache : lfuSliceCaches_)
+        {
+            removed += lfuSliceCache->invalidateTag(tag, batchSize);
+        }
+        return removed;
+    }
+
+    // 调整所有分片的最大平均访问次数
+    void setMaxAverageNum(int maxAverageNum)
+    {
+        for (auto& lfuSliceCache : lfuSliceCaches_)
+        {
+            lfuSliceCache->setMaxAverageNum(maxAverageNum);
+        }
+    }
+
+    int getMaxAverageNum()
+    {
+        return lfuSliceCaches_.front()->getMaxAverageNum();
+    }
+
     // 清除缓存
     void purge()
     {
@@ -454,12 +1140,125 @@ public:
         }
     }
 
+    // 清空所有分片(每个分片O(1))
+    void clear() override
+    {
+        for (auto& lfuSliceCache : lfuSliceCaches_)
+        {
+            lfuSliceCache->clear();
+        }
+    }
+
+    // 每个分片使用同一个淘汰监听，listener可能被不同分片并发调用
+    void setEvictionListener(typename KICachePolicy<Key, Value>::EvictionListener listener) override
+    {
+        for (auto& lfuSliceCache : lfuSliceCaches_)
+        {
+            lfuSliceCache->setEvictionListener(listener);
+        }
+    }
+
+    void setNamespaceFunc(typename KGeneration<Key>::NamespaceFunc func)
+    {
+        for (auto& lfuSliceCache : lfuSliceCaches_)
+        {
+            lfuSliceCache->setNamespaceFunc(func);
+        }
+    }
+
+    void invalidateNamespace(uint32_t ns)
+    {
+        for (auto& lfuSliceCache : lfuSliceCaches_)
+        {
+            lfuSliceCache->invalidateNamespace(ns);
+        }
+    }
+
+    // 依次回收各分片的过期节点
+    size_t sweepStale(size_t maxBucketsPerSlice = 64)
+    {
+        size_t reclaimed = 0;
+        for (auto& lfuSliceCache : lfuSliceCaches_)
+        {
+            reclaimed += lfuSliceCache->sweepStale(maxBucketsPerSlice);
+        }
+        return reclaimed;
+    }
+
+    // 各分片进入后台维护模式，余量平均分给各分片
+    void enableBackgroundMaintenance(size_t slack, std::function<void()> wake)
+    {
+        size_t sliceSlack = (slack + sliceNum_ - 1) / sliceNum_;
+        for (auto& lfuSliceCache : lfuSliceCaches_)
+        {
+            lfuSliceCache->enableBackgroundMaintenance(sliceSlack, wake);
+        }
+    }
+
+    // 依次维护各分片，每个分片最多budget个单位的工作
+    bool runMaintenance(size_t budget)
+    {
+        bool pending = false;
+        for (auto& lfuSliceCache : lfuSliceCaches_)
+        {
+            if (lfuSliceCache->runMaintenance(budget))
+                pending = true;
+        }
+        return pending;
+    }
+
+    // 各分片锁的竞争统计
+    void collectLockStats(std::vector<KLockStats>& out) const
+    {
+        for (const auto& lfuSliceCache : lfuSliceCaches_)
+        {
+            lfuSliceCache->collectLockStats(out);
+        }
+    }
+
+    // 竞争最激烈的前n个分片
+    std::vector<KLockStats> topContendedShards(size_t n) const
+    {
+        std::vector<KLockStats> stats;
+        collectLockStats(stats);
+        return topContendedLocks(std::move(stats), n);
+    }
+
+    // 依次复制各分片
+    void snapshot(std::vector<std::pair<Key, Value>>& entries) override
+    {
+        for (auto& lfuSliceCache : lfuSliceCaches_)
+        {
+            lfuSliceCache->snapshot(entries);
+        }
+    }
+
+    // 各分片的内存统计
+    std::vector<KMemoryUsage> shardMemoryUsage()
+    {
+        std::vector<KMemoryUsage> usages;
+        for (auto& lfuSliceCache : lfuSliceCaches_)
+        {
+            usages.push_back(lfuSliceCache->memoryUsage());
+        }
+        return usages;
+    }
+
+    KMemoryUsage memoryUsage() override
+    {
+        KMemoryUsage usage;
+        for (const auto& shard : shardMemoryUsage())
+        {
+            usage += shard;
+        }
+        return usage;
+    }
+
 private:
-    // 将key计算成对应哈希值
-    size_t Hash(Key key)
+    // 由哈希值的高位计算分片索引
+    size_t sliceOf(const HashedKey& key) const
     {
-        std::hash<Key> hashFunc;
-        return hashFunc(key);
+        return key.shardOf(sliceNum_);
     }
 
 private:
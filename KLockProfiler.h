@@ -0,0 +1,202 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "KEventTrace.h"
+
+namespace MyCache
+{
+
+// 锁竞争分析
+// 定义 MYCACHE_LOCK_PROFILING 后，库中所有缓存的互斥锁都换成KProfiledMutex，
+// 按锁实例统计加锁次数、发生竞争的次数、等待时间和持有时间分布；
+// 未定义时KCacheMutex就是std::mutex，没有任何额外开销
+// 开启事件追踪(MYCACHE_EVENT_TRACING)时同样使用KProfiledMutex，以便记录锁等待事件
+
+
+// 按2的幂划分的耗时直方图，第i个桶统计 [2^i, 2^(i+1)) 纳秒
+constexpr size_t kLockHistogramBuckets = 32;
+using KLockHistogram = std::array<uint64_t, kLockHistogramBuckets>;
+
+// 单个锁的统计快照
+struct KLockStats
+{
+    std::string     name;               // 锁的名字(所属缓存/分片)
+    uint64_t        acquisitions = 0;   // 加锁次数
+    uint64_t        contended = 0;      // 需要等待的加锁次数
+    uint64_t        totalWaitNs = 0;    // 总等待时间
+    uint64_t        totalHoldNs = 0;    // 总持有时间
+    uint64_t        maxWaitNs = 0;      // 最长一次等待
+    KLockHistogram  waitHistogram{};    // 等待时间分布(只统计发生竞争的加锁)
+    KLockHistogram  holdHistogram{};    // 持有时间分布
+
+    double contentionRate() const
+    {
+        return acquisitions == 0 ? 0.0 : static_cast<double>(contended) / acquisitions;
+    }
+};
+
+
+// 带统计的互斥锁，满足Lockable要求，可直接用于std::lock_guard
+class KProfiledMutex
+{
+public:
+    KProfiledMutex() = default;
+    KProfiledMutex(const KProfiledMutex&) = delete;
+    KProfiledMutex& operator=(const KProfiledMutex&) = delete;
+
+    void lock()
+    {
+        if (!mutex_.try_lock())
+        {
+            // 发生竞争才计时，无竞争时只多一次try_lock
+            auto start = Clock::now();
+#ifdef MYCACHE_EVENT_TRACING
+            uint64_t startTsc = readTsc();
+#endif
+            mutex_.lock();
+            uint64_t waitNs = elapsedNs(start);
+            MYCACHE_TRACE_SPAN(LockWait, "mutex", startTsc, readTsc() - startTsc,
+                               reinterpret_cast<uintptr_t>(this));
+            contended_.fetch_add(1, std::memory_order_relaxed);
+            totalWaitNs_.fetch_add(waitNs, std::memory_order_relaxed);
+            waitHistogram_[bucketOf(waitNs)].fetch_add(1, std::memory_order_relaxed);
+            uint64_t maxWait = maxWaitNs_.load(std::memory_order_relaxed);
+            while (waitNs > maxWait && !maxWaitNs_.compare_exchange_weak(maxWait, waitNs, std::memory_order_relaxed))
+            {}
+        }
+        onAcquired();
+    }
+
+    bool try_lock()
+    {
+        if (!mutex_.try_lock())
+            return false;
+        onAcquired();
+        return true;
+    }
+
+    void unlock()
+    {
+        uint64_t holdNs = elapsedNs(holdStart_);    // 持锁期间只有本线程会写holdStart_
+        totalHoldNs_.fetch_add(holdNs, std::memory_order_relaxed);
+        holdHistogram_[bucketOf(holdNs)].fetch_add(1, std::memory_order_relaxed);
+        mutex_.unlock();
+    }
+
+    void setName(std::string name)
+    {
+        std::lock_guard<std::mutex> lock(nameMutex_);
+        name_ = std::move(name);
+    }
+
+    KLockStats stats() const
+    {
+        KLockStats stats;
+        {
+            std::lock_guard<std::mutex> lock(nameMutex_);
+            stats.name = name_;
+        }
+        stats.acquisitions = acquisitions_.load(std::memory_order_relaxed);
+        stats.contended = contended_.load(std::memory_order_relaxed);
+        stats.totalWaitNs = totalWaitNs_.load(std::memory_order_relaxed);
+        stats.totalHoldNs = totalHoldNs_.load(std::memory_order_relaxed);
+        stats.maxWaitNs = maxWaitNs_.load(std::memory_order_relaxed);
+        for (size_t i = 0; i < kLockHistogramBuckets; ++i)
+        {
+            stats.waitHistogram[i] = waitHistogram_[i].load(std::memory_order_relaxed);
+            stats.holdHistogram[i] = holdHistogram_[i].load(std::memory_order_relaxed);
+        }
+        return stats;
+    }
+
+    void resetStats()
+    {
+        acquisitions_ = 0;
+        contended_ = 0;
+        totalWaitNs_ = 0;
+        totalHoldNs_ = 0;
+        maxWaitNs_ = 0;
+        for (size_t i = 0; i < kLockHistogramBuckets; ++i)
+        {
+            waitHistogram_[i] = 0;
+            holdHistogram_[i] = 0;
+        }
+    }
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    void onAcquired()
+    {
+        acquisitions_.fetch_add(1, std::memory_order_relaxed);
+        holdStart_ = Clock::now();
+    }
+
+    static uint64_t elapsedNs(Clock::time_point start)
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+    }
+
+    static size_t bucketOf(uint64_t ns)
+    {
+        size_t bucket = 0;
+        while (ns > 1 && bucket + 1 < kLockHistogramBuckets)
+        {
+            ns >>= 1;
+            ++bucket;
+        }
+        return bucket;
+    }
+
+private:
+    std::mutex              mutex_;         // 实际的锁
+    Clock::time_point       holdStart_;     // 本次加锁成功的时间
+    std::atomic<uint64_t>   acquisitions_{0};
+    std::atomic<uint64_t>   contended_{0};
+    std::atomic<uint64_t>   totalWaitNs_{0};
+    std::atomic<uint64_t>   totalHoldNs_{0};
+    std::atomic<uint64_t>   maxWaitNs_{0};
+    std::array<std::atomic<uint64_t>, kLockHistogramBuckets> waitHistogram_{};
+    std::array<std::atomic<uint64_t>, kLockHistogramBuckets> holdHistogram_{};
+    mutable std::mutex      nameMutex_;
+    std::string             name_;
+};
+
+
+#if defined(MYCACHE_LOCK_PROFILING) || defined(MYCACHE_EVENT_TRACING)
+using KCacheMutex = KProfiledMutex;
+#else
+using KCacheMutex = std::mutex;
+#endif
+
+// 以下重载让缓存无需关心锁是否开启了统计
+
+inline void setLockName(std::mutex&, const std::string&) {}
+inline void setLockName(KProfiledMutex& mutex, const std::string& name) { mutex.setName(name); }
+
+inline void collectLockStats(const std::mutex&, std::vector<KLockStats>&) {}
+inline void collectLockStats(const KProfiledMutex& mutex, std::vector<KLockStats>& out)
+{
+    out.push_back(mutex.stats());
+}
+
+// 取竞争次数最多的前n个锁(如竞争最激烈的分片)
+inline std::vector<KLockStats> topContendedLocks(std::vector<KLockStats> stats, size_t n)
+{
+    std::sort(stats.begin(), stats.end(), [](const KLockStats& a, const KLockStats& b) {
+        return a.contended != b.contended ? a.contended > b.contended : a.totalWaitNs > b.totalWaitNs;
+    });
+    if (stats.size() > n)
+        stats.resize(n);
+    return stats;
+}
+
+} // namespace MyCache
@@ -1,12 +1,23 @@
 #pragma once 
 
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
 #include <cstring>
 #include <list>
 #include <memory>
 #include <mutex>
+#include <string>
+#include <thread>
 #include <unordered_map>
+#include <vector>
 
+#include "KGeneration.h"
+#include "KHashedKey.h"
 #include "KICachePolicy.h"
+#include "KIncrementalHashMap.h"
+#include "KLockProfiler.h"
+#include "KTagIndex.h"
 
 namespace MyCache
 {
@@ -20,19 +31,28 @@ template<typename Key, typename Value>
 class LruNode 
 {
 private:
-    Key key_;
-    Value value_;
-    size_t accessCount_;  // 访问次数
+    // 链表指针、哈希值等元数据放在前面，与shared_ptr控制块相邻：移动/摘除节点时只访问这一段，不读后面的key/value
     std::shared_ptr<LruNode<Key, Value>> prev_;     //前节点指针(智能指针)
     std::shared_ptr<LruNode<Key, Value>> next_;     //后节点指针
+    uint64_t hash_;       // key的哈希值，驱逐时无需重新计算
+    uint64_t generation_; // 插入时的代数，低于缓存的代数下限即为过期节点
+    uint64_t version_;    // 版本号，每次写入value时更新(用于compareAndSet)
+    size_t accessCount_;  // 访问次数
+    uint32_t namespace_;  // 所属命名空间
+    Key key_;
+    Value value_;
 
 public:
-    LruNode(Key key, Value value)
-        : key_(key)
-        , value_(value)
-        , accessCount_(1) 
-        , prev_(nullptr)
+    LruNode(Key key, Value value, uint32_t ns = 0, uint64_t generation = 0)
+        : prev_(nullptr)
         , next_(nullptr)
+        , hash_(0)
+        , generation_(generation)
+        , version_(0)
+        , accessCount_(1)
+        , namespace_(ns)
+        , key_(key)
+        , value_(value)
     {}
 
     // 提供必要的访问器
@@ -53,12 +73,19 @@ class KLruCache : public KICachePolicy<Key, Value>
 public:
     using LruNodeType = LruNode<Key, Value>;
     using NodePtr = std::shared_ptr<LruNodeType>;       //智能指针管理节点
-    using NodeMap = std::unordered_map<Key, NodePtr>;   //哈希表快速查找
+    using HashedKey = KHashedKey<Key>;                  //携带哈希值的key
+    using NodeMap = KIncrementalHashMap<HashedKey, NodePtr, KHashedKeyHasher<Key>>;   //哈希表快速查找(直接使用携带的哈希值，渐进式rehash)
 
     KLruCache(int capacity)
         : capacity_(capacity)
+        , versionCounter_(0)
+        , evictionSlack_(0)
+        , maintenanceSignaled_(false)
     {
         initializeList();
+        if (capacity_ > 0)
+            nodeMap_.reserve(capacity_);    // 按容量预留桶，填充过程中不再扩容
+        MyCache::setLockName(mutex_, "KLruCache");
     }
 
     ~KLruCache() override = default;
@@ -66,11 +93,17 @@ public:
     // 添加缓存
     void put(Key key, Value value) override
     {
+        put(HashedKey(key), value);
+    }
+
+    // 添加缓存(key的哈希值已由调用方算好，如分片缓存的路由)
+    void put(const HashedKey& key, Value value)
+    {
+        std::lock_guard<KCacheMutex> lock(mutex_);   //加锁，保证线程安全(容量可能被setCapacity并发修改，需在锁内检查)
         if (capacity_ <= 0)
             return;
-    
-        std::lock_guard<std::mutex> lock(mutex_);   //加锁，保证线程安全
-        auto it = nodeMap_.find(key);
+
+        auto it = findLive(key);
         if (it != nodeMap_.end())
         {
             // 如果已经存在,则更新value,并调用get方法，代表该数据刚被访问
@@ -81,18 +114,114 @@ public:
         addNewNode(key, value);
     }
 
+    // 添加缓存并设置标签(覆盖原有标签)，之后可通过invalidateTag批量删除
+    void put(Key key, Value value, const std::vector<std::string>& tags)
+    {
+        put(HashedKey(key), value, tags);
+    }
+
+    void put(const HashedKey& key, Value value, const std::vector<std::string>& tags)
+    {
+        std::lock_guard<KCacheMutex> lock(mutex_);
+        if (capacity_ <= 0)
+            return;
+        auto it = findLive(key);
+        if (it != nodeMap_.end())
+            updateExistingNode(it->second, value);
+        else
+            addNewNode(key, value);
+        tagIndex_.set(key.key, tags);
+    }
+
     //通过参数获取value值
     bool get(Key key, Value& value) override
     {
-        std::lock_guard<std::mutex> lock(mutex_);
-        auto it = nodeMap_.find(key);
-        if (it != nodeMap_.end())
+        return get(HashedKey(key), value);
+    }
+
+    bool get(const HashedKey& key, Value& value)
+    {
+        std::lock_guard<KCacheMutex> lock(mutex_);
+        return getLocked(key, value);
+    }
+
+    // 批量获取：只加一次锁。indices为空时获取全部keys，否则只获取其中指定下标的key
+    // values和hits按keys的下标写入(调用方需保证大小与keys一致)，返回命中数
+    size_t getBatch(const std::vector<HashedKey>& keys, std::vector<Value>& values,
+                    std::vector<bool>& hits, const std::vector<size_t>* indices = nullptr)
+    {
+        std::lock_guard<KCacheMutex> lock(mutex_);
+        size_t hitCount = 0;
+        size_t count = indices ? indices->size() : keys.size();
+        for (size_t i = 0; i < count; ++i)
         {
-            moveToMostRecent(it->second);
-            value = it->second->getValue();
-            return true;
+            size_t index = indices ? (*indices)[i] : i;
+            hits[index] = getLocked(keys[index], values[index]);
+            hitCount += hits[index];
         }
-        return false;
+        return hitCount;
+    }
+
+    // 批量添加：只加一次锁，indices的含义同getBatch
+    void putBatch(const std::vector<std::pair<HashedKey, Value>>& entries,
+                  const std::vector<size_t>* indices = nullptr)
+    {
+        std::lock_guard<KCacheMutex> lock(mutex_);
+        if (capacity_ <= 0)
+            return;
+        size_t count = indices ? indices->size() : entries.size();
+        for (size_t i = 0; i < count; ++i)
+        {
+            const auto& entry = entries[indices ? (*indices)[i] : i];
+            auto it = findLive(entry.first);
+            if (it != nodeMap_.end())
+                updateExistingNode(it->second, entry.second);
+            else
+                addNewNode(entry.first, entry.second);
+        }
+    }
+
+    // 批量加载：节点在锁外创建，整批只加一次锁，按输入顺序链接到链表尾部(最后一个条目最新)
+    // 缓存装得下时不会触发淘汰；已存在的key按put的语义更新
+    size_t bulkLoad(const std::vector<std::pair<Key, Value>>& entries) override
+    {
+        std::vector<uint64_t> hashes;
+        hashes.reserve(entries.size());
+        for (const auto& entry : entries)
+            hashes.push_back(HashedKey(entry.first).hash);
+        return bulkLoad(entries, hashes);
+    }
+
+    // 哈希值已由调用方算好(hashes与entries一一对应)，indices的含义同getBatch
+    size_t bulkLoad(const std::vector<std::pair<Key, Value>>& entries, const std::vector<uint64_t>& hashes,
+                    const std::vector<size_t>* indices = nullptr)
+    {
+        if (getCapacity() <= 0)
+            return 0;
+        size_t count = indices ? indices->size() : entries.size();
+        std::vector<NodePtr> nodes;
+        nodes.reserve(count);
+        for (size_t i = 0; i < count; ++i)
+        {
+            const auto& entry = entries[indices ? (*indices)[i] : i];
+            nodes.push_back(makeNode(entry.first, entry.second));
+        }
+
+        std::lock_guard<KCacheMutex> lock(mutex_);
+        if (capacity_ <= 0)
+            return 0;   // 创建节点期间容量被调为0
+        nodeMap_.reserve(std::min(nodeMap_.size() + count, static_cast<size_t>(capacity_)));
+        for (size_t i = 0; i < count; ++i)
+        {
+            size_t index = indices ? (*indices)[i] : i;
+            HashedKey key(entries[index].first, hashes[index]);
+            auto it = findLive(key);
+            if (it != nodeMap_.end())
+                updateExistingNode(it->second, entries[index].second);
+            else
+                linkNewNode(key, std::move(nodes[i]));
+        }
+        return count;
     }
 
     //通过返回值获取value
@@ -104,31 +233,224 @@ public:
         return value;
     }
 
+    // 原子读-改-写：一次加锁、一次查找
+    uint64_t compute(const Key& key, const typename KICachePolicy<Key, Value>::ComputeFunc& func) override
+    {
+        return compute(HashedKey(key), func);
+    }
+
+    uint64_t compute(const HashedKey& key, const typename KICachePolicy<Key, Value>::ComputeFunc& func)
+    {
+        std::lock_guard<KCacheMutex> lock(mutex_);
+        auto it = findLive(key);
+        if (it != nodeMap_.end())
+        {
+            NodePtr node = it->second;
+            Value value = node->getValue();
+            switch (func(true, value, node->version_))
+            {
+            case KComputeAction::Keep:
+                moveToMostRecent(node);
+                return node->version_;
+            case KComputeAction::Store:
+                updateExistingNode(node, value);
+                return node->version_;
+            case KComputeAction::Remove:
+                eraseNode(it);
+                return 0;
+            }
+            return 0;
+        }
+
+        Value value{};
+        if (func(false, value, 0) != KComputeAction::Store || capacity_ <= 0)
+            return 0;
+        return addNewNode(key, value)->version_;
+    }
+
     // 删除指定元素
     void remove(Key key) 
     {   
-        std::lock_guard<std::mutex> lock(mutex_);
-        auto it = nodeMap_.find(key);
+        std::lock_guard<KCacheMutex> lock(mutex_);
+        auto it = nodeMap_.find(HashedKey(key));
         if (it != nodeMap_.end())
         {
-            removeNode(it->second);
-            nodeMap_.erase(it);
+            eraseNode(it);
+        }
+    }
+
+    // 删除所有带有tag的节点，返回删除的节点数
+    // 每批最多删除batchSize个节点，批与批之间释放锁，避免长时间阻塞其他请求
+    size_t invalidateTag(const std::string& tag, size_t batchSize = 64)
+    {
+        size_t removed = 0;
+        std::vector<Key> keys;
+        while (true)
+        {
+            std::lock_guard<KCacheMutex> lock(mutex_);
+            tagIndex_.collect(tag, std::max<size_t>(batchSize, 1), keys);
+            if (keys.empty())
+                break;
+            for (const auto& key : keys)
+            {
+                auto it = nodeMap_.find(HashedKey(key));
+                if (it != nodeMap_.end())
+                {
+                    if (!isStale(it->second))
+                        ++removed;  // 只统计真正从缓存中删除的条目，已过期的节点只是顺便回收
+                    eraseNode(it);
+                }
+                else
+                {
+                    tagIndex_.erase(key);   // 节点已不在缓存中，只清理索引
+                }
+            }
+        }
+        return removed;
+    }
+
+    // 按哈希值批量删除(只比较KHashedKey的哈希值，碰撞时会多删，对缓存无害)，整批只加一次锁，
+    // 返回删除的节点数。用于只携带哈希值的失效通知(KInvalidationBus.h)，indices的含义同getBatch
+    size_t invalidateHashes(const std::vector<uint64_t>& hashes, const std::vector<size_t>* indices = nullptr)
+    {
+        size_t count = indices ? indices->size() : hashes.size();
+        size_t removed = 0;
+        std::lock_guard<KCacheMutex> lock(mutex_);
+        for (size_t i = 0; i < count; ++i)
+        {
+            removed += nodeMap_.eraseHash(hashes[indices ? (*indices)[i] : i],
+                [this](std::pair<const HashedKey, NodePtr>& entry) {
+                    removeNode(entry.second);
+                    tagIndex_.erase(entry.first.key);
+                });
         }
+        return removed;
     }
 
     // 判断给定key的节点是否存在于缓存中
     bool contains(Key key)
     {
-        std::lock_guard<std::mutex> lock(mutex_);
-        auto it = nodeMap_.find(key);
+        std::lock_guard<KCacheMutex> lock(mutex_);
+        auto it = findLive(HashedKey(key));
         if (it != nodeMap_.end())
             return true;
         else
             return false;
     }
 
+    // 调整缓存容量，缩容时从最久未访问的节点开始驱逐
+    void setCapacity(int capacity)
+    {
+        std::lock_guard<KCacheMutex> lock(mutex_);
+        MYCACHE_TRACE_SCOPE(Resize, "KLruCache", std::max(capacity, 0));
+        capacity_ = capacity;
+        while (!nodeMap_.empty() && nodeMap_.size() > static_cast<size_t>(std::max(capacity_, 0)))
+        {
+            evictLeastRecent();
+        }
+    }
+
+    int getCapacity()
+    {
+        std::lock_guard<KCacheMutex> lock(mutex_);
+        return capacity_;
+    }
+
+    // O(1)清空缓存：现有节点立即不可见，在之后的访问、驱逐或sweepStale中回收
+    void clear() override
+    {
+        std::lock_guard<KCacheMutex> lock(mutex_);
+        generation_.invalidateAll(nodeMap_.size());
+    }
+
+    // 设置key到命名空间的映射(应在插入数据前设置)
+    void setNamespaceFunc(typename KGeneration<Key>::NamespaceFunc func)
+    {
+        std::lock_guard<KCacheMutex> lock(mutex_);
+        generation_.setNamespaceFunc(std::move(func));
+    }
+
+    // O(1)使某个命名空间下的所有节点失效
+    void invalidateNamespace(uint32_t ns)
+    {
+        std::lock_guard<KCacheMutex> lock(mutex_);
+        generation_.invalidateNamespace(ns, nodeMap_.size());
+    }
+
+    // 回收过期节点，每次最多扫描maxBuckets个哈希桶(可由后台线程定期调用)，返回回收数量
+    size_t sweepStale(size_t maxBuckets = 64)
+    {
+        std::lock_guard<KCacheMutex> lock(mutex_);
+        return sweepStaleLocked(maxBuckets);
+    }
+
+    // 进入后台维护模式(见KMaintenanceScheduler)：写入时允许暂时超出容量slack个条目，
+    // 超出容量+slack/2(高水位)时调用wake，由后台的runMaintenance驱逐回容量(低水位)以内
+    void enableBackgroundMaintenance(size_t slack, std::function<void()> wake)
+    {
+        std::lock_guard<KCacheMutex> lock(mutex_);
+        evictionSlack_ = slack;
+        wakeMaintenance_ = std::move(wake);
+        if (capacity_ > 0)
+            nodeMap_.reserve(capacity_ + slack);
+    }
 
+    // 后台维护的一步：最多驱逐budget个超出容量的节点、扫描budget个桶回收过期节点，返回是否还有剩余工作
+    bool runMaintenance(size_t budget)
+    {
+        std::lock_guard<KCacheMutex> lock(mutex_);
+        size_t limit = static_cast<size_t>(std::max(capacity_, 0));
+        for (size_t i = 0; i < budget && !nodeMap_.empty() && nodeMap_.size() > limit; ++i)
+        {
+            evictLeastRecent();
+        }
+        if (nodeMap_.size() <= limit)
+            maintenanceSignaled_ = false;
+        if (generation_.hasStale())
+            sweepStaleLocked(budget);
+        return nodeMap_.size() > limit || generation_.hasStale();
+    }
+
+    // 快照：从最久未访问到最近访问
+    void snapshot(std::vector<std::pair<Key, Value>>& entries) override
+    {
+        std::lock_guard<KCacheMutex> lock(mutex_);
+        entries.reserve(entries.size() + nodeMap_.size());
+        for (NodePtr node = dummyHead_->next_; node != dummyTail_; node = node->next_)
+        {
+            if (!isStale(node))
+                entries.emplace_back(node->key_, node->value_);
+        }
+    }
+
+    // 内存统计：节点中的key/value计为有效数据，其余(链表指针、计数器、控制块)计为管理开销
+    KMemoryUsage memoryUsage() override
+    {
+        std::lock_guard<KCacheMutex> lock(mutex_);
+        KMemoryUsage usage;
+        usage.entries = nodeMap_.size();
+        usage.indexBytes = nodeMap_.memoryBytes();
+        usage.payloadBytes = usage.entries * (sizeof(Key) + sizeof(Value));
+        usage.metadataBytes = nodeMemory_.bytes() - usage.payloadBytes + tagIndex_.memoryBytes();
+        for (const auto& pair : nodeMap_)
+        {
+            usage.indexBytes += heapBytesOf(pair.first.key);    // 哈希表中的key副本
+            usage.payloadBytes += heapBytesOf(pair.second->key_) + heapBytesOf(pair.second->value_);
+        }
+        return usage;
+    }
+
+    // 设置锁的名字，用于锁竞争统计
+    void setLockName(const std::string& name)
+    {
+        MyCache::setLockName(mutex_, name);
+    }
 
+    // 收集锁竞争统计(需定义MYCACHE_LOCK_PROFILING，否则为空)
+    void collectLockStats(std::vector<KLockStats>& out) const
+    {
+        MyCache::collectLockStats(mutex_, out);
+    }
 
 private:
     // 初始化链表
@@ -168,6 +490,7 @@ private:
     void updateExistingNode(NodePtr node, const Value& value) 
     {
         node->setValue(value);
+        node->version_ = ++versionCounter_;
         moveToMostRecent(node);
     }
 
@@ -175,32 +498,115 @@ private:
     void evictLeastRecent() 
     {
         NodePtr leastRecent = dummyHead_->next_;
+        MYCACHE_TRACE_INSTANT(Evict, "KLruCache", 1);
+        if (!isStale(leastRecent))  // 已被clear/invalidateNamespace逻辑删除的节点只是回收，不算驱逐
+            this->notifyEvicted(leastRecent->key_, leastRecent->value_);
         removeNode(leastRecent);    //从链表中移除
-        nodeMap_.erase(leastRecent->getKey());  //从哈希表中移除
+        tagIndex_.erase(leastRecent->key_); //从标签索引中移除
+        nodeMap_.erase(HashedKey(leastRecent->key_, leastRecent->hash_));  //从哈希表中移除(使用节点保存的哈希值)
+    }
+
+    // 从链表、标签索引和哈希表中删除节点
+    void eraseNode(typename NodeMap::iterator it)
+    {
+        removeNode(it->second);
+        tagIndex_.erase(it->first.key);
+        nodeMap_.erase(it);
+    }
+
+    // 查找未过期的节点，找到过期节点时顺便回收
+    typename NodeMap::iterator findLive(const HashedKey& key)
+    {
+        auto it = nodeMap_.find(key);
+        if (it != nodeMap_.end() && isStale(it->second))
+        {
+            eraseNode(it);
+            return nodeMap_.end();
+        }
+        return it;
+    }
+
+    bool isStale(const NodePtr& node) const
+    {
+        return generation_.isStale(node->namespace_, node->generation_);
+    }
+
+    size_t sweepStaleLocked(size_t maxBuckets)
+    {
+        return generation_.sweep(nodeMap_, maxBuckets,
+            [this](const NodePtr& node) { return isStale(node); },
+            [this](const Key& key) { eraseNode(nodeMap_.find(HashedKey(key))); });
+    }
+
+    bool getLocked(const HashedKey& key, Value& value)
+    {
+        auto it = findLive(key);
+        if (it != nodeMap_.end())
+        {
+            moveToMostRecent(it->second);
+            value = it->second->getValue();
+            return true;
+        }
+        return false;
+    }
+
+    // 创建节点(不需要持有锁)
+    NodePtr makeNode(const Key& key, const Value& value)
+    {
+       return std::allocate_shared<LruNodeType>(KCountingAllocator<LruNodeType>(&nodeMemory_), key, value);
     }
 
     //添加一个新节点
-    void addNewNode(const Key& key, const Value& value) 
+    NodePtr addNewNode(const HashedKey& key, const Value& value) 
+    {
+       return linkNewNode(key, makeNode(key.key, value));
+    }
+
+    // 把已创建好的节点加入缓存，缓存已满时先驱逐
+    NodePtr linkNewNode(const HashedKey& key, NodePtr newNode)
     {
-       if (nodeMap_.size() >= capacity_) 
+       size_t limit = capacity_ + evictionSlack_;  // 后台维护模式下的硬上限，否则就是容量
+       if (nodeMap_.size() >= limit && generation_.hasStale())
+       {
+           sweepStaleLocked(kEvictSweepBuckets);    // 优先回收过期节点
+       }
+       if (nodeMap_.size() >= limit) 
        {
            evictLeastRecent();
        }
 
-       NodePtr newNode = std::make_shared<LruNodeType>(key, value);
+       newNode->namespace_ = generation_.namespaceOf(key.key);
+       newNode->generation_ = generation_.current();
+       newNode->version_ = ++versionCounter_;
+       newNode->hash_ = key.hash;
        insertNode(newNode);     //添加到链表
-       nodeMap_[key] = newNode; //添加到哈希表
+       nodeMap_.emplace(key, newNode); //添加到哈希表
+       if (wakeMaintenance_ && !maintenanceSignaled_ && nodeMap_.size() > capacity_ + evictionSlack_ / 2)
+       {
+           maintenanceSignaled_ = true;     // 超过高水位(容量+余量的一半)：唤醒一次，驱逐回容量后才会再次唤醒
+           wakeMaintenance_();
+       }
+       return newNode;
     }
 
     
 
 
 private:
+    static constexpr size_t kEvictSweepBuckets = 8;    // 驱逐前顺带回收过期节点时扫描的桶数
+
     int          capacity_;     // 缓存容量
+    KMemoryCounter nodeMemory_; // 节点(含shared_ptr控制块)占用的字节数，需在持有节点的成员之前声明
     NodeMap      nodeMap_;      // 哈希表：键到节点的映射   key -> Node 
-    std::mutex   mutex_;        // 保证线程安全
+    KCacheMutex  mutex_;       // 保证线程安全
     NodePtr      dummyHead_;    // 虚拟头结点(永远在第一个节点之前)
     NodePtr      dummyTail_;    // 虚拟尾节点(永远在最后一个节点之后)
+    KTagIndex<Key> tagIndex_;   // 标签索引：tag -> key
+    KGeneration<Key> generation_;   // 代数：O(1)清空和命名空间失效
+    uint64_t     versionCounter_;   // 版本号计数器
+    size_t       evictionSlack_;    // 后台维护模式下允许超出容量的条目数
+    std::function<void()> wakeMaintenance_; // 超出容量时唤醒后台维护
+    bool         maintenanceSignaled_;  // 本次超出容量后是否已唤醒过
 };
 
 
@@ -218,72 +624,181 @@ public:
         : KLruCache<Key, Value>(capacity) // 调用基类构造
         , historyList_(std::make_unique<KLruCache<Key, size_t>>(historyCapacity))
         , k_(k)
-    {}  
+    {
+        MyCache::setLockName(mutex_, "KLruKCache");
+        KLruCache<Key, Value>::setLockName("KLruKCache.cache");
+        historyList_->setLockName("KLruKCache.history");
+    }
 
     //获取缓存
     bool get(Key key, Value& value)
     {
-        std::lock_guard<std::mutex> lock(mutex_);
-        // 先判断是否存在于缓存中，如果存在则直接获取
-        if (KLruCache<Key, Value>::contains(key))
-        {
-            return KLruCache<Key, Value>::get(key,value);
-        }
-
-        //获取历史记录中的访问次数，然后增加历史访问次数
-        int historyCount = historyList_->get(key);
-        historyList_->put(key, historyCount+1);
-
-        // 如果数据历史访问次数达到上限，则添加入缓存
-        if (historyCount+1 >= k_)
-        {
-            // 移除历史访问记录
-            historyList_->remove(key);
-            // 添加入缓存中
-            KLruCache<Key, Value>::put(key, value);
-        }
+        std::lock_guard<KCacheMutex> lock(mutex_);
+        // 先在缓存中查找，命中则直接返回(只查找一次)
+        bool hit = false;
+        KLruCache<Key, Value>::compute(key, [&](bool present, Value& current, uint64_t) {
+            if (present)
+            {
+                value = current;
+                hit = true;
+            }
+            return KComputeAction::Keep;
+        });
+        if (hit)
+            return true;
 
-        // 如果刚加进缓存，就能访问到。否则就不在缓存中，所以无法命中，即在缓存中获取不到
-        return KLruCache<Key, Value>::get(key,value);
+        // 增加历史访问次数，如果达到上限则添加入缓存
+        // 刚加进缓存就能访问到，否则不在缓存中，无法命中
+        if (recordHistory(key))
+            return KLruCache<Key, Value>::compute(key, [&](bool, Value& current, uint64_t) {
+                current = value;
+                return KComputeAction::Store;
+            }) != 0;
+        return false;
     }
 
     Value get(Key key)
     {
-        std::lock_guard<std::mutex> lock(mutex_);
         Value value{};
-        get(key, value);
+        get(key, value);    // get(key, value)内部加锁，这里不能重复加锁
         return value;
     }
 
     //添加缓存
     void put(Key key, Value value)
     {
-        std::lock_guard<std::mutex> lock(mutex_);
-
-        // 先判断是否存在于缓存中，如果存在于则直接覆盖
-        if (KLruCache<Key, Value>::contains(key))
-        {
-            KLruCache<Key, Value>::put(key, value);
+        std::lock_guard<KCacheMutex> lock(mutex_);
+
+        // 如果已存在于缓存中则直接覆盖
+        bool present = false;
+        KLruCache<Key, Value>::compute(key, [&](bool exists, Value& current, uint64_t) {
+            present = exists;
+            if (!exists)
+                return KComputeAction::Keep;
+            current = value;
+            return KComputeAction::Store;
+        });
+        if (present)
             return;
-        }
-
-        //获取历史记录中的访问次数，然后增加历史访问次数
-        int historyCount = historyList_->get(key);
-        historyList_->put(key, historyCount+1); 
 
         // 如果数据历史访问次数达到上限，则添加入缓存
-        if (historyCount+1 >= k_)
-        {
-            // 移除历史访问记录
-            historyList_->remove(key);
-            // 添加入缓存中
+        if (recordHistory(key))
             KLruCache<Key, Value>::put(key, value);
-        }
+    }
+
+    // 原子读-改-写：已在缓存中的key直接交给缓存处理；
+    // 不在缓存中的key写入时与put一样要经过历史记录的准入，未达到k次则不写入(返回0)
+    uint64_t compute(const Key& key, const typename KICachePolicy<Key, Value>::ComputeFunc& func) override
+    {
+        std::lock_guard<KCacheMutex> lock(mutex_);
+        bool handled = false;
+        uint64_t version = KLruCache<Key, Value>::compute(key, [&](bool present, Value& current, uint64_t ver) {
+            if (!present)
+                return KComputeAction::Keep;
+            handled = true;
+            return func(true, current, ver);
+        });
+        if (handled)
+            return version;
+
+        Value value{};
+        if (func(false, value, 0) != KComputeAction::Store || !recordHistory(key))
+            return 0;
+        return KLruCache<Key, Value>::compute(key, [&](bool, Value& current, uint64_t) {
+            current = value;
+            return KComputeAction::Store;
+        });
+    }
+
+    // 批量加载的数据(如从快照恢复)已经是热数据，直接进入缓存，不经过历史记录的准入
+    size_t bulkLoad(const std::vector<std::pair<Key, Value>>& entries) override
+    {
+        std::lock_guard<KCacheMutex> lock(mutex_);
+        return KLruCache<Key, Value>::bulkLoad(entries);
+    }
+
+    // 运行时调整进入缓存所需的访问次数(供自动调参使用)
+    void setK(int k)
+    {
+        std::lock_guard<KCacheMutex> lock(mutex_);
+        k_ = std::max(k, 1);
+    }
+
+    int getK()
+    {
+        std::lock_guard<KCacheMutex> lock(mutex_);
+        return k_;
+    }
+
+    // 运行时调整历史记录容量
+    void setHistoryCapacity(int historyCapacity)
+    {
+        std::lock_guard<KCacheMutex> lock(mutex_);
+        historyList_->setCapacity(historyCapacity);
+    }
+
+    int getHistoryCapacity()
+    {
+        std::lock_guard<KCacheMutex> lock(mutex_);
+        return historyList_->getCapacity();
+    }
+
+    // 清空缓存和历史访问记录
+    void clear() override
+    {
+        std::lock_guard<KCacheMutex> lock(mutex_);
+        KLruCache<Key, Value>::clear();
+        historyList_->clear();
+    }
+
+    // 缓存和历史记录使用同一个命名空间映射
+    void setNamespaceFunc(typename KGeneration<Key>::NamespaceFunc func)
+    {
+        std::lock_guard<KCacheMutex> lock(mutex_);
+        KLruCache<Key, Value>::setNamespaceFunc(func);
+        historyList_->setNamespaceFunc(func);
+    }
+
+    void invalidateNamespace(uint32_t ns)
+    {
+        std::lock_guard<KCacheMutex> lock(mutex_);
+        KLruCache<Key, Value>::invalidateNamespace(ns);
+        historyList_->invalidateNamespace(ns);
+    }
+
+    // 历史记录整体计为管理开销
+    KMemoryUsage memoryUsage() override
+    {
+        std::lock_guard<KCacheMutex> lock(mutex_);
+        KMemoryUsage usage = KLruCache<Key, Value>::memoryUsage();
+        usage.metadataBytes += historyList_->memoryUsage().total();
+        return usage;
+    }
+
+    // 收集外层锁、缓存锁和历史记录锁的竞争统计
+    void collectLockStats(std::vector<KLockStats>& out) const
+    {
+        MyCache::collectLockStats(mutex_, out);
+        KLruCache<Key, Value>::collectLockStats(out);
+        historyList_->collectLockStats(out);
     }
 
 
 private:
-    std::mutex   mutex_;
+    // 历史访问次数+1，达到k次时移除历史记录并返回true(表示应进入缓存)
+    bool recordHistory(const Key& key)
+    {
+        bool admit = false;
+        historyList_->compute(key, [&](bool present, size_t& count, uint64_t) {
+            count = present ? count + 1 : 1;
+            admit = count >= static_cast<size_t>(k_);
+            return admit ? KComputeAction::Remove : KComputeAction::Store;
+        });
+        return admit;
+    }
+
+private:
+    KCacheMutex mutex_;
     int k_;     //在历史记录中访问K_次才可以进入缓存链表
     std::unique_ptr<KLruCache<Key, size_t>> historyList_; // 访问数据历史记录(value为访问次数)(即历史记录也用KLruCache存储)
     // 如果大容量长期运行的话 历史记录可以采用哈希表存储 定期清理哈希表中的低频数据
@@ -309,21 +824,31 @@ public:
         {
             // 创建分片缓存实例，每个分片是独立的LRU缓存
             lruSliceCaches_.emplace_back(new KLruCache<Key, Value>(sliceSize)); 
+            lruSliceCaches_.back()->setLockName("KHashLruCaches[" + std::to_string(i) + "]");
         }
     }
 
+    using HashedKey = KHashedKey<Key>;
+
     void put(Key key, Value value)
     {
-        // 获取key的hash值，通过hash值计算出对应的分片索引
-        size_t sliceIndex = Hash(key) % sliceNum_;
-        return lruSliceCaches_[sliceIndex]->put(key, value);
+        put(HashedKey(key), value);
+    }
+
+    // key的哈希值只计算一次：高位选择分片，分片内的哈希表直接使用同一个哈希值
+    void put(const HashedKey& key, Value value)
+    {
+        lruSliceCaches_[sliceOf(key)]->put(key, value);
     }
 
     bool get(Key key, Value& value)
     {
-        // 获取key的hash值，通过hash值计算出对应的分片索引
-        size_t sliceIndex = Hash(key) % sliceNum_;
-        return lruSliceCaches_[sliceIndex]->get(key, value);
+        return get(HashedKey(key), value);
+    }
+
+    bool get(const HashedKey& key, Value& value)
+    {
+        return lruSliceCaches_[sliceOf(key)]->get(key, value);
     }
 
     Value get(Key key)
@@ -334,14 +859,222 @@ public:
         return value;
     }
 
+    uint64_t compute(const Key& key, const typename KICachePolicy<Key, Value>::ComputeFunc& func) override
+    {
+        HashedKey hashedKey(key);
+        return lruSliceCaches_[sliceOf(hashedKey)]->compute(hashedKey, func);
+    }
+
+    // 批量获取(哈希值已预先算好)：按分片分组，每个分片只加一次锁
+    // values和hits会被调整为与keys相同的大小，返回命中数
+    size_t getBatch(const std::vector<HashedKey>& keys, std::vector<Value>& values, std::vector<bool>& hits)
+    {
+        values.assign(keys.size(), Value{});
+        hits.assign(keys.size(), false);
+        std::vector<std::vector<size_t>> groups(sliceNum_);
+        for (size_t i = 0; i < keys.size(); ++i)
+            groups[sliceOf(keys[i])].push_back(i);
+
+        size_t hitCount = 0;
+        for (int i = 0; i < sliceNum_; ++i)
+        {
+            if (!groups[i].empty())
+                hitCount += lruSliceCaches_[i]->getBatch(keys, values, hits, &groups[i]);
+        }
+        return hitCount;
+    }
+
+    // 批量添加(哈希值已预先算好)：按分片分组，每个分片只加一次锁
+    void putBatch(const std::vector<std::pair<HashedKey, Value>>& entries)
+    {
+        std::vector<std::vector<size_t>> groups(sliceNum_);
+        for (size_t i = 0; i < entries.size(); ++i)
+            groups[sliceOf(entries[i].first)].push_back(i);
+
+        for (int i = 0; i < sliceNum_; ++i)
+        {
+            if (!groups[i].empty())
+                lruSliceCaches_[i]->putBatch(entries, &groups[i]);
+        }
+    }
+
+    // 批量加载：按分片分组，每个分片只加一次锁
+    size_t bulkLoad(const std::vector<std::pair<Key, Value>>& entries) override
+    {
+        std::vector<uint64_t> hashes;
+        hashes.reserve(entries.size());
+        std::vector<std::vector<size_t>> groups(sliceNum_);
+        for (size_t i = 0; i < entries.size(); ++i)
+        {
+            HashedKey hashedKey(entries[i].first);
+            hashes.push_back(hashedKey.hash);
+            groups[sliceOf(hashedKey)].push_back(i);
+        }
+
+        size_t loaded = 0;
+        for (int i = 0; i < sliceNum_; ++i)
+        {
+            if (!groups[i].empty())
+                loaded += lruSliceCaches_[i]->bulkLoad(entries, hashes, &groups[i]);
+        }
+        return loaded;
+    }
+
+    // 添加带标签的缓存
+    void put(Key key, Value value, const std::vector<std::string>& tags)
+    {
+        HashedKey hashedKey(key);
+        lruSliceCaches_[sliceOf(hashedKey)]->put(hashedKey, value, tags);
+    }
+
+    // 在所有分片中删除带有tag的节点，各分片按批删除，同一时刻只持有一个分片的锁
+    size_t invalidateTag(const std::string& tag, size_t batchSize = 64)
+    {
+        size_t removed = 0;
+        for (auto& lruSliceCache : lruSliceCaches_)
+        {
+            removed += lruSliceCache->invalidateTag(tag, batchSize);
+        }
+        return removed;
+    }
+
+    // 按哈希值批量删除：按分片分组，每个分片只加一次锁
+    size_t invalidateHashes(const std::vector<uint64_t>& hashes)
+    {
+        std::vector<std::vector<size_t>> groups(sliceNum_);
+        for (size_t i = 0; i < hashes.size(); ++i)
+            groups[sliceOf(HashedKey(Key(), hashes[i]))].push_back(i);
+
+        size_t removed = 0;
+        for (int i = 0; i < sliceNum_; ++i)
+        {
+            if (!groups[i].empty())
+                removed += lruSliceCaches_[i]->invalidateHashes(hashes, &groups[i]);
+        }
+        return removed;
+    }
+
+    // 清空所有分片(每个分片O(1))
+    void clear() override
+    {
+        for (auto& lruSliceCache : lruSliceCaches_)
+        {
+            lruSliceCache->clear();
+        }
+    }
+
+    // 每个分片使用同一个淘汰监听，listener可能被不同分片并发调用
+    void setEvictionListener(typename KICachePolicy<Key, Value>::EvictionListener listener) override
+    {
+        for (auto& lruSliceCache : lruSliceCaches_)
+        {
+            lruSliceCache->setEvictionListener(listener);
+        }
+    }
+
+    void setNamespaceFunc(typename KGeneration<Key>::NamespaceFunc func)
+    {
+        for (auto& lruSliceCache : lruSliceCaches_)
+        {
+            lruSliceCache->setNamespaceFunc(func);
+        }
+    }
+
+    void invalidateNamespace(uint32_t ns)
+    {
+        for (auto& lruSliceCache : lruSliceCaches_)
+        {
+            lruSliceCache->invalidateNamespace(ns);
+        }
+    }
+
+    // 依次回收各分片的过期节点
+    size_t sweepStale(size_t maxBucketsPerSlice = 64)
+    {
+        size_t reclaimed = 0;
+        for (auto& lruSliceCache : lruSliceCaches_)
+        {
+            reclaimed += lruSliceCache->sweepStale(maxBucketsPerSlice);
+        }
+        return reclaimed;
+    }
+
+    // 各分片进入后台维护模式，余量平均分给各分片
+    void enableBackgroundMaintenance(size_t slack, std::function<void()> wake)
+    {
+        size_t sliceSlack = (slack + sliceNum_ - 1) / sliceNum_;
+        for (auto& lruSliceCache : lruSliceCaches_)
+        {
+            lruSliceCache->enableBackgroundMaintenance(sliceSlack, wake);
+        }
+    }
+
+    // 依次维护各分片，每个分片最多budget个单位的工作
+    bool runMaintenance(size_t budget)
+    {
+        bool pending = false;
+        for (auto& lruSliceCache : lruSliceCaches_)
+        {
+            if (lruSliceCache->runMaintenance(budget))
+                pending = true;
+        }
+        return pending;
+    }
+
+    // 各分片锁的竞争统计
+    void collectLockStats(std::vector<KLockStats>& out) const
+    {
+        for (const auto& lruSliceCache : lruSliceCaches_)
+        {
+            lruSliceCache->collectLockStats(out);
+        }
+    }
+
+    // 竞争最激烈的前n个分片
+    std::vector<KLockStats> topContendedShards(size_t n) const
+    {
+        std::vector<KLockStats> stats;
+        collectLockStats(stats);
+        return topContendedLocks(std::move(stats), n);
+    }
+
+    // 依次复制各分片
+    void snapshot(std::vector<std::pair<Key, Value>>& entries) override
+    {
+        for (auto& lruSliceCache : lruSliceCaches_)
+        {
+            lruSliceCache->snapshot(entries);
+        }
+    }
+
+    // 各分片的内存统计
+    std::vector<KMemoryUsage> shardMemoryUsage()
+    {
+        std::vector<KMemoryUsage> usages;
+        for (auto& lruSliceCache : lruSliceCaches_)
+        {
+            usages.push_back(lruSliceCache->memoryUsage());
+        }
+        return usages;
+    }
+
+    KMemoryUsage memoryUsage() override
+    {
+        KMemoryUsage usage;
+        for (const auto& shard : shardMemoryUsage())
+        {
+            usage += shard;
+        }
+        return usage;
+    }
+
 
 
 private:
-    // 将key转换为对应hash值
-    size_t Hash(Key key)
+    // 由哈希值的高位计算分片索引
+    size_t sliceOf(const HashedKey& key) const
     {
-        std::hash<Key> hashFunc;
-        return hashFunc(key);
+        return key.shardOf(sliceNum_);
     }
 
 private:
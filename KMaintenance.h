@@ -0,0 +1,164 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace MyCache
+{
+
+// 后台维护调度器：把驱逐、过期回收、LFU老化等工作从用户的put/get中移到后台线程
+// - 缓存开启后台维护后，写入只在超出容量+余量(硬上限)时才内联驱逐，平时只做O(1)的插入
+// - 超出容量+余量的一半(高水位)时缓存调用wake()唤醒调度器，调度器把它驱逐回容量以内(低水位)
+// - 没有唤醒时每interval运行一次，处理未到高水位的超出部分，顺带回收clear/invalidateNamespace留下的过期节点
+// - 每个任务每次最多做budget个单位的工作后释放锁，还有剩余时让出CPU后继续，前台请求不会被长时间阻塞
+// 调度器持有缓存的引用：应在缓存之后构造、之前析构(或先调用stop)
+struct KMaintenanceOptions
+{
+    std::chrono::milliseconds interval{10};     // 定时运行的间隔
+    size_t budget = 32;                         // 每个任务每次最多处理的节点/桶数，决定前台最长要等多久才能拿到锁
+};
+
+struct KMaintenanceStats
+{
+    uint64_t ticks = 0;     // 运行轮数(定时或被唤醒)
+    uint64_t wakeups = 0;   // 被水位唤醒的次数
+    uint64_t steps = 0;     // 任务执行次数(每次至多budget个单位的工作)
+};
+
+
+class KMaintenanceScheduler
+{
+public:
+    // 任务：最多做budget个单位的工作，返回是否还有剩余工作
+    using Task = std::function<bool(size_t budget)>;
+
+    explicit KMaintenanceScheduler(KMaintenanceOptions options = KMaintenanceOptions())
+        : options_(options)
+        , stopping_(false)
+        , woken_(false)
+        , tasksVersion_(0)
+        , ticks_(0)
+        , wakeups_(0)
+        , steps_(0)
+    {
+        thread_ = std::thread(&KMaintenanceScheduler::run, this);
+    }
+
+    ~KMaintenanceScheduler()
+    {
+        stop();
+    }
+
+    KMaintenanceScheduler(const KMaintenanceScheduler&) = delete;
+    KMaintenanceScheduler& operator=(const KMaintenanceScheduler&) = delete;
+
+    void addTask(Task task)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        tasks_.push_back(std::move(task));
+        ++tasksVersion_;
+    }
+
+    // 让缓存进入后台维护模式并注册它的维护任务
+    // slack为允许暂时超出容量的条目数，超出容量+slack时写入仍会内联驱逐
+    template<typename Cache>
+    void attach(Cache& cache, size_t slack)
+    {
+        cache.enableBackgroundMaintenance(slack, [this] { wake(); });
+        addTask([&cache](size_t budget) { return cache.runMaintenance(budget); });
+    }
+
+    // 立即唤醒调度线程(可以在缓存的锁内调用)
+    void wake()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            woken_ = true;
+        }
+        wakeup_.notify_one();
+    }
+
+    void stop()
+    {
+        if (!thread_.joinable())
+            return;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        wakeup_.notify_one();
+        thread_.join();
+    }
+
+    KMaintenanceStats stats() const
+    {
+        KMaintenanceStats stats;
+        stats.ticks = ticks_.load(std::memory_order_relaxed);
+        stats.wakeups = wakeups_.load(std::memory_order_relaxed);
+        stats.steps = steps_.load(std::memory_order_relaxed);
+        return stats;
+    }
+
+private:
+    void run()
+    {
+        std::vector<Task> tasks;
+        uint64_t version = 0;
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (!stopping_)
+        {
+            wakeup_.wait_for(lock, options_.interval, [this] { return stopping_ || woken_; });
+            if (stopping_)
+                break;
+            if (woken_)
+                wakeups_.fetch_add(1, std::memory_order_relaxed);
+            woken_ = false;
+            if (version != tasksVersion_)
+            {
+                tasks = tasks_;     // 任务列表很少变化，只在变化时复制
+                version = tasksVersion_;
+            }
+            ticks_.fetch_add(1, std::memory_order_relaxed);
+
+            // 执行任务时不持有调度器的锁：任务会获取缓存的锁，而缓存可能在自己的锁内调用wake()
+            lock.unlock();
+            bool pending = true;
+            while (pending && !stopping_.load(std::memory_order_relaxed))
+            {
+                pending = false;
+                for (auto& task : tasks)
+                {
+                    steps_.fetch_add(1, std::memory_order_relaxed);
+                    if (task(options_.budget))
+                        pending = true;
+                }
+                if (pending)
+                    std::this_thread::yield();  // 两步之间让前台线程有机会获取锁
+            }
+            lock.lock();
+        }
+    }
+
+private:
+    const KMaintenanceOptions   options_;
+    std::mutex                  mutex_;
+    std::condition_variable     wakeup_;
+    std::atomic<bool>           stopping_;
+    bool                        woken_;
+    std::vector<Task>           tasks_;
+    uint64_t                    tasksVersion_;
+    std::thread                 thread_;
+
+    std::atomic<uint64_t>       ticks_;
+    std::atomic<uint64_t>       wakeups_;
+    std::atomic<uint64_t>       steps_;
+};
+
+} // namespace MyCache
@@ -0,0 +1,131 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <string>
+
+namespace MyCache
+{
+
+// 内存统计
+// 每个缓存的memoryUsage()把占用的内存分成三类：
+// - 索引(index)：按key查找用的哈希表，包括桶数组、哈希表节点和其中保存的key副本
+// - 管理开销(metadata)：节点中的指针/计数器/版本号、shared_ptr控制块、频次链表、幽灵表、历史记录等
+// - 有效数据(payload)：key和value本身，包括它们在堆上的数据(如std::string的缓冲区)
+// 缓存节点经KCountingAllocator分配，字节数是精确的；标准库容器的内部节点按libstdc++的布局估算。
+// 都不含malloc自身的额外开销
+
+
+struct KMemoryUsage
+{
+    size_t entries = 0;         // 条目数
+    size_t indexBytes = 0;
+    size_t metadataBytes = 0;
+    size_t payloadBytes = 0;
+
+    size_t total() const { return indexBytes + metadataBytes + payloadBytes; }
+
+    double bytesPerEntry() const
+    {
+        return entries == 0 ? 0.0 : static_cast<double>(total()) / entries;
+    }
+
+    KMemoryUsage& operator+=(const KMemoryUsage& other)
+    {
+        entries += other.entries;
+        indexBytes += other.indexBytes;
+        metadataBytes += other.metadataBytes;
+        payloadBytes += other.payloadBytes;
+        return *this;
+    }
+};
+
+
+// 分配计数器：节点可能在缓存锁外释放(shared_ptr最后一个引用)，所以用原子变量
+class KMemoryCounter
+{
+public:
+    void add(size_t bytes) { bytes_.fetch_add(bytes, std::memory_order_relaxed); }
+    void sub(size_t bytes) { bytes_.fetch_sub(bytes, std::memory_order_relaxed); }
+    size_t bytes() const { return bytes_.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<size_t> bytes_{0};
+};
+
+
+// 计数分配器：用于std::allocate_shared，节点和shared_ptr控制块在一次分配中一并计入
+template<typename T>
+class KCountingAllocator
+{
+public:
+    using value_type = T;
+
+    explicit KCountingAllocator(KMemoryCounter* counter) noexcept : counter_(counter) {}
+
+    template<typename U>
+    KCountingAllocator(const KCountingAllocator<U>& other) noexcept : counter_(other.counter()) {}
+
+    T* allocate(size_t n)
+    {
+        T* p = std::allocator<T>().allocate(n);
+        counter_->add(n * sizeof(T));
+        return p;
+    }
+
+    void deallocate(T* p, size_t n) noexcept
+    {
+        counter_->sub(n * sizeof(T));
+        std::allocator<T>().deallocate(p, n);
+    }
+
+    KMemoryCounter* counter() const noexcept { return counter_; }
+
+    template<typename U>
+    bool operator==(const KCountingAllocator<U>& other) const noexcept { return counter_ == other.counter(); }
+    template<typename U>
+    bool operator!=(const KCountingAllocator<U>& other) const noexcept { return counter_ != other.counter(); }
+
+private:
+    KMemoryCounter* counter_;
+};
+
+
+// 对象在堆上额外占用的字节数(不含对象本身)，需要统计堆数据的类型在此添加重载
+template<typename T>
+size_t heapBytesOf(const T&) { return 0; }
+
+inline size_t heapBytesOf(const std::string& s)
+{
+    static const size_t kInlineCapacity = std::string().capacity();    // 短字符串优化(SSO)的容量
+    return s.capacity() > kInlineCapacity ? s.capacity() + 1 : 0;
+}
+
+
+// 标准库容器的估算(libstdc++)
+constexpr size_t kSharedControlBlockBytes = 2 * sizeof(int) + sizeof(void*);   // make_shared控制块(虚表指针+两个计数)
+
+// std::unordered_map/unordered_set：桶数组 + 每个元素一个节点(next指针、元素、缓存的哈希值)
+template<typename Map>
+size_t hashMapBytes(const Map& map)
+{
+    return map.bucket_count() * sizeof(void*)
+        + map.size() * (sizeof(typename Map::value_type) + 2 * sizeof(void*));
+}
+
+// std::map：每个元素一个红黑树节点(颜色+三个指针)
+template<typename Map>
+size_t treeMapBytes(const Map& map)
+{
+    return map.size() * (sizeof(typename Map::value_type) + 4 * sizeof(void*));
+}
+
+// std::list：每个元素一个节点(两个指针)
+template<typename List>
+size_t listBytes(const List& list)
+{
+    return list.size() * (sizeof(typename List::value_type) + 2 * sizeof(void*));
+}
+
+} // namespace MyCache
@@ -0,0 +1,136 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <utility>
+
+#include "KSpinLock.h"
+
+namespace MyCache
+{
+
+// 有界无锁多生产者多消费者队列(Dmitry Vyukov的环形队列)
+// - 每个槽位带一个序列号：等于入队位置时可写，等于入队位置+1时可读
+// - 生产者和消费者各自用CAS推进位置，不需要锁；队满时tryPush返回false
+// - 每个元素的入队位置单调递增，单消费者时可以把出队数量当作"已处理到第几条"的进度
+template<typename T>
+class KMpmcQueue
+{
+public:
+    // 容量向上取整为2的幂
+    explicit KMpmcQueue(size_t capacity)
+        : mask_(roundUp(capacity) - 1)
+        , cells_(new Cell[mask_ + 1])
+        , enqueuePos_(0)
+        , dequeuePos_(0)
+    {
+        for (size_t i = 0; i <= mask_; ++i)
+            cells_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    KMpmcQueue(const KMpmcQueue&) = delete;
+    KMpmcQueue& operator=(const KMpmcQueue&) = delete;
+
+    // 入队，队满返回false
+    template<typename U>
+    bool tryPush(U&& value)
+    {
+        size_t pos = enqueuePos_.load(std::memory_order_relaxed);
+        Cell* cell;
+        while (true)
+        {
+            cell = &cells_[pos & mask_];
+            size_t sequence = cell->sequence.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+            if (diff == 0)
+            {
+                if (enqueuePos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                    break;
+            }
+            else if (diff < 0)
+            {
+                return false;   // 该槽位上一轮的元素还没被取走：队满
+            }
+            else
+            {
+                pos = enqueuePos_.load(std::memory_order_relaxed);
+            }
+        }
+        cell->value = std::forward<U>(value);
+        cell->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    // 入队，队满时自旋等待消费者腾出位置
+    template<typename U>
+    void push(U&& value)
+    {
+        for (int spins = 0; !tryPush(std::forward<U>(value)); ++spins)
+        {
+            if (spins < 64)
+                KSpinLock::cpuRelax();
+            else
+                std::this_thread::yield();
+        }
+    }
+
+    // 出队，队空返回false
+    bool tryPop(T& value)
+    {
+        size_t pos = dequeuePos_.load(std::memory_order_relaxed);
+        Cell* cell;
+        while (true)
+        {
+            cell = &cells_[pos & mask_];
+            size_t sequence = cell->sequence.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos + 1);
+            if (diff == 0)
+            {
+                if (dequeuePos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                    break;
+            }
+            else if (diff < 0)
+            {
+                return false;
+            }
+            else
+            {
+                pos = dequeuePos_.load(std::memory_order_relaxed);
+            }
+        }
+        value = std::move(cell->value);
+        cell->sequence.store(pos + mask_ + 1, std::memory_order_release);
+        return true;
+    }
+
+    // 已分配的入队位置数(包括正在写入、尚不可读的元素)
+    size_t enqueued() const { return enqueuePos_.load(std::memory_order_acquire); }
+
+    size_t capacity() const { return mask_ + 1; }
+
+private:
+    struct Cell
+    {
+        std::atomic<size_t> sequence;
+        T                   value;
+    };
+
+    static size_t roundUp(size_t capacity)
+    {
+        size_t size = 2;
+        while (size < capacity)
+            size <<= 1;
+        return size;
+    }
+
+private:
+    const size_t            mask_;
+    std::unique_ptr<Cell[]> cells_;
+    alignas(64) std::atomic<size_t> enqueuePos_;    // 生产者和消费者的位置放在不同缓存行
+    alignas(64) std::atomic<size_t> dequeuePos_;
+};
+
+} // namespace MyCache
@@ -0,0 +1,632 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <random>
+#include <shared_mutex>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "KAppendLog.h"
+#include "KICachePolicy.h"
+#include "KMpmcQueue.h"
+#include "KSocket.h"
+
+namespace MyCache
+{
+
+// 主从复制(参考Redis)：主节点把写操作按顺序编号，通过Unix域套接字或TCP流式发给副本，
+// 副本按同样的顺序批量应用到自己的KICachePolicy，分担读流量
+// - 写路径与追加日志相同：在缓存锁内把记录放入无锁队列，由后台线程编码后放入复制积压区(backlog)
+// - 每个副本一个发送线程，从副本请求的偏移开始发送；副本应用得慢时套接字写阻塞，只拖慢它自己的发送线程
+// - 偏移已不在积压区中(落后太多，或主节点重启过)的副本做全量同步：先记下当前偏移，再复制缓存快照发送，
+//   之后从记下的偏移继续发送(快照中可能已包含其后的部分写入，按顺序重放后结果一致)
+// - 副本每应用一批就回报偏移，主节点据此统计各副本的延迟
+// 使用POSIX套接字接口
+
+
+struct KReplicationOptions
+{
+    size_t                      queueCapacity = 65536;      // 写路径无锁队列的容量
+    size_t                      backlogRecords = 1 << 20;   // 主节点保留的最近记录数，落后更多的副本需要全量同步
+    size_t                      batchRecords = 4096;        // 每次发送的最多记录数
+    std::chrono::milliseconds   reconnectDelay{100};        // 副本断线后重连的间隔
+};
+
+// 主节点眼中的一个副本
+struct KReplicaStatus
+{
+    uint64_t ackedOffset = 0;   // 副本回报已应用到的偏移
+    uint64_t lagRecords = 0;    // 落后主节点的记录数
+};
+
+struct KReplicationStats
+{
+    uint64_t offset = 0;            // 主节点：已进入积压区的记录数；副本：已应用到的偏移
+    uint64_t fullSyncs = 0;         // 全量同步次数
+    uint64_t partialSyncs = 0;      // 断线后从原偏移继续的次数
+    uint64_t droppedReplicas = 0;   // 主节点：因落后太多被断开的副本数
+    uint64_t appliedRecords = 0;    // 副本：应用的记录数(含快照)
+};
+
+
+// 复制协议的握手
+// 副本 -> 主节点：[8字节runId][8字节偏移]，首次连接时runId为0
+// 主节点 -> 副本：[1字节模式][8字节runId][8字节起始偏移][8字节快照记录数]，之后是记录流
+// 副本 -> 主节点：每应用一批回报[8字节已应用偏移]
+enum class KReplSyncMode : uint8_t
+{
+    Partial = 1,    // 从副本请求的偏移继续
+    Full = 2,       // 先发快照(一条Clear + 全部条目的Put，不占偏移)，再从起始偏移继续
+};
+
+constexpr size_t kReplHelloBytes = 16;
+constexpr size_t kReplHeaderBytes = 25;
+
+
+// 主节点：包装一个缓存，写操作在缓存锁内记录，读操作直接访问缓存
+template<typename Key, typename Value>
+class KReplicationPrimary : public KICachePolicy<Key, Value>
+{
+public:
+    // 监听address，失败抛出std::system_error
+    KReplicationPrimary(KICachePolicy<Key, Value>& cache, const std::string& address,
+                        KReplicationOptions options = KReplicationOptions())
+        : cache_(cache)
+        , address_(address)
+        , options_(options)
+        , queue_(options.queueCapacity)
+        , runId_(makeRunId())
+        , backlogStart_(0)
+        , stopping_(false)
+        , fullSyncs_(0)
+        , partialSyncs_(0)
+        , droppedReplicas_(0)
+    {
+        listenFd_ = KSocket::listen(address_);
+        feeder_ = std::thread(&KReplicationPrimary::feederLoop, this);
+        acceptor_ = std::thread(&KReplicationPrimary::acceptLoop, this);
+    }
+
+    ~KReplicationPrimary() override
+    {
+        stop();
+    }
+
+    KReplicationPrimary(const KReplicationPrimary&) = delete;
+    KReplicationPrimary& operator=(const KReplicationPrimary&) = delete;
+
+    void put(Key key, Value value) override
+    {
+        compute(key, [&](bool, Value& current, uint64_t) {
+            current = value;
+            return KComputeAction::Store;
+        });
+    }
+
+    bool get(Key key, Value& value) override
+    {
+        return cache_.get(key, value);
+    }
+
+    Value get(Key key) override
+    {
+        return cache_.get(key);
+    }
+
+    uint64_t compute(const Key& key, const typename KICachePolicy<Key, Value>::ComputeFunc& func) override
+    {
+        return cache_.compute(key, [&](bool present, Value& value, uint64_t version) {
+            KComputeAction action = func(present, value, version);
+            if (action == KComputeAction::Store)
+                queue_.push(Record{KLogOp::Put, key, value});
+            else if (action == KComputeAction::Remove && present)
+                queue_.push(Record{KLogOp::Remove, key, Value()});
+            return action;
+        });
+    }
+
+    // 删除key，返回是否存在
+    bool remove(const Key& key)
+    {
+        bool removed = false;
+        cache_.compute(key, [&](bool present, Value&, uint64_t) {
+            if (!present)
+                return KComputeAction::Keep;
+            queue_.push(Record{KLogOp::Remove, key, Value()});
+            removed = true;
+            return KComputeAction::Remove;
+        });
+        return removed;
+    }
+
+    // 记录Clear和清空缓存必须一起完成，否则全量同步可能在两者之间记下偏移(已越过Clear)并复制到清空前的快照
+    void clear() override
+    {
+        std::unique_lock<std::shared_mutex> lock(clearMutex_);
+        queue_.push(Record{KLogOp::Clear, Key(), Value()});
+        cache_.clear();
+    }
+
+    void setEvictionListener(typename KICachePolicy<Key, Value>::EvictionListener listener) override
+    {
+        cache_.setEvictionListener(std::move(listener));
+    }
+
+    KMemoryUsage memoryUsage() override
+    {
+        return cache_.memoryUsage();
+    }
+
+    void snapshot(std::vector<std::pair<Key, Value>>& entries) override
+    {
+        cache_.snapshot(entries);
+    }
+
+    // 已连接副本的状态
+    std::vector<KReplicaStatus> replicas()
+    {
+        std::lock_guard<std::mutex> lock(backlogMutex_);
+        std::vector<KReplicaStatus> result;
+        uint64_t end = backlogEnd();
+        for (const auto& session : sessions_.list())
+        {
+            if (!session->active)
+                continue;
+            KReplicaStatus status;
+            status.ackedOffset = session->ackedOffset.load();
+            status.lagRecords = end > status.ackedOffset ? end - status.ackedOffset : 0;
+            result.push_back(status);
+        }
+        return result;
+    }
+
+    KReplicationStats stats()
+    {
+        KReplicationStats stats;
+        {
+            std::lock_guard<std::mutex> lock(backlogMutex_);
+            stats.offset = backlogEnd();
+        }
+        stats.fullSyncs = fullSyncs_.load();
+        stats.partialSyncs = partialSyncs_.load();
+        stats.droppedReplicas = droppedReplicas_.load();
+        return stats;
+    }
+
+    // 停止监听并断开所有副本
+    void stop()
+    {
+        {
+            std::lock_guard<std::mutex> lock(backlogMutex_);
+            if (stopping_)
+                return;
+            stopping_ = true;
+            sessions_.shutdownAll();    // 唤醒阻塞在读写上的发送线程
+        }
+        backlogCv_.notify_all();
+        ::shutdown(listenFd_, SHUT_RDWR);
+        acceptor_.join();
+        feeder_.join();
+        sessions_.closeAll();
+        ::close(listenFd_);
+        KSocket::unlinkAddress(address_);
+    }
+
+private:
+    using Record = KLogRecord<Key, Value>;
+
+    struct Session : KSocketSession
+    {
+        using KSocketSession::KSocketSession;
+
+        std::atomic<uint64_t>   ackedOffset{0};
+    };
+
+    static uint64_t makeRunId()
+    {
+        std::random_device device;
+        uint64_t id = (static_cast<uint64_t>(device()) << 32) ^ device()
+            ^ static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+        return id ? id : 1;
+    }
+
+    uint64_t backlogEnd() const { return backlogStart_ + backlog_.size(); }
+
+    // 把队列中的记录编码后放入积压区，超出容量的旧记录丢弃
+    void feederLoop()
+    {
+        std::vector<std::string> batch;
+        Record record;
+        while (true)
+        {
+            batch.clear();
+            while (batch.size() < options_.batchRecords && queue_.tryPop(record))
+            {
+                batch.emplace_back();
+                Record::encode(batch.back(), record.op, record.key, &record.value);
+            }
+            std::unique_lock<std::mutex> lock(backlogMutex_);
+            if (batch.empty())
+            {
+                if (stopping_)
+                    break;
+                // 写路径不通知(避免在热路径上加锁)，空闲时按短间隔轮询
+                lock.unlock();
+                std::this_thread::sleep_for(kIdleWait);
+                continue;
+            }
+            for (auto& encoded : batch)
+                backlog_.push_back(std::move(encoded));
+            while (backlog_.size() > options_.backlogRecords)
+            {
+                backlog_.pop_front();
+                ++backlogStart_;
+            }
+            lock.unlock();
+            backlogCv_.notify_all();
+        }
+    }
+
+    void acceptLoop()
+    {
+        sessions_.acceptLoop(listenFd_, backlogMutex_, stopping_, [this](Session* session) {
+            session->thread = std::thread(&KReplicationPrimary::serveReplica, this, session);
+        });
+    }
+
+    // 一个副本的发送线程：握手、(必要时)全量同步，然后持续发送积压区中的记录
+    void serveReplica(Session* session)
+    {
+        char hello[kReplHelloBytes];
+        if (KSocket::readAll(session->fd, hello, sizeof(hello)))
+        {
+            uint64_t runId, offset;
+            std::memcpy(&runId, hello, 8);
+            std::memcpy(&offset, hello + 8, 8);
+            streamTo(session, runId, offset);
+        }
+        ::shutdown(session->fd, SHUT_RDWR);     // 让副本立即感知断开，fd由acceptLoop或stop回收
+        std::lock_guard<std::mutex> lock(backlogMutex_);
+        session->active = false;
+    }
+
+    void streamTo(Session* session, uint64_t runId, uint64_t offset)
+    {
+        uint64_t pos;
+        std::string buffer;
+        {
+            std::lock_guard<std::mutex> lock(backlogMutex_);
+            bool partial = runId == runId_ && offset >= backlogStart_ && offset <= backlogEnd();
+            pos = offset;
+            if (partial)
+                appendHeader(buffer, KReplSyncMode::Partial, pos, 0);
+        }
+        if (buffer.empty())
+        {
+            // 全量同步：先记下偏移再复制快照，快照一定包含该偏移之前的所有写入
+            std::vector<std::pair<Key, Value>> entries;
+            {
+                std::shared_lock<std::shared_mutex> lock(clearMutex_);   // 不能落在clear的两步之间
+                pos = queue_.enqueued();
+                cache_.snapshot(entries);
+            }
+            appendHeader(buffer, KReplSyncMode::Full, pos, entries.size() + 1);
+            Record::encode(buffer, KLogOp::Clear, Key(), nullptr);
+            for (const auto& entry : entries)
+                Record::encode(buffer, KLogOp::Put, entry.first, &entry.second);
+            ++fullSyncs_;
+        }
+        else
+        {
+            ++partialSyncs_;
+        }
+        session->ackedOffset = pos;
+        if (!KSocket::writeAll(session->fd, buffer.data(), buffer.size()))
+            return;
+
+        std::string acks;
+        while (true)
+        {
+            readAcks(session, acks);
+            buffer.clear();
+            {
+                std::unique_lock<std::mutex> lock(backlogMutex_);
+                backlogCv_.wait_for(lock, kAckPoll, [&] { return stopping_ || backlogEnd() > pos; });
+                if (stopping_)
+                    return;
+                if (pos < backlogStart_)
+                {
+                    ++droppedReplicas_;     // 落后太多，断开后副本会重连并全量同步
+                    return;
+                }
+                uint64_t end = std::min<uint64_t>(backlogEnd(), pos + options_.batchRecords);
+                for (uint64_t i = pos; i < end; ++i)
+                    buffer.append(backlog_[i - backlogStart_]);
+                pos = end;
+            }
+            if (!buffer.empty() && !KSocket::writeAll(session->fd, buffer.data(), buffer.size()))
+                return;
+        }
+    }
+
+    void appendHeader(std::string& out, KReplSyncMode mode, uint64_t offset, uint64_t snapshotRecords)
+    {
+        char header[kReplHeaderBytes];
+        header[0] = static_cast<char>(mode);
+        std::memcpy(header + 1, &runId_, 8);
+        std::memcpy(header + 9, &offset, 8);
+        std::memcpy(header + 17, &snapshotRecords, 8);
+        out.append(header, sizeof(header));
+    }
+
+    // 非阻塞地读取副本回报的偏移，只保留最新的一个
+    void readAcks(Session* session, std::string& pending)
+    {
+        char buf[256];
+        ssize_t n;
+        while ((n = ::recv(session->fd, buf, sizeof(buf), MSG_DONTWAIT)) > 0)
+            pending.append(buf, static_cast<size_t>(n));
+        size_t complete = pending.size() / 8 * 8;
+        if (complete == 0)
+            return;
+        uint64_t offset;
+        std::memcpy(&offset, pending.data() + complete - 8, 8);
+        session->ackedOffset = offset;
+        pending.erase(0, complete);
+    }
+
+private:
+    static constexpr std::chrono::milliseconds kIdleWait{1};
+    static constexpr std::chrono::milliseconds kAckPoll{10};   // 没有新记录时检查副本回报的间隔
+
+    KICachePolicy<Key, Value>&  cache_;
+    const std::string           address_;
+    const KReplicationOptions   options_;
+    KMpmcQueue<Record>          queue_;
+    const uint64_t              runId_;     // 每次启动随机生成，副本据此判断偏移是否还有效
+    int                         listenFd_;
+    std::shared_mutex           clearMutex_;    // clear独占，全量同步的"记下偏移+复制快照"共享
+
+    std::mutex                  backlogMutex_;  // 保护积压区、会话列表和停止标志
+    std::condition_variable     backlogCv_;     // 积压区有新记录时通知发送线程
+    std::deque<std::string>     backlog_;       // 最近的已编码记录
+    uint64_t                    backlogStart_;  // backlog_第一条记录的偏移
+    KSocketSessions<Session>    sessions_;
+    bool                        stopping_;
+
+    std::thread                 feeder_;
+    std::thread                 acceptor_;
+
+    std::atomic<uint64_t>       fullSyncs_;
+    std::atomic<uint64_t>       partialSyncs_;
+    std::atomic<uint64_t>       droppedReplicas_;
+};
+
+
+// 副本：连接主节点，把收到的记录按顺序批量应用到cache(连续的写入合并为一次bulkLoad)
+// 断线后自动重连，带上已应用的偏移请求增量同步
+template<typename Key, typename Value>
+class KReplica
+{
+public:
+    // 每应用完一批记录后调用，参数为已应用到的偏移(在复制线程中执行)
+    using ApplyListener = std::function<void(uint64_t offset)>;
+
+    KReplica(KICachePolicy<Key, Value>& cache, const std::string& address,
+             KReplicationOptions options = KReplicationOptions())
+        : cache_(cache)
+        , address_(address)
+        , options_(options)
+        , runId_(0)
+        , offset_(0)
+        , fd_(-1)
+        , stopping_(false)
+        , connected_(false)
+        , fullSyncs_(0)
+        , partialSyncs_(0)
+        , appliedRecords_(0)
+    {}
+
+    ~KReplica()
+    {
+        stop();
+    }
+
+    KReplica(const KReplica&) = delete;
+    KReplica& operator=(const KReplica&) = delete;
+
+    // 应在start之前设置
+    void setApplyListener(ApplyListener listener)
+    {
+        listener_ = std::move(listener);
+    }
+
+    void start()
+    {
+        if (thread_.joinable())
+            return;
+        stopping_ = false;
+        thread_ = std::thread(&KReplica::run, this);
+    }
+
+    void stop()
+    {
+        if (!thread_.joinable())
+            return;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+            if (fd_ >= 0)
+                ::shutdown(fd_, SHUT_RDWR);
+        }
+        stopCv_.notify_all();
+        thread_.join();
+    }
+
+    uint64_t appliedOffset() const { return offset_.load(); }
+
+    bool connected() const { return connected_.load(); }
+
+    KReplicationStats stats() const
+    {
+        KReplicationStats stats;
+        stats.offset = offset_.load();
+        stats.fullSyncs = fullSyncs_.load();
+        stats.partialSyncs = partialSyncs_.load();
+        stats.appliedRecords = appliedRecords_.load();
+        return stats;
+    }
+
+private:
+    using Record = KLogRecord<Key, Value>;
+
+    void run()
+    {
+        while (true)
+        {
+            int fd = KSocket::connect(address_);
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                if (stopping_)
+                {
+                    if (fd >= 0)
+                        ::close(fd);
+                    return;
+                }
+                fd_ = fd;
+            }
+            if (fd >= 0)
+            {
+                session(fd);
+                connected_ = false;
+                std::lock_guard<std::mutex> lock(mutex_);
+                fd_ = -1;
+                ::close(fd);
+            }
+            std::unique_lock<std::mutex> lock(mutex_);
+            if (stopCv_.wait_for(lock, options_.reconnectDelay, [&] { return stopping_; }))
+                return;
+        }
+    }
+
+    void session(int fd)
+    {
+        char hello[kReplHelloBytes];
+        uint64_t offset = offset_.load();
+        std::memcpy(hello, &runId_, 8);
+        std::memcpy(hello + 8, &offset, 8);
+        char header[kReplHeaderBytes];
+        if (!KSocket::writeAll(fd, hello, sizeof(hello)) || !KSocket::readAll(fd, header, sizeof(header)))
+            return;
+
+        KReplSyncMode mode = static_cast<KReplSyncMode>(header[0]);
+        uint64_t runId, snapshotRecords;
+        std::memcpy(&runId, header + 1, 8);
+        std::memcpy(&offset, header + 9, 8);
+        std::memcpy(&snapshotRecords, header + 17, 8);
+        if (mode == KReplSyncMode::Full)
+        {
+            runId_ = 0;     // 快照收完之前断线需要重新全量同步
+            ++fullSyncs_;
+        }
+        else
+        {
+            ++partialSyncs_;
+        }
+        offset_ = offset;
+        connected_ = true;
+
+        std::string pending;
+        std::vector<std::pair<Key, Value>> puts;
+        char buf[64 * 1024];
+        while (true)
+        {
+            ssize_t n = ::recv(fd, buf, sizeof(buf), 0);
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n <= 0)
+                return;
+            pending.append(buf, static_cast<size_t>(n));
+
+            uint64_t applied = 0, records = 0;
+            size_t consumed = Record::parse(pending.data(), pending.size(), [&](KLogOp op, Key& key, Value& value) {
+                if (op == KLogOp::Put)
+                {
+                    puts.emplace_back(std::move(key), std::move(value));
+                }
+                else
+                {
+                    flushPuts(puts);
+                    if (op == KLogOp::Clear)
+                        cache_.clear();
+                    else
+                        cache_.compute(key, [](bool present, Value&, uint64_t) {
+                            return present ? KComputeAction::Remove : KComputeAction::Keep;
+                        });
+                }
+                ++records;
+                if (snapshotRecords > 0)
+                    --snapshotRecords;      // 快照记录不占偏移
+                else
+                    ++applied;
+            });
+            flushPuts(puts);
+            pending.erase(0, consumed);
+            if (consumed == 0)
+                continue;
+
+            appliedRecords_ += records;
+            offset_ += applied;
+            if (snapshotRecords == 0)
+                runId_ = runId;
+            uint64_t ack = offset_.load();
+            if (!KSocket::writeAll(fd, reinterpret_cast<const char*>(&ack), sizeof(ack)))
+                return;
+            if (listener_)
+                listener_(ack);
+        }
+    }
+
+    void flushPuts(std::vector<std::pair<Key, Value>>& puts)
+    {
+        if (puts.empty())
+            return;
+        cache_.bulkLoad(puts);
+        puts.clear();
+    }
+
+private:
+    KICachePolicy<Key, Value>&  cache_;
+    const std::string           address_;
+    const KReplicationOptions   options_;
+    ApplyListener               listener_;
+
+    uint64_t                    runId_;     // 只在复制线程中访问
+    std::atomic<uint64_t>       offset_;
+
+    std::mutex                  mutex_;     // 保护fd_和停止标志
+    std::condition_variable     stopCv_;
+    int                         fd_;
+    bool                        stopping_;
+    std::atomic<bool>           connected_;
+    std::thread                 thread_;
+
+    std::atomic<uint64_t>       fullSyncs_;
+    std::atomic<uint64_t>       partialSyncs_;
+    std::atomic<uint64_t>       appliedRecords_;
+};
+
+} // namespace MyCache
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+namespace MyCache
+{
+
+// 无锁读缓存中value的存储方式
+// - 小的可平凡复制类型(计数器、ID、定长结构体)：内联存储并由序列号(seqlock)保护，
+//   写者就地修改value，读者不加锁，读到一半遇到写入就重试
+// - 其他类型：value发布后只读，更新时由缓存整体替换条目
+
+
+// 是否使用seqlock内联存储：可平凡复制且不超过一个缓存行，重试时的复制开销才足够小
+template<typename Value>
+constexpr bool kSeqlockEligible = std::is_trivially_copyable<Value>::value && sizeof(Value) <= 64;
+
+
+// seqlock保护的内联value，只允许一个写者(由缓存的写锁保证)
+// 数据按8字节拆成原子字做relaxed读写，并发读写不构成数据竞争
+template<typename Value>
+class KSeqlockValue
+{
+public:
+    static constexpr bool kInPlace = true;     // 支持就地更新
+
+    explicit KSeqlockValue(const Value& value)
+        : seq_(0)
+    {
+        storeWords(value);
+    }
+
+    // 读取value：序列号为奇数(正在写)或前后不一致时重试
+    void load(Value& out) const
+    {
+        uint64_t buf[kWords];
+        while (true)
+        {
+            uint64_t seq = seq_.load(std::memory_order_acquire);
+            if (seq & 1)
+            {
+                cpuRelax();
+                continue;
+            }
+            for (size_t i = 0; i < kWords; ++i)
+                buf[i] = words_[i].load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (seq_.load(std::memory_order_relaxed) == seq)
+                break;
+        }
+        std::memcpy(&out, buf, sizeof(Value));
+    }
+
+    // 写入value，调用方必须持有写锁
+    void store(const Value& value)
+    {
+        uint64_t seq = seq_.load(std::memory_order_relaxed);
+        seq_.store(seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        storeWords(value);
+        seq_.store(seq + 2, std::memory_order_release);
+    }
+
+private:
+    static constexpr size_t kWords = (sizeof(Value) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+
+    void storeWords(const Value& value)
+    {
+        uint64_t buf[kWords] = {};
+        std::memcpy(buf, &value, sizeof(Value));
+        for (size_t i = 0; i < kWords; ++i)
+            words_[i].store(buf[i], std::memory_order_relaxed);
+    }
+
+    static void cpuRelax()
+    {
+#if defined(__x86_64__) || defined(__i386__)
+        _mm_pause();
+#endif
+    }
+
+private:
+    std::atomic<uint64_t> seq_;             // 偶数表示稳定，奇数表示正在写
+    std::atomic<uint64_t> words_[kWords];
+};
+
+
+// 发布后只读的value
+template<typename Value>
+class KImmutableValue
+{
+public:
+    static constexpr bool kInPlace = false;
+
+    explicit KImmutableValue(const Value& value) : value_(value) {}
+
+    void load(Value& out) const { out = value_; }
+
+private:
+    Value value_;
+};
+
+
+template<typename Value>
+using KValueCell = typename std::conditional<kSeqlockEligible<Value>,
+    KSeqlockValue<Value>, KImmutableValue<Value>>::type;
+
+} // namespace MyCache
@@ -0,0 +1,298 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <type_traits>
+#include <vector>
+
+#include "KEventTrace.h"
+#include "KHashedKey.h"
+#include "KICachePolicy.h"
+#include "KSpinLock.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace MyCache
+{
+
+// 组相联缓存(参考CPU缓存的设计)，适合key和value都是定长可平凡复制类型的场景
+// - key哈希到某一组，每组Ways(8或16)路，tag/key/value连续存放在一到两个缓存行中
+// - 组内用1字节tag做SIMD比较(SSE2，不支持时用SWAR)，再比对key
+// - 每组一个自旋锁和Ways-1位的树形伪LRU(tree-PLRU)，组内满时淘汰PLRU指向的路
+// - 没有全局链表和全局锁，构造之后不再分配内存；代价是只在组内淘汰，热点集中在一组时命中率低于全局LRU
+template<typename Key, typename Value, size_t Ways = 8>
+class KSetAssocCache : public KICachePolicy<Key, Value>
+{
+    static_assert(Ways == 8 || Ways == 16, "KSetAssocCache只支持8路或16路");
+    static_assert(std::is_trivially_copyable<Key>::value && std::is_trivially_copyable<Value>::value,
+        "KSetAssocCache要求key和value都是可平凡复制的定长类型");
+
+private:
+    // 一组：tag在最前面，查找时先只读第一个缓存行
+    struct alignas(64) Set
+    {
+        uint8_t  tags[Ways];            // 0表示空路
+        KSpinLock lock;                 // 临界区只有几十条指令，不值得让线程睡眠
+        uint16_t plru = 0;              // tree-PLRU位，节点按堆序编号，1表示淘汰目标在右子树
+        Key      keys[Ways];
+        Value    values[Ways];
+
+        Set() { std::memset(tags, 0, sizeof(tags)); }
+    };
+
+public:
+    // 容量向上取整为Ways的整数倍
+    explicit KSetAssocCache(size_t capacity)
+        : setCount_(capacity ? (capacity + Ways - 1) / Ways : 0)
+        , sets_(setCount_)
+        , versions_(setCount_ * Ways, 0)
+        , versionCounter_(0)
+    {}
+
+    ~KSetAssocCache() override = default;
+
+    KSetAssocCache(const KSetAssocCache&) = delete;
+    KSetAssocCache& operator=(const KSetAssocCache&) = delete;
+
+    void put(Key key, Value value) override
+    {
+        compute(key, [&](bool, Value& current, uint64_t) {
+            current = value;
+            return KComputeAction::Store;
+        });
+    }
+
+    bool get(Key key, Value& value) override
+    {
+        if (setCount_ == 0)
+            return false;
+        KHashedKey<Key> hashedKey(key);
+        Set& set = setOf(hashedKey.hash);
+        std::lock_guard<KSpinLock> lock(set.lock);
+        int way = findWay(set, tagOf(hashedKey.hash), key);
+        if (way < 0)
+            return false;
+        touch(set, way);
+        value = set.values[way];
+        return true;
+    }
+
+    Value get(Key key) override
+    {
+        Value value{};
+        get(key, value);
+        return value;
+    }
+
+    uint64_t compute(const Key& key, const typename KICachePolicy<Key, Value>::ComputeFunc& func) override
+    {
+        if (setCount_ == 0)
+            return 0;
+        KHashedKey<Key> hashedKey(key);
+        size_t setIndex = setIndexOf(hashedKey.hash);
+        Set& set = sets_[setIndex];
+        uint8_t tag = tagOf(hashedKey.hash);
+        std::lock_guard<KSpinLock> lock(set.lock);
+
+        int way = findWay(set, tag, key);
+        if (way >= 0)
+        {
+            uint64_t& version = versions_[setIndex * Ways + way];
+            Value value = set.values[way];
+            switch (func(true, value, version))
+            {
+            case KComputeAction::Keep:
+                touch(set, way);
+                return version;
+            case KComputeAction::Store:
+                set.values[way] = value;
+                version = nextVersion();
+                touch(set, way);
+                return version;
+            case KComputeAction::Remove:
+                set.tags[way] = 0;
+                return 0;
+            }
+            return 0;
+        }
+
+        Value value{};
+        if (func(false, value, 0) != KComputeAction::Store)
+            return 0;
+
+        // 优先使用空路，组满时淘汰PLRU指向的路
+        uint32_t empty = matchTags(set.tags, 0);
+        if (empty)
+        {
+            way = lowestBit(empty);
+        }
+        else
+        {
+            way = static_cast<int>(victim(set));
+            MYCACHE_TRACE_INSTANT(Evict, "KSetAssocCache", setIndex);
+            this->notifyEvicted(set.keys[way], set.values[way]);
+        }
+        set.tags[way] = tag;
+        set.keys[way] = key;
+        set.values[way] = value;
+        touch(set, way);
+        return versions_[setIndex * Ways + way] = nextVersion();
+    }
+
+    // 逐组清空(O(n))
+    void clear() override
+    {
+        for (auto& set : sets_)
+        {
+            std::lock_guard<KSpinLock> lock(set.lock);
+            std::memset(set.tags, 0, sizeof(set.tags));
+            set.plru = 0;
+        }
+    }
+
+    size_t capacity() const { return setCount_ * Ways; }
+
+    // 快照(逐组加锁复制，按组和路的顺序，没有全局的冷热顺序)
+    void snapshot(std::vector<std::pair<Key, Value>>& entries) override
+    {
+        for (auto& set : sets_)
+        {
+            std::lock_guard<KSpinLock> lock(set.lock);
+            for (size_t way = 0; way < Ways; ++way)
+            {
+                if (set.tags[way] != 0)
+                    entries.emplace_back(set.keys[way], set.values[way]);
+            }
+        }
+    }
+
+    // 内存统计：所有空间在构造时一次分配，与条目数无关。
+    // 每组的tag、锁和PLRU位为索引，key/value数组为有效数据，对齐填充和版本号数组为管理开销
+    KMemoryUsage memoryUsage() override
+    {
+        KMemoryUsage usage;
+        for (auto& set : sets_)
+        {
+            std::lock_guard<KSpinLock> lock(set.lock);
+            for (size_t way = 0; way < Ways; ++way)
+                usage.entries += set.tags[way] != 0;
+        }
+        usage.indexBytes = setCount_ * offsetof(Set, keys);
+        usage.payloadBytes = setCount_ * Ways * (sizeof(Key) + sizeof(Value));
+        usage.metadataBytes = setCount_ * sizeof(Set) - usage.indexBytes - usage.payloadBytes
+            + versions_.capacity() * sizeof(uint64_t);
+        return usage;
+    }
+
+private:
+    static uint8_t tagOf(uint64_t hash)
+    {
+        uint8_t tag = static_cast<uint8_t>(hash >> 56);
+        return tag ? tag : 1;
+    }
+
+    // 用哈希值的低32位选择组(乘法取范围，组数不必是2的幂)，高位留给tag
+    size_t setIndexOf(uint64_t hash) const
+    {
+        return static_cast<size_t>(((hash & 0xffffffffULL) * setCount_) >> 32);
+    }
+
+    Set& setOf(uint64_t hash)
+    {
+        return sets_[setIndexOf(hash)];
+    }
+
+    uint64_t nextVersion()
+    {
+        return versionCounter_.fetch_add(1, std::memory_order_relaxed) + 1;
+    }
+
+    int findWay(const Set& set, uint8_t tag, const Key& key) const
+    {
+        uint32_t match = matchTags(set.tags, tag);
+        while (match)
+        {
+            int way = lowestBit(match);
+            if (set.keys[way] == key)
+                return way;
+            match &= match - 1;
+        }
+        return -1;
+    }
+
+    // 返回组内tag等于给定值的路的位掩码
+    static uint32_t matchTags(const uint8_t* tags, uint8_t tag)
+    {
+#if defined(__SSE2__)
+        __m128i needle = _mm_set1_epi8(static_cast<char>(tag));
+        __m128i group = Ways == 16
+            ? _mm_loadu_si128(reinterpret_cast<const __m128i*>(tags))
+            : _mm_loadl_epi64(reinterpret_cast<const __m128i*>(tags));
+        uint32_t mask = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(group, needle)));
+        return Ways == 16 ? mask : mask & 0xff;
+#else
+        // SWAR：每次比较8个tag，相等的字节异或后为0，再用"含零字节"技巧找出来。
+        // 该技巧在零字节之后可能误报，调用方还会比对key，误报无害
+        const uint64_t ones = 0x0101010101010101ULL;
+        const uint64_t highs = 0x8080808080808080ULL;
+        uint32_t mask = 0;
+        for (size_t base = 0; base < Ways; base += 8)
+        {
+            uint64_t word;
+            std::memcpy(&word, tags + base, sizeof(word));
+            uint64_t diff = word ^ (ones * tag);
+            uint64_t zeros = (diff - ones) & ~diff & highs;
+            while (zeros)
+            {
+                mask |= 1u << (base + __builtin_ctzll(zeros) / 8);
+                zeros &= zeros - 1;
+            }
+        }
+        return mask;
+#endif
+    }
+
+    static int lowestBit(uint32_t mask)
+    {
+        return __builtin_ctz(mask);
+    }
+
+    // 访问某一路：把从根到该路径上的节点都指向另一侧
+    static void touch(Set& set, size_t way)
+    {
+        size_t node = 0;
+        for (size_t level = kLevels; level-- > 0;)
+        {
+            size_t right = (way >> level) & 1;
+            if (right)
+                set.plru &= static_cast<uint16_t>(~(1u << node));
+            else
+                set.plru |= static_cast<uint16_t>(1u << node);
+            node = 2 * node + 1 + right;
+        }
+    }
+
+    // 沿PLRU位从根走到叶子，得到淘汰的路
+    static size_t victim(const Set& set)
+    {
+        size_t node = 0;
+        for (size_t level = 0; level < kLevels; ++level)
+            node = 2 * node + 1 + ((set.plru >> node) & 1);
+        return node - (Ways - 1);
+    }
+
+private:
+    static constexpr size_t kLevels = Ways == 16 ? 4 : 3;  // PLRU树的层数
+
+    size_t                  setCount_;      // 组数
+    std::vector<Set>        sets_;
+    std::vector<uint64_t>   versions_;      // 每一路的版本号，只在compute中使用，与热数据分开存放
+    std::atomic<uint64_t>   versionCounter_;
+};
+
+} // namespace MyCache
@@ -0,0 +1,586 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "KHashedKey.h"
+#include "KICachePolicy.h"
+
+namespace MyCache
+{
+
+// 跨进程共享的缓存：索引、元数据和value都放在/dev/shm的一块共享内存中(shm_open + mmap)，
+// 同一主机上的多个进程映射同一块区域，热数据只存一份
+// - 各进程映射的地址不同，区域内不存指针：条目、桶链表都用下标表示，所有偏移由构造参数算出
+// - 按哈希值高位分片，每片一个进程间共享的健壮(robust)互斥锁，片内是定长的条目数组和value区
+// - 淘汰用CLOCK：访问时置引用位，需要空位时时钟指针扫过条目，清掉引用位或淘汰未被引用的条目
+// - 持锁的进程崩溃后，下一个加锁的进程得到EOWNERDEAD：该分片可能只改了一半，直接清空重建后
+//   标记为一致，区域不会被卡死(缓存语义，丢掉一个分片的数据是安全的)
+// - 创建者在初始化完成前崩溃时，下一个打开的进程接手重新初始化，不会一直等待
+// - read()在锁内把value的原始字节交给回调，不需要复制到进程私有内存
+// key必须是可平凡复制的定长类型；value是可平凡复制的类型或std::string，编码后超过valueBytes的不缓存
+// 只支持Linux
+
+
+// value在共享内存中的编码：可平凡复制的类型直接复制字节
+template<typename T, typename Enable = void>
+struct KShmValueCodec
+{
+    static_assert(std::is_trivially_copyable<T>::value, "该类型不能直接放入共享内存，需要特化KShmValueCodec");
+
+    static size_t size(const T&) { return sizeof(T); }
+    static void store(char* dst, const T& value) { std::memcpy(dst, &value, sizeof(T)); }
+    static bool load(const char* src, size_t size, T& value)
+    {
+        if (size != sizeof(T))
+            return false;
+        std::memcpy(&value, src, sizeof(T));
+        return true;
+    }
+};
+
+template<>
+struct KShmValueCodec<std::string>
+{
+    static size_t size(const std::string& value) { return value.size(); }
+    static void store(char* dst, const std::string& value) { std::memcpy(dst, value.data(), value.size()); }
+    static bool load(const char* src, size_t size, std::string& value)
+    {
+        value.assign(src, size);
+        return true;
+    }
+};
+
+
+struct KShmCacheOptions
+{
+    size_t valueBytes = 256;    // 每个条目的value区大小
+    size_t shards = 16;         // 分片数(每片一把锁)
+};
+
+// 所有进程共享的统计(保存在共享内存中)
+struct KShmCacheStats
+{
+    uint64_t entries = 0;
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t evictions = 0;
+    uint64_t rejected = 0;      // value过大未缓存的次数
+    uint64_t recoveries = 0;    // 持锁进程崩溃后重建分片的次数
+};
+
+
+template<typename Key, typename Value>
+class KShmCache : public KICachePolicy<Key, Value>
+{
+    static_assert(std::is_trivially_copyable<Key>::value, "KShmCache要求key是可平凡复制的定长类型");
+
+    using Codec = KShmValueCodec<Value>;
+
+public:
+    // 打开(不存在时创建)名为name的共享缓存，name的格式同shm_open("/xxx")
+    // 已存在时布局参数(容量、key大小、valueBytes、分片数)必须一致，失败抛出std::system_error
+    KShmCache(const std::string& name, size_t capacity, KShmCacheOptions options = KShmCacheOptions())
+    {
+        layout_.keySize = sizeof(Key);
+        layout_.valueBytes = options.valueBytes;
+        layout_.shardCount = std::max<size_t>(options.shards, 1);
+        layout_.entriesPerShard = std::max<size_t>((capacity + layout_.shardCount - 1) / layout_.shardCount, 1);
+        layout_.bucketsPerShard = 1;
+        while (layout_.bucketsPerShard < layout_.entriesPerShard)
+            layout_.bucketsPerShard <<= 1;
+        bucketsOffset_ = alignUp(sizeof(ShardHeader));
+        entriesOffset_ = alignUp(bucketsOffset_ + layout_.bucketsPerShard * sizeof(uint32_t));
+        arenaOffset_ = alignUp(entriesOffset_ + layout_.entriesPerShard * sizeof(Entry));
+        layout_.shardBytes = alignUp(arenaOffset_ + layout_.entriesPerShard * layout_.valueBytes);
+        mapSize_ = alignUp(sizeof(Header)) + layout_.shardCount * layout_.shardBytes;
+
+        // 创建和初始化都在共享内存文件的flock下进行，初始化完成前打开的进程阻塞在flock上；
+        // 初始化的进程中途崩溃时锁随之释放，下一个拿到锁的进程读不到魔数，清零后重新初始化
+        int fd = ::shm_open(name.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+        if (fd < 0)
+            throw std::system_error(errno, std::generic_category(), "打开共享内存失败: " + name);
+        uint64_t magic = 0;
+        if (::flock(fd, LOCK_EX) != 0 || ::pread(fd, &magic, sizeof(magic), 0) < 0)
+        {
+            int error = errno;
+            ::close(fd);
+            throw std::system_error(error, std::generic_category(), "锁定共享内存失败: " + name);
+        }
+        bool creator = magic != kMagic;
+        if (creator && (::ftruncate(fd, 0) != 0 || ::ftruncate(fd, static_cast<off_t>(mapSize_)) != 0))
+        {
+            int error = errno;
+            ::close(fd);
+            ::shm_unlink(name.c_str());
+            throw std::system_error(error, std::generic_category(), "设置共享内存大小失败: " + name);
+        }
+        if (!creator && fileSize(fd) != mapSize_)
+        {
+            ::close(fd);
+            throw std::system_error(EINVAL, std::generic_category(), "共享缓存的布局与已有的不一致: " + name);
+        }
+        void* memory = ::mmap(nullptr, mapSize_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (memory == MAP_FAILED)
+        {
+            int error = errno;
+            ::close(fd);
+            throw std::system_error(error, std::generic_category(), "映射共享内存失败: " + name);
+        }
+        base_ = static_cast<char*>(memory);
+
+        Header* header = reinterpret_cast<Header*>(base_);
+        if (creator)
+        {
+            header->layout = layout_;
+            for (size_t i = 0; i < layout_.shardCount; ++i)
+                initShard(i);
+            header->magic.store(kMagic, std::memory_order_release);
+        }
+        // 映射持有文件的引用，close不会释放flock，需要显式解锁
+        ::flock(fd, LOCK_UN);
+        ::close(fd);
+        if (!creator && std::memcmp(&header->layout, &layout_, sizeof(Layout)) != 0)
+        {
+            ::munmap(memory, mapSize_);
+            throw std::system_error(EINVAL, std::generic_category(), "共享缓存的布局与已有的不一致: " + name);
+        }
+    }
+
+    ~KShmCache() override
+    {
+        ::munmap(base_, mapSize_);
+    }
+
+    KShmCache(const KShmCache&) = delete;
+    KShmCache& operator=(const KShmCache&) = delete;
+
+    // 删除共享内存的名字，已映射的进程不受影响
+    static void unlink(const std::string& name)
+    {
+        ::shm_unlink(name.c_str());
+    }
+
+    void put(Key key, Value value) override
+    {
+        compute(key, [&](bool, Value& current, uint64_t) {
+            current = value;
+            return KComputeAction::Store;
+        });
+    }
+
+    bool get(Key key, Value& value) override
+    {
+        bool found = false;
+        read(key, [&](const char* data, size_t size) {
+            found = Codec::load(data, size, value);
+        });
+        return found;
+    }
+
+    Value get(Key key) override
+    {
+        Value value{};
+        get(key, value);
+        return value;
+    }
+
+    // 零复制读取：命中时在分片锁内调用func(const char* data, size_t size)，data指向共享内存中的value
+    // func不能保存data，也不能再访问本缓存
+    template<typename Func>
+    bool read(const Key& key, Func&& func)
+    {
+        KHashedKey<Key> hashedKey(key);
+        ShardLock lock(*this, shardOf(hashedKey));
+        uint32_t index = find(lock.shard, hashedKey);
+        if (index == kNone)
+        {
+            ++lock.header->misses;
+            return false;
+        }
+        Entry& entry = entryAt(lock.shard, index);
+        entry.referenced = 1;
+        ++lock.header->hits;
+        func(valueAt(lock.shard, index), entry.valueSize);
+        return true;
+    }
+
+    uint64_t compute(const Key& key, const typename KICachePolicy<Key, Value>::ComputeFunc& func) override
+    {
+        KHashedKey<Key> hashedKey(key);
+        ShardLock lock(*this, shardOf(hashedKey));
+        uint32_t index = find(lock.shard, hashedKey);
+        if (index != kNone)
+        {
+            Entry& entry = entryAt(lock.shard, index);
+            Value value{};
+            Codec::load(valueAt(lock.shard, index), entry.valueSize, value);
+            switch (func(true, value, entry.version))
+            {
+            case KComputeAction::Keep:
+                entry.referenced = 1;
+                return entry.version;
+            case KComputeAction::Store:
+                if (Codec::size(value) > layout_.valueBytes)
+                {
+                    ++lock.header->rejected;
+                    unlinkEntry(lock.shard, index);
+                    release(lock.shard, index);
+                    return 0;
+                }
+                storeValue(lock.shard, index, value);
+                entry.version = ++lock.header->versionCounter;
+                entry.referenced = 1;
+                return entry.version;
+            case KComputeAction::Remove:
+                unlinkEntry(lock.shard, index);
+                release(lock.shard, index);
+                return 0;
+            }
+            return 0;
+        }
+
+        Value value{};
+        if (func(false, value, 0) != KComputeAction::Store)
+            return 0;
+        if (Codec::size(value) > layout_.valueBytes)
+        {
+            ++lock.header->rejected;
+            return 0;
+        }
+        index = allocate(lock.shard);
+        Entry& entry = entryAt(lock.shard, index);
+        entry.hash = hashedKey.hash;
+        std::memcpy(&entry.key, &key, sizeof(Key));
+        storeValue(lock.shard, index, value);
+        entry.version = ++lock.header->versionCounter;
+        entry.referenced = 0;   // 新条目先不置引用位，没有再被访问的话下一轮就淘汰
+        entry.used = 1;
+        uint32_t& head = bucketAt(lock.shard, hashedKey.hash);
+        entry.next = head;
+        head = index;
+        ++lock.header->count;
+        return entry.version;
+    }
+
+    // 逐个分片清空
+    void clear() override
+    {
+        for (size_t i = 0; i < layout_.shardCount; ++i)
+        {
+            ShardLock lock(*this, i);
+            resetShard(lock.shard);
+        }
+    }
+
+    size_t capacity() const { return layout_.shardCount * layout_.entriesPerShard; }
+
+    // 快照：逐个分片加锁复制，片内从时钟指针处开始(大致从冷到热)
+    void snapshot(std::vector<std::pair<Key, Value>>& entries) override
+    {
+        for (size_t i = 0; i < layout_.shardCount; ++i)
+        {
+            ShardLock lock(*this, i);
+            for (size_t n = 0; n < layout_.entriesPerShard; ++n)
+            {
+                uint32_t index = static_cast<uint32_t>((lock.header->clockHand + n) % layout_.entriesPerShard);
+                Entry& entry = entryAt(lock.shard, index);
+                if (!entry.used)
+                    continue;
+                Value value{};
+                if (Codec::load(valueAt(lock.shard, index), entry.valueSize, value))
+                    entries.emplace_back(entry.key, std::move(value));
+            }
+        }
+    }
+
+    // 内存统计：整块共享区域在创建时一次分配，由所有映射它的进程共享。
+    // 桶数组为索引，条目中的key和value区中已使用的字节为有效数据，其余(含未使用的value空间)为管理开销
+    KMemoryUsage memoryUsage() override
+    {
+        KMemoryUsage usage;
+        for (size_t i = 0; i < layout_.shardCount; ++i)
+        {
+            ShardLock lock(*this, i);
+            usage.entries += lock.header->count;
+            for (size_t index = 0; index < layout_.entriesPerShard; ++index)
+            {
+                const Entry& entry = entryAt(lock.shard, static_cast<uint32_t>(index));
+                if (entry.used)
+                    usage.payloadBytes += sizeof(Key) + entry.valueSize;
+            }
+        }
+        usage.indexBytes = layout_.shardCount * layout_.bucketsPerShard * sizeof(uint32_t);
+        usage.metadataBytes = mapSize_ - usage.indexBytes - usage.payloadBytes;
+        return usage;
+    }
+
+    KShmCacheStats stats()
+    {
+        KShmCacheStats stats;
+        for (size_t i = 0; i < layout_.shardCount; ++i)
+        {
+            ShardLock lock(*this, i);
+            stats.entries += lock.header->count;
+            stats.hits += lock.header->hits;
+            stats.misses += lock.header->misses;
+            stats.evictions += lock.header->evictions;
+            stats.rejected += lock.header->rejected;
+            stats.recoveries += lock.header->recoveries;
+        }
+        return stats;
+    }
+
+    // 共享区域的总字节数
+    size_t regionBytes() const { return mapSize_; }
+
+private:
+    // 布局参数，创建者写入，映射者比对
+    struct Layout
+    {
+        uint64_t keySize;
+        uint64_t valueBytes;
+        uint64_t shardCount;
+        uint64_t entriesPerShard;
+        uint64_t bucketsPerShard;
+        uint64_t shardBytes;
+    };
+
+    struct Header
+    {
+        std::atomic<uint64_t> magic;
+        Layout                layout;
+    };
+
+    // 分片头，之后依次是桶数组、条目数组和value区
+    struct ShardHeader
+    {
+        pthread_mutex_t mutex;          // 进程间共享的健壮锁
+        uint32_t        clockHand;      // CLOCK时钟指针
+        uint32_t        freeHead;       // 空闲条目链表
+        uint32_t        count;
+        uint64_t        versionCounter;
+        uint64_t        hits;
+        uint64_t        misses;
+        uint64_t        evictions;
+        uint64_t        rejected;
+        uint64_t        recoveries;
+    };
+
+    // 条目之间、桶到条目都用下标链接，kNone表示空
+    struct Entry
+    {
+        uint64_t hash;
+        uint64_t version;
+        uint32_t next;          // 桶链表或空闲链表中的下一个
+        uint32_t valueSize;
+        uint8_t  used;
+        uint8_t  referenced;    // CLOCK引用位
+        Key      key;
+    };
+
+    // 加锁并处理持锁进程崩溃的情况
+    struct ShardLock
+    {
+        char*        shard;
+        ShardHeader* header;
+
+        ShardLock(KShmCache& cache, size_t index)
+            : shard(cache.shardAt(index))
+            , header(reinterpret_cast<ShardHeader*>(shard))
+        {
+            int rc = ::pthread_mutex_lock(&header->mutex);
+            if (rc == EOWNERDEAD)
+            {
+                cache.resetShard(shard);
+                ++header->recoveries;
+                ::pthread_mutex_consistent(&header->mutex);
+            }
+            else if (rc != 0)
+            {
+                throw std::system_error(rc, std::generic_category(), "共享缓存加锁失败");
+            }
+        }
+
+        ~ShardLock()
+        {
+            ::pthread_mutex_unlock(&header->mutex);
+        }
+
+        ShardLock(const ShardLock&) = delete;
+        ShardLock& operator=(const ShardLock&) = delete;
+    };
+
+    static constexpr uint64_t kMagic = 0x4b53484d43414331ULL;     // "KSHMCAC1"
+    static constexpr uint32_t kNone = UINT32_MAX;
+
+    static size_t alignUp(size_t size)
+    {
+        return (size + 63) & ~static_cast<size_t>(63);
+    }
+
+    // 等待创建者设置好共享内存的大小，返回该大小
+    static size_t fileSize(int fd)
+    {
+        struct stat st;
+        return ::fstat(fd, &st) == 0 ? static_cast<size_t>(st.st_size) : 0;
+    }
+
+    char* shardAt(size_t index) const
+    {
+        return base_ + alignUp(sizeof(Header)) + index * layout_.shardBytes;
+    }
+
+    size_t shardOf(const KHashedKey<Key>& key) const
+    {
+        return key.shardOf(layout_.shardCount);
+    }
+
+    uint32_t& bucketAt(char* shard, uint64_t hash) const
+    {
+        return reinterpret_cast<uint32_t*>(shard + bucketsOffset_)[hash & (layout_.bucketsPerShard - 1)];
+    }
+
+    Entry& entryAt(char* shard, uint32_t index) const
+    {
+        return reinterpret_cast<Entry*>(shard + entriesOffset_)[index];
+    }
+
+    char* valueAt(char* shard, uint32_t index) const
+    {
+        return shard + arenaOffset_ + static_cast<size_t>(index) * layout_.valueBytes;
+    }
+
+    void initShard(size_t index)
+    {
+        char* shard = shardAt(index);
+        ShardHeader* header = reinterpret_cast<ShardHeader*>(shard);
+        pthread_mutexattr_t attr;
+        ::pthread_mutexattr_init(&attr);
+        ::pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+        ::pthread_mutexattr_setrobust(&attr, PTHREAD_MUTEX_ROBUST);
+        ::pthread_mutex_init(&header->mutex, &attr);
+        ::pthread_mutexattr_destroy(&attr);
+        resetShard(shard);
+    }
+
+    // 清空分片：所有条目串成空闲链表，桶全部置空(持锁调用；也用于崩溃后的重建，不依赖原有内容)
+    void resetShard(char* shard)
+    {
+        ShardHeader* header = reinterpret_cast<ShardHeader*>(shard);
+        uint32_t* buckets = reinterpret_cast<uint32_t*>(shard + bucketsOffset_);
+        for (size_t i = 0; i < layout_.bucketsPerShard; ++i)
+            buckets[i] = kNone;
+        for (size_t i = 0; i < layout_.entriesPerShard; ++i)
+        {
+            Entry& entry = entryAt(shard, static_cast<uint32_t>(i));
+            entry.used = 0;
+            entry.referenced = 0;
+            entry.next = i + 1 < layout_.entriesPerShard ? static_cast<uint32_t>(i + 1) : kNone;
+        }
+        header->freeHead = 0;
+        header->clockHand = 0;
+        header->count = 0;
+    }
+
+    uint32_t find(char* shard, const KHashedKey<Key>& key) const
+    {
+        for (uint32_t index = bucketAt(shard, key.hash); index != kNone; index = entryAt(shard, index).next)
+        {
+            const Entry& entry = entryAt(shard, index);
+            if (entry.hash == key.hash && std::memcmp(&entry.key, &key.key, sizeof(Key)) == 0)
+                return index;
+        }
+        return kNone;
+    }
+
+    // 从桶链表中摘除
+    void unlinkEntry(char* shard, uint32_t index)
+    {
+        Entry& entry = entryAt(shard, index);
+        uint32_t* link = &bucketAt(shard, entry.hash);
+        while (*link != index)
+            link = &entryAt(shard, *link).next;
+        *link = entry.next;
+        entry.used = 0;
+        --reinterpret_cast<ShardHeader*>(shard)->count;
+    }
+
+    // 放回空闲链表
+    void release(char* shard, uint32_t index)
+    {
+        ShardHeader* header = reinterpret_cast<ShardHeader*>(shard);
+        entryAt(shard, index).next = header->freeHead;
+        header->freeHead = index;
+    }
+
+    // 只通知本进程的监听：其他进程写入时发生的淘汰由那个进程通知
+    void notifyEntryEvicted(char* shard, uint32_t index)
+    {
+        if (!this->hasEvictionListener())
+            return;
+        const Entry& entry = entryAt(shard, index);
+        Value value{};
+        if (Codec::load(valueAt(shard, index), entry.valueSize, value))
+            this->notifyEvicted(entry.key, value);
+    }
+
+    // 取一个空闲条目，没有时用CLOCK淘汰
+    uint32_t allocate(char* shard)
+    {
+        ShardHeader* header = reinterpret_cast<ShardHeader*>(shard);
+        if (header->freeHead != kNone)
+        {
+            uint32_t index = header->freeHead;
+            header->freeHead = entryAt(shard, index).next;
+            return index;
+        }
+        while (true)
+        {
+            uint32_t index = header->clockHand;
+            header->clockHand = static_cast<uint32_t>((index + 1) % layout_.entriesPerShard);
+            Entry& entry = entryAt(shard, index);
+            if (entry.referenced)
+            {
+                entry.referenced = 0;
+                continue;
+            }
+            notifyEntryEvicted(shard, index);
+            unlinkEntry(shard, index);
+            ++header->evictions;
+            return index;
+        }
+    }
+
+    void storeValue(char* shard, uint32_t index, const Value& value)
+    {
+        Entry& entry = entryAt(shard, index);
+        entry.valueSize = static_cast<uint32_t>(Codec::size(value));
+        Codec::store(valueAt(shard, index), value);
+    }
+
+private:
+    Layout  layout_;
+    size_t  bucketsOffset_;     // 分片内各部分的偏移
+    size_t  entriesOffset_;
+    size_t  arenaOffset_;
+    size_t  mapSize_;
+    char*   base_;              // 本进程中的映射地址
+};
+
+} // namespace MyCache
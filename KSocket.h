@@ -0,0 +1,246 @@
+#pragma once
+
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <system_error>
+#include <thread>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace MyCache
+{
+
+// 阻塞式流套接字的小工具和每连接一个线程的会话表，供复制(KReplication.h)和缓存服务(KCacheServer.h)使用
+// 地址格式为"tcp://host:port"(IPv4)或Unix域套接字的路径
+// 使用POSIX套接字接口
+class KSocket
+{
+public:
+    // 监听地址，失败抛出std::system_error
+    static int listen(const std::string& address)
+    {
+        int fd = open(address);
+        bool ok = false;
+        if (isTcp(address))
+        {
+            int yes = 1;
+            ::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+            sockaddr_in addr = tcpAddress(address);
+            ok = ::bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0;
+        }
+        else
+        {
+            ::unlink(address.c_str());
+            sockaddr_un addr = unixAddress(address);
+            ok = ::bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0;
+        }
+        if (!ok || ::listen(fd, 16) != 0)
+        {
+            int error = errno;
+            ::close(fd);
+            throw std::system_error(error, std::generic_category(), "监听地址失败: " + address);
+        }
+        return fd;
+    }
+
+    // 连接地址，失败返回-1
+    static int connect(const std::string& address)
+    {
+        int fd = open(address);
+        int result;
+        if (isTcp(address))
+        {
+            sockaddr_in addr = tcpAddress(address);
+            result = ::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+            int yes = 1;
+            ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &yes, sizeof(yes));
+        }
+        else
+        {
+            sockaddr_un addr = unixAddress(address);
+            result = ::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+        }
+        if (result != 0)
+        {
+            ::close(fd);
+            return -1;
+        }
+        return fd;
+    }
+
+    // 删除监听留下的Unix域套接字文件(TCP地址不需要)
+    static void unlinkAddress(const std::string& address)
+    {
+        if (!isTcp(address))
+            ::unlink(address.c_str());
+    }
+
+    // 设置读写超时，超时后readAll/writeAll返回false
+    static void setTimeout(int fd, std::chrono::milliseconds timeout)
+    {
+        timeval tv{};
+        tv.tv_sec = static_cast<time_t>(timeout.count() / 1000);
+        tv.tv_usec = static_cast<suseconds_t>(timeout.count() % 1000 * 1000);
+        ::setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+        ::setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+    }
+
+    static bool writeAll(int fd, const char* data, size_t size)
+    {
+        while (size > 0)
+        {
+            ssize_t n = ::send(fd, data, size, MSG_NOSIGNAL);
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n <= 0)
+                return false;
+            data += n;
+            size -= static_cast<size_t>(n);
+        }
+        return true;
+    }
+
+    static bool readAll(int fd, char* data, size_t size)
+    {
+        while (size > 0)
+        {
+            ssize_t n = ::recv(fd, data, size, 0);
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n <= 0)
+                return false;
+            data += n;
+            size -= static_cast<size_t>(n);
+        }
+        return true;
+    }
+
+    static bool isTcp(const std::string& address)
+    {
+        return address.compare(0, 6, "tcp://") == 0;
+    }
+
+private:
+    static int open(const std::string& address)
+    {
+        int fd = ::socket(isTcp(address) ? AF_INET : AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd < 0)
+            throw std::system_error(errno, std::generic_category(), "创建套接字失败");
+        return fd;
+    }
+
+    static sockaddr_in tcpAddress(const std::string& address)
+    {
+        std::string hostPort = address.substr(6);
+        size_t colon = hostPort.rfind(':');
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(static_cast<uint16_t>(std::stoi(hostPort.substr(colon + 1))));
+        std::string host = hostPort.substr(0, colon);
+        if (host == "localhost")
+            host = "127.0.0.1";
+        ::inet_pton(AF_INET, host.c_str(), &addr.sin_addr);
+        return addr;
+    }
+
+    static sockaddr_un unixAddress(const std::string& path)
+    {
+        sockaddr_un addr{};
+        addr.sun_family = AF_UNIX;
+        std::strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+        return addr;
+    }
+};
+
+
+// 每个连接一个服务线程的会话，派生类可以附加自己的状态
+struct KSocketSession
+{
+    explicit KSocketSession(int fd) : fd(fd) {}
+
+    int         fd;
+    std::thread thread;
+    bool        active = true;     // 服务线程结束时置false，受所属会话表的锁保护
+};
+
+// 会话表：接入连接、回收已结束的会话、停止时断开并等待全部会话
+// 会话表和停止标志由调用方的同一把锁保护，服务线程结束前应在这把锁内把active置false
+template<typename Session>
+class KSocketSessions
+{
+public:
+    using List = std::list<std::unique_ptr<Session>>;
+
+    // 接入循环，每个连接创建一个会话并调用start(session)启动它的服务线程
+    // stopping在锁内置位后shutdown监听fd即可让循环退出
+    template<typename Start>
+    void acceptLoop(int listenFd, std::mutex& mutex, const bool& stopping, Start start)
+    {
+        while (true)
+        {
+            int fd = ::accept4(listenFd, nullptr, nullptr, SOCK_CLOEXEC);
+            std::lock_guard<std::mutex> lock(mutex);
+            if (stopping)
+            {
+                if (fd >= 0)
+                    ::close(fd);
+                break;
+            }
+            if (fd < 0)
+                continue;
+            // 回收已结束的会话
+            for (auto it = sessions_.begin(); it != sessions_.end();)
+            {
+                if (!(*it)->active)
+                {
+                    (*it)->thread.join();
+                    ::close((*it)->fd);
+                    it = sessions_.erase(it);
+                }
+                else
+                {
+                    ++it;
+                }
+            }
+            sessions_.emplace_back(new Session(fd));
+            start(sessions_.back().get());
+        }
+    }
+
+    // 唤醒阻塞在读写上的服务线程(在锁内、置位停止标志时调用)
+    void shutdownAll()
+    {
+        for (auto& session : sessions_)
+            ::shutdown(session->fd, SHUT_RDWR);
+    }
+
+    // 等待所有服务线程结束并关闭连接(接入循环退出后调用)
+    void closeAll()
+    {
+        for (auto& session : sessions_)
+        {
+            session->thread.join();
+            ::close(session->fd);
+        }
+        sessions_.clear();
+    }
+
+    // 遍历会话(在锁内调用)
+    const List& list() const { return sessions_; }
+
+private:
+    List sessions_;
+};
+
+} // namespace MyCache
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace MyCache
+{
+
+// 1字节的自旋锁，满足Lockable要求，可直接用于std::lock_guard
+// 用于临界区只有几十条指令、且锁本身要内联在数据旁边的场景(组相联缓存的每一组、小容量缓存)
+class KSpinLock
+{
+public:
+    KSpinLock() = default;
+    KSpinLock(const KSpinLock&) = delete;
+    KSpinLock& operator=(const KSpinLock&) = delete;
+
+    void lock()
+    {
+        while (locked_.exchange(1, std::memory_order_acquire))
+        {
+            // 先只读等待，避免反复exchange抢占缓存行
+            while (locked_.load(std::memory_order_relaxed))
+                cpuRelax();
+        }
+    }
+
+    bool try_lock()
+    {
+        return !locked_.load(std::memory_order_relaxed) && !locked_.exchange(1, std::memory_order_acquire);
+    }
+
+    void unlock()
+    {
+        locked_.store(0, std::memory_order_release);
+    }
+
+    static void cpuRelax()
+    {
+#if defined(__SSE2__)
+        _mm_pause();
+#endif
+    }
+
+private:
+    std::atomic<uint8_t> locked_{0};
+};
+
+} // namespace MyCache
@@ -0,0 +1,131 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <string_view>
+
+#include "KCompactLruCache.h"
+#include "KHashedKey.h"
+
+namespace MyCache
+{
+
+// 字符串key的存放方式：每个分片一块连续的arena保存所有key的字节，节点只记录偏移和长度
+// 删除/淘汰留下的空洞超过有效字节数时，在下一次插入前按LRU顺序整体压缩，均摊到每次删除是O(1)
+struct KArenaKeyStore
+{
+    using Key = std::string;
+    using KeyView = std::string_view;
+
+    struct NodeKey
+    {
+        uint64_t hash;          // 完整的64位哈希值
+        uint32_t offset;        // key在arena中的位置
+        uint32_t length;
+    };
+
+    struct ShardKeys
+    {
+        void reset()
+        {
+            arena.clear();
+            garbage = 0;
+        }
+
+        std::string arena;      // 所有key的字节
+        size_t      garbage = 0;    // arena中已删除key占用的字节数
+    };
+
+    static constexpr size_t kInlineKeyBytes = 0;
+
+    // 与KHashedKey<std::string>相同的哈希(std::hash<std::string_view>与std::hash<std::string>结果一致)
+    static uint64_t hashOf(std::string_view key)
+    {
+        return mixHash(static_cast<uint64_t>(std::hash<std::string_view>()(key)));
+    }
+
+    static uint64_t hashOf(const ShardKeys&, const NodeKey& nodeKey) { return nodeKey.hash; }
+
+    // 先比较64位哈希和长度，全部相同才访问arena比较字节
+    static bool equals(const ShardKeys& keys, const NodeKey& nodeKey, std::string_view key, uint64_t hash)
+    {
+        return nodeKey.hash == hash && nodeKey.length == key.size()
+            && std::memcmp(keys.arena.data() + nodeKey.offset, key.data(), key.size()) == 0;
+    }
+
+    static void assign(ShardKeys& keys, NodeKey& nodeKey, std::string_view key, uint64_t hash)
+    {
+        nodeKey.hash = hash;
+        nodeKey.offset = static_cast<uint32_t>(keys.arena.size());
+        nodeKey.length = static_cast<uint32_t>(key.size());
+        keys.arena.append(key.data(), key.size());
+    }
+
+    static void release(ShardKeys& keys, const NodeKey& nodeKey) { keys.garbage += nodeKey.length; }
+
+    static std::string keyOf(const ShardKeys& keys, const NodeKey& nodeKey)
+    {
+        return std::string(keys.arena.data() + nodeKey.offset, nodeKey.length);
+    }
+
+    static size_t liveKeyBytes(const ShardKeys& keys) { return keys.arena.size() - keys.garbage; }
+    static size_t keyCapacityBytes(const ShardKeys& keys) { return keys.arena.capacity(); }
+
+    // 把有效key复制到新的arena
+    template<typename ForEachNodeKey>
+    static void compactIfNeeded(ShardKeys& keys, ForEachNodeKey forEachNodeKey)
+    {
+        if (keys.garbage <= keys.arena.size() - keys.garbage)
+            return;
+        std::string arena;
+        arena.reserve(keys.arena.size() - keys.garbage);
+        forEachNodeKey([&](NodeKey& nodeKey) {
+            uint32_t offset = static_cast<uint32_t>(arena.size());
+            arena.append(keys.arena.data() + nodeKey.offset, nodeKey.length);
+            nodeKey.offset = offset;
+        });
+        keys.arena.swap(arena);
+        keys.garbage = 0;
+    }
+};
+
+// 字符串key的分片LRU缓存：key的字节只存一份
+// KLruCache<std::string, V>中节点和哈希表各有一个key副本，超过15字节(SSO容量)的key各自在堆上分配；这里：
+// - key的字节存放在每个分片的arena中(KArenaKeyStore)，节点连续存放在数组中，用下标组成LRU链表和空闲链表
+// - 开放寻址索引的槽内带32位哈希指纹，指纹相同再比较节点中的64位哈希和长度，全部相同才访问arena比较字节
+// - 查找、写入和删除都可以直接传入std::string_view，不构造std::string
+// 不支持标签和命名空间失效；容量固定，节点数组和索引在构造时按容量分配，之后不会扩容
+template<typename Value>
+class KStringLruCache : public KCompactLruCache<KArenaKeyStore, Value>
+{
+    using Base = KCompactLruCache<KArenaKeyStore, Value>;
+
+public:
+    using ComputeFunc = typename Base::ComputeFunc;
+    using Base::put;
+    using Base::get;
+    using Base::compute;
+
+    KStringLruCache(size_t capacity, int shardNum = 0)
+        : Base(capacity, shardNum, "KStringLruCache")
+    {}
+
+    void put(std::string_view key, const Value& value)
+    {
+        this->putView(key, value);
+    }
+
+    bool get(std::string_view key, Value& value)
+    {
+        return this->getView(key, value);
+    }
+
+    uint64_t compute(std::string_view key, const ComputeFunc& func)
+    {
+        return this->computeView(key, func);
+    }
+};
+
+} // namespace MyCache
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "KMemoryUsage.h"
+
+namespace MyCache
+{
+
+// 标签二级索引：tag -> 带有该标签的key集合，以及 key -> 该key的标签
+// 由缓存在自己的锁内维护(本类不加锁)，节点被淘汰或删除时同步移除，
+// 因此索引大小始终与缓存中带标签的节点数一致
+template<typename Key, typename Tag = std::string>
+class KTagIndex
+{
+public:
+    bool empty() const { return keyToTags_.empty(); }
+
+    // 设置key的标签(覆盖原有标签)，tags为空则相当于移除
+    void set(const Key& key, const std::vector<Tag>& tags)
+    {
+        erase(key);
+        if (tags.empty())
+            return;
+        auto& keyTags = keyToTags_[key];
+        keyTags.reserve(tags.size());
+        for (const auto& tag : tags)
+        {
+            if (tagToKeys_[tag].insert(key).second)
+                keyTags.push_back(tag);
+        }
+    }
+
+    // 节点离开缓存时调用
+    void erase(const Key& key)
+    {
+        if (keyToTags_.empty())
+            return;     // 未使用标签时不产生额外开销
+        auto it = keyToTags_.find(key);
+        if (it == keyToTags_.end())
+            return;
+        for (const auto& tag : it->second)
+        {
+            auto tagIt = tagToKeys_.find(tag);
+            if (tagIt == tagToKeys_.end())
+                continue;
+            tagIt->second.erase(key);
+            if (tagIt->second.empty())
+                tagToKeys_.erase(tagIt);
+        }
+        keyToTags_.erase(it);
+    }
+
+    // 取出最多maxCount个带有tag的key(不从索引中删除，由调用方删除节点时一并移除)
+    void collect(const Tag& tag, size_t maxCount, std::vector<Key>& keys) const
+    {
+        keys.clear();
+        auto it = tagToKeys_.find(tag);
+        if (it == tagToKeys_.end())
+            return;
+        for (const auto& key : it->second)
+        {
+            if (keys.size() >= maxCount)
+                break;
+            keys.push_back(key);
+        }
+    }
+
+    // 带有tag的key数量
+    size_t count(const Tag& tag) const
+    {
+        auto it = tagToKeys_.find(tag);
+        return it == tagToKeys_.end() ? 0 : it->second.size();
+    }
+
+    // 索引占用的字节数(估算)
+    size_t memoryBytes() const
+    {
+        size_t bytes = hashMapBytes(tagToKeys_) + hashMapBytes(keyToTags_);
+        for (const auto& pair : tagToKeys_)
+            bytes += hashMapBytes(pair.second);
+        for (const auto& pair : keyToTags_)
+            bytes += pair.second.capacity() * sizeof(Tag);
+        return bytes;
+    }
+
+private:
+    std::unordered_map<Tag, std::unordered_set<Key>> tagToKeys_;  // 标签 -> key集合
+    std::unordered_map<Key, std::vector<Tag>> keyToTags_;         // key -> 标签列表
+};
+
+} // namespace MyCache
@@ -0,0 +1,242 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "KICachePolicy.h"
+
+namespace MyCache
+{
+
+// 两级缓存：任意两个KICachePolicy组合成一个缓存，如小而快的KLruCache在前、大的KHashLfuCache在后
+// - L1未命中时查L2，L2命中则提升到L1
+// - L1因容量淘汰的条目降级写入L2(通过L1的淘汰监听，在L1锁内写L2，锁顺序总是L1→L2)
+// - L2淘汰的条目离开整个缓存，转发给本缓存的淘汰监听，因此可以继续嵌套成更多级
+// 构造时会占用L1、L2的淘汰监听，之后不应再单独设置；L1、L2不能是同一个对象
+enum class KTierMode
+{
+    // 包含：写入同时写L1和L2，L2命中时复制到L1；L2可能先于L1淘汰某个条目，L1淘汰它时再补回L2
+    Inclusive,
+    // 互斥：一个key只在一级中，写入只写L1并删除L2中的旧值，L2命中时移到L1，两级容量之和都可用
+    Exclusive,
+};
+
+struct KTieredCacheStats
+{
+    uint64_t l1Hits = 0;
+    uint64_t l2Hits = 0;
+    uint64_t misses = 0;
+    uint64_t promotions = 0;    // L2命中后写入L1的次数
+    uint64_t demotions = 0;     // L1淘汰后写入L2的次数
+
+    double hitRate() const
+    {
+        uint64_t total = l1Hits + l2Hits + misses;
+        return total ? static_cast<double>(l1Hits + l2Hits) / total : 0.0;
+    }
+};
+
+
+template<typename Key, typename Value>
+class KTieredCache : public KICachePolicy<Key, Value>
+{
+public:
+    KTieredCache(KICachePolicy<Key, Value>& l1, KICachePolicy<Key, Value>& l2, KTierMode mode = KTierMode::Exclusive)
+        : l1_(l1)
+        , l2_(l2)
+        , mode_(mode)
+        , l1Hits_(0)
+        , l2Hits_(0)
+        , misses_(0)
+        , promotions_(0)
+        , demotions_(0)
+    {
+        l1_.setEvictionListener([this](const Key& key, const Value& value) {
+            l2_.put(key, value);
+            demotions_.fetch_add(1, std::memory_order_relaxed);
+        });
+        l2_.setEvictionListener([this](const Key& key, const Value& value) {
+            this->notifyEvicted(key, value);
+        });
+    }
+
+    ~KTieredCache() override
+    {
+        l1_.setEvictionListener(nullptr);
+        l2_.setEvictionListener(nullptr);
+    }
+
+    KTieredCache(const KTieredCache&) = delete;
+    KTieredCache& operator=(const KTieredCache&) = delete;
+
+    void put(Key key, Value value) override
+    {
+        if (mode_ == KTierMode::Exclusive)
+        {
+            // 先删L2再写L1：中间的读最多未命中，不会读到旧值
+            removeFrom(l2_, key);
+            l1_.put(key, value);
+        }
+        else
+        {
+            l1_.put(key, value);
+            l2_.put(key, value);
+        }
+    }
+
+    bool get(Key key, Value& value) override
+    {
+        if (l1_.get(key, value))
+        {
+            l1Hits_.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+        if (promote(key, value))
+        {
+            l2Hits_.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+        misses_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    Value get(Key key) override
+    {
+        Value value{};
+        get(key, value);
+        return value;
+    }
+
+    // 先把L2中的条目提升到L1，再在L1的锁内执行func；原子性由L1保证
+    // 包含模式下func的写入/删除在L1完成后同步到L2
+    uint64_t compute(const Key& key, const typename KICachePolicy<Key, Value>::ComputeFunc& func) override
+    {
+        Value promoted{};
+        promote(key, promoted);
+
+        KComputeAction action = KComputeAction::Keep;
+        Value result{};
+        uint64_t version = l1_.compute(key, [&](bool present, Value& value, uint64_t version) {
+            action = func(present, value, version);
+            if (action == KComputeAction::Store)
+                result = value;
+            return action;
+        });
+
+        if (mode_ == KTierMode::Inclusive)
+        {
+            if (action == KComputeAction::Store)
+                l2_.put(key, result);
+            else if (action == KComputeAction::Remove)
+                removeFrom(l2_, key);
+        }
+        return version;
+    }
+
+    void clear() override
+    {
+        l1_.clear();
+        l2_.clear();
+    }
+
+    // 先L2后L1(从冷到热)；包含模式下两级都有的key会出现两次，bulkLoad时以靠后的L1为准
+    void snapshot(std::vector<std::pair<Key, Value>>& entries) override
+    {
+        l2_.snapshot(entries);
+        l1_.snapshot(entries);
+    }
+
+    // 写入L1，装不下的部分由淘汰监听降级到L2
+    size_t bulkLoad(const std::vector<std::pair<Key, Value>>& entries) override
+    {
+        if (mode_ == KTierMode::Exclusive)
+        {
+            for (const auto& entry : entries)
+                removeFrom(l2_, entry.first);
+        }
+        else
+        {
+            l2_.bulkLoad(entries);
+        }
+        return l1_.bulkLoad(entries);
+    }
+
+    // 两级之和
+    KMemoryUsage memoryUsage() override
+    {
+        KMemoryUsage usage = l1_.memoryUsage();
+        usage += l2_.memoryUsage();
+        return usage;
+    }
+
+    KTieredCacheStats stats() const
+    {
+        KTieredCacheStats stats;
+        stats.l1Hits = l1Hits_.load(std::memory_order_relaxed);
+        stats.l2Hits = l2Hits_.load(std::memory_order_relaxed);
+        stats.misses = misses_.load(std::memory_order_relaxed);
+        stats.promotions = promotions_.load(std::memory_order_relaxed);
+        stats.demotions = demotions_.load(std::memory_order_relaxed);
+        return stats;
+    }
+
+    KTierMode mode() const { return mode_; }
+
+private:
+    // 从L2取出key写入L1(互斥模式下同时从L2删除)，value返回最终L1中的值
+    // L1中已有该key(并发写入了新值)时保留L1的值，避免提升的旧值覆盖新值
+    bool promote(const Key& key, Value& value)
+    {
+        bool found = false;
+        if (mode_ == KTierMode::Exclusive)
+        {
+            l2_.compute(key, [&](bool present, Value& current, uint64_t) {
+                if (!present)
+                    return KComputeAction::Keep;
+                value = current;
+                found = true;
+                return KComputeAction::Remove;
+            });
+        }
+        else
+        {
+            found = l2_.get(key, value);
+        }
+        if (!found)
+            return false;
+
+        l1_.compute(key, [&](bool present, Value& current, uint64_t) {
+            if (present)
+            {
+                value = current;
+                return KComputeAction::Keep;
+            }
+            current = value;
+            return KComputeAction::Store;
+        });
+        promotions_.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    static void removeFrom(KICachePolicy<Key, Value>& cache, const Key& key)
+    {
+        cache.compute(key, [](bool present, Value&, uint64_t) {
+            return present ? KComputeAction::Remove : KComputeAction::Keep;
+        });
+    }
+
+private:
+    KICachePolicy<Key, Value>&  l1_;
+    KICachePolicy<Key, Value>&  l2_;
+    const KTierMode             mode_;
+
+    std::atomic<uint64_t>       l1Hits_;
+    std::atomic<uint64_t>       l2Hits_;
+    std::atomic<uint64_t>       misses_;
+    std::atomic<uint64_t>       promotions_;
+    std::atomic<uint64_t>       demotions_;
+};
+
+} // namespace MyCache
@@ -0,0 +1,304 @@
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <type_traits>
+#include <utility>
+
+#include "KHashedKey.h"
+#include "KICachePolicy.h"
+#include "KLruCache.h"
+#include "KSpinLock.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace MyCache
+{
+
+// 小容量LRU缓存(容量为编译期常量，适合每个连接/对象内嵌一个8~64项的缓存)
+// - key、value、版本号都是对象内的定长数组，整个缓存没有堆分配
+// - 有效条目始终紧凑地放在前count_个位置，删除时用最后一个条目填补空位
+// - 查找用SIMD线性比较：4字节整数key直接比较key数组，其他key比较1字节哈希tag后再比对key
+// - 每个条目的"年龄"存在并行的字节数组中(0为最近访问)，访问时比它年轻的条目年龄+1，
+//   淘汰年龄最大的条目，等价于精确LRU
+template<typename Key, typename Value, size_t Capacity>
+class KTinyCache : public KICachePolicy<Key, Value>
+{
+    static_assert(Capacity > 0 && Capacity <= 255, "KTinyCache的年龄用一个字节表示，容量不能超过255");
+
+public:
+    KTinyCache() : count_(0), versionCounter_(0) {}
+
+    ~KTinyCache() override = default;
+
+    void put(Key key, Value value) override
+    {
+        compute(key, [&](bool, Value& current, uint64_t) {
+            current = value;
+            return KComputeAction::Store;
+        });
+    }
+
+    bool get(Key key, Value& value) override
+    {
+        uint8_t tag = tagFor(key);
+        std::lock_guard<KSpinLock> lock(lock_);
+        int index = find(key, tag);
+        if (index < 0)
+            return false;
+        touch(index);
+        value = values_[index];
+        return true;
+    }
+
+    Value get(Key key) override
+    {
+        Value value{};
+        get(key, value);
+        return value;
+    }
+
+    uint64_t compute(const Key& key, const typename KICachePolicy<Key, Value>::ComputeFunc& func) override
+    {
+        uint8_t tag = tagFor(key);
+        std::lock_guard<KSpinLock> lock(lock_);
+        int index = find(key, tag);
+        if (index >= 0)
+        {
+            Value value = values_[index];
+            switch (func(true, value, versions_[index]))
+            {
+            case KComputeAction::Keep:
+                touch(index);
+                return versions_[index];
+            case KComputeAction::Store:
+                values_[index] = value;
+                versions_[index] = ++versionCounter_;
+                touch(index);
+                return versions_[index];
+            case KComputeAction::Remove:
+                remove(index);
+                return 0;
+            }
+            return 0;
+        }
+
+        Value value{};
+        if (func(false, value, 0) != KComputeAction::Store)
+            return 0;
+
+        if (count_ < Capacity)
+        {
+            index = static_cast<int>(count_);
+            ages_[count_] = static_cast<uint8_t>(count_);  // 先作为最老的条目加入，再touch成最新
+            ++count_;
+        }
+        else
+        {
+            index = oldest();
+            this->notifyEvicted(keys_[index], values_[index]);
+        }
+        keys_[index] = key;
+        tags_[index] = tag;
+        values_[index] = value;
+        versions_[index] = ++versionCounter_;
+        touch(index);
+        return versions_[index];
+    }
+
+    void clear() override
+    {
+        std::lock_guard<KSpinLock> lock(lock_);
+        for (size_t i = 0; i < count_; ++i)
+            values_[i] = Value();   // 释放value持有的资源
+        count_ = 0;
+    }
+
+    size_t size()
+    {
+        std::lock_guard<KSpinLock> lock(lock_);
+        return count_;
+    }
+
+    static constexpr size_t capacity() { return Capacity; }
+
+    // 快照：从最老到最新
+    void snapshot(std::vector<std::pair<Key, Value>>& entries) override
+    {
+        std::lock_guard<KSpinLock> lock(lock_);
+        for (size_t age = count_; age-- > 0;)
+        {
+            for (size_t i = 0; i < count_; ++i)
+            {
+                if (ages_[i] == age)
+                    entries.emplace_back(keys_[i], values_[i]);
+            }
+        }
+    }
+
+    // 内存统计：整个缓存就是对象本身。tag数组为索引，key/value数组为有效数据，其余为管理开销
+    KMemoryUsage memoryUsage() override
+    {
+        std::lock_guard<KSpinLock> lock(lock_);
+        KMemoryUsage usage;
+        usage.entries = count_;
+        usage.indexBytes = sizeof(tags_);
+        usage.payloadBytes = sizeof(keys_) + sizeof(values_);
+        usage.metadataBytes = sizeof(*this) - usage.indexBytes - usage.payloadBytes;
+        for (size_t i = 0; i < count_; ++i)
+            usage.payloadBytes += heapBytesOf(keys_[i]) + heapBytesOf(values_[i]);
+        return usage;
+    }
+
+private:
+    // 4字节整数key可以直接用SIMD比较，不需要tag
+    static constexpr bool kDirectKeys = std::is_integral<Key>::value && sizeof(Key) == 4;
+
+    static uint8_t tagFor(const Key& key)
+    {
+        if constexpr (kDirectKeys)
+            return 0;
+        else
+            return static_cast<uint8_t>(mixHash(static_cast<uint64_t>(std::hash<Key>()(key))) >> 56);
+    }
+
+    // 返回key所在的位置，不存在返回-1
+    int find(const Key& key, uint8_t tag) const
+    {
+        if constexpr (kDirectKeys)
+        {
+#if defined(__SSE2__)
+            __m128i needle = _mm_set1_epi32(static_cast<int>(key));
+            for (size_t base = 0; base < count_; base += 4)
+            {
+                __m128i group = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&keys_[base]));
+                uint32_t mask = static_cast<uint32_t>(_mm_movemask_ps(
+                    _mm_castsi128_ps(_mm_cmpeq_epi32(group, needle))));
+                mask &= validMask(base, 4);
+                if (mask)
+                    return static_cast<int>(base + __builtin_ctz(mask));
+            }
+            return -1;
+#else
+            for (size_t i = 0; i < count_; ++i)
+            {
+                if (keys_[i] == key)
+                    return static_cast<int>(i);
+            }
+            return -1;
+#endif
+        }
+        else
+        {
+#if defined(__SSE2__)
+            __m128i needle = _mm_set1_epi8(static_cast<char>(tag));
+            for (size_t base = 0; base < count_; base += 16)
+            {
+                __m128i group = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&tags_[base]));
+                uint32_t mask = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(group, needle)));
+                mask &= validMask(base, 16);
+                while (mask)
+                {
+                    size_t i = base + __builtin_ctz(mask);
+                    if (keys_[i] == key)
+                        return static_cast<int>(i);
+                    mask &= mask - 1;
+                }
+            }
+            return -1;
+#else
+            for (size_t i = 0; i < count_; ++i)
+            {
+                if (tags_[i] == tag && keys_[i] == key)
+                    return static_cast<int>(i);
+            }
+            return -1;
+#endif
+        }
+    }
+
+    // 从base开始的width个位置中，属于有效条目的位掩码
+    uint32_t validMask(size_t base, size_t width) const
+    {
+        size_t valid = count_ - base;
+        return valid >= width ? (1u << width) - 1 : (1u << valid) - 1;
+    }
+
+    // 设为最近访问：比它年轻的条目都老一岁
+    void touch(int index)
+    {
+        uint8_t age = ages_[index];
+        for (size_t i = 0; i < count_; ++i)
+        {
+            if (ages_[i] < age)
+                ++ages_[i];
+        }
+        ages_[index] = 0;
+    }
+
+    int oldest() const
+    {
+        for (size_t i = 0; i < count_; ++i)
+        {
+            if (ages_[i] == count_ - 1)
+                return static_cast<int>(i);
+        }
+        return 0;
+    }
+
+    // 删除条目：比它老的条目年龄-1，最后一个条目挪到空位
+    void remove(int index)
+    {
+        uint8_t age = ages_[index];
+        for (size_t i = 0; i < count_; ++i)
+        {
+            if (ages_[i] > age)
+                --ages_[i];
+        }
+        size_t last = count_ - 1;
+        if (static_cast<size_t>(index) != last)
+        {
+            keys_[index] = keys_[last];
+            tags_[index] = tags_[last];
+            values_[index] = std::move(values_[last]);
+            versions_[index] = versions_[last];
+            ages_[index] = ages_[last];
+        }
+        values_[last] = Value();
+        --count_;
+    }
+
+private:
+    // SIMD每次读取16字节，数组补齐到16字节的整数倍，避免越界读
+    static constexpr size_t kPaddedKeys = kDirectKeys ? (Capacity + 3) / 4 * 4 : Capacity;
+    static constexpr size_t kPaddedTags = (Capacity + 15) / 16 * 16;
+
+    KSpinLock   lock_;
+    uint8_t     count_;                     // 有效条目数
+    uint8_t     ages_[Capacity];            // 年龄，有效条目的年龄恰好是0..count_-1的一个排列
+    uint8_t     tags_[kPaddedTags] = {};    // 哈希值高8位(4字节整数key不使用)
+    Key         keys_[kPaddedKeys] = {};
+    Value       values_[Capacity];
+    uint64_t    versions_[Capacity];
+    uint64_t    versionCounter_;
+};
+
+
+// 容量为编译期常量的LRU缓存：容量不超过kTinyCacheMaxCapacity时自动选用KTinyCache，
+// 否则使用普通的KLruCache
+constexpr size_t kTinyCacheMaxCapacity = 64;
+
+template<typename Key, typename Value, size_t Capacity>
+class KFixedCapacityLruCache : public KLruCache<Key, Value>
+{
+public:
+    KFixedCapacityLruCache() : KLruCache<Key, Value>(static_cast<int>(Capacity)) {}
+};
+
+template<typename Key, typename Value, size_t Capacity>
+using KStaticLruCache = typename std::conditional<(Capacity <= kTinyCacheMaxCapacity),
+    KTinyCache<Key, Value, Capacity>, KFixedCapacityLruCache<Key, Value, Capacity>>::type;
+
+} // namespace MyCache
@@ -0,0 +1,411 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "KGeneration.h"
+#include "KICachePolicy.h"
+#include "KLockProfiler.h"
+
+namespace MyCache
+{
+
+// LFU优化：滑动窗口LFU
+// 频次只统计最近windowSize次请求，用一个环形缓冲区记录最近的请求，
+// 请求滑出窗口时对应节点频次-1，因此频次的增加和过期都是O(1)，
+// 旧的热点数据在一个窗口内就会降到低频，比全局降频的KLfuAgingCache适应更快
+template<typename Key, typename Value>
+class KWindowLfuCache : public KICachePolicy<Key, Value>
+{
+private:
+    // 缓存节点
+    struct Node
+    {
+        Key key;
+        Value value;
+        size_t freq;        // 窗口内的访问次数
+        uint64_t id;        // 节点编号，区分同一key被淘汰后重新插入的节点
+        uint32_t ns;        // 所属命名空间
+        uint64_t gen;       // 插入时的代数
+        uint64_t version;   // 版本号，每次写入value时更新(与节点编号共用计数器)
+        std::shared_ptr<Node> pre;
+        std::shared_ptr<Node> next;
+
+        Node() : freq(0), id(0), ns(0), gen(0), version(0) {}
+        Node(Key key, Value value, uint64_t id, uint32_t ns, uint64_t gen)
+            : key(key), value(value), freq(0), id(id), ns(ns), gen(gen), version(id) {}
+    };
+
+    using NodePtr = std::shared_ptr<Node>;
+    using NodeMap = std::unordered_map<Key, NodePtr>;
+
+    // 同一频次的节点链表(尾部为最近访问)
+    struct NodeList
+    {
+        NodePtr head;
+        NodePtr tail;
+
+        NodeList()
+            : head(std::make_shared<Node>())
+            , tail(std::make_shared<Node>())
+        {
+            head->next = tail;
+            tail->pre = head;
+        }
+
+        bool isEmpty() const { return head->next == tail; }
+
+        void addNode(NodePtr node)
+        {
+            node->pre = tail->pre;
+            node->next = tail;
+            tail->pre->next = node;
+            tail->pre = node;
+        }
+
+        void removeNode(NodePtr node)
+        {
+            node->pre->next = node->next;
+            node->next->pre = node->pre;
+            node->pre = nullptr;
+            node->next = nullptr;
+        }
+    };
+
+    // 窗口中的一次请求记录(id为0表示未命中的请求)
+    struct WindowEntry
+    {
+        Key key;
+        uint64_t id;
+    };
+
+public:
+    KWindowLfuCache(int capacity, size_t windowSize)
+        : capacity_(capacity)
+        , windowSize_(std::max<size_t>(windowSize, 1))
+        , windowHead_(0)
+        , windowCount_(0)
+        , minFreq_(0)
+        , nextId_(1)
+    {
+        window_.resize(windowSize_);
+        MyCache::setLockName(mutex_, "KWindowLfuCache");
+    }
+
+    ~KWindowLfuCache() override = default;
+
+    void put(Key key, Value value) override
+    {
+        if (capacity_ <= 0)
+            return;
+
+        std::lock_guard<KCacheMutex> lock(mutex_);
+        auto it = findLive(key);
+        if (it != nodeMap_.end())
+        {
+            setNodeValue(it->second, value);
+            recordAccess(it->second);
+            return;
+        }
+        addNewNode(key, value);
+    }
+
+    bool get(Key key, Value& value) override
+    {
+        std::lock_guard<KCacheMutex> lock(mutex_);
+        auto it = findLive(key);
+        if (it != nodeMap_.end())
+        {
+            recordAccess(it->second);
+            value = it->second->value;
+            return true;
+        }
+        // 未命中也占用窗口位置，保证窗口按请求数滑动
+        pushWindow(key, 0);
+        return false;
+    }
+
+    // 原子读-改-写：一次加锁、一次查找，访问和写入都计入窗口
+    uint64_t compute(const Key& key, const typename KICachePolicy<Key, Value>::ComputeFunc& func) override
+    {
+        std::lock_guard<KCacheMutex> lock(mutex_);
+        auto it = findLive(key);
+        if (it != nodeMap_.end())
+        {
+            NodePtr node = it->second;
+            Value value = node->value;
+            switch (func(true, value, node->version))
+            {
+            case KComputeAction::Keep:
+                recordAccess(node);
+                return node->version;
+            case KComputeAction::Store:
+                setNodeValue(node, value);
+                recordAccess(node);
+                return node->version;
+            case KComputeAction::Remove:
+                eraseNode(it);
+                return 0;
+            }
+            return 0;
+        }
+
+        Value value{};
+        if (func(false, value, 0) != KComputeAction::Store || capacity_ <= 0)
+        {
+            pushWindow(key, 0);
+            return 0;
+        }
+        return addNewNode(key, value)->version;
+    }
+
+    Value get(Key key) override
+    {
+        Value value{};
+        get(key, value);
+        return value;
+    }
+
+    // 节点在当前窗口内的访问次数，不在缓存中返回0
+    size_t windowFrequency(Key key)
+    {
+        std::lock_guard<KCacheMutex> lock(mutex_);
+        auto it = findLive(key);
+        return it != nodeMap_.end() ? it->second->freq : 0;
+    }
+
+    // O(1)清空缓存：现有节点立即不可见，窗口中它们的访问记录随窗口滑动自然失效
+    void clear() override
+    {
+        std::lock_guard<KCacheMutex> lock(mutex_);
+        generation_.invalidateAll(nodeMap_.size());
+    }
+
+    void setNamespaceFunc(typename KGeneration<Key>::NamespaceFunc func)
+    {
+        std::lock_guard<KCacheMutex> lock(mutex_);
+        generation_.setNamespaceFunc(std::move(func));
+    }
+
+    void invalidateNamespace(uint32_t ns)
+    {
+        std::lock_guard<KCacheMutex> lock(mutex_);
+        generation_.invalidateNamespace(ns, nodeMap_.size());
+    }
+
+    size_t sweepStale(size_t maxBuckets = 64)
+    {
+        std::lock_guard<KCacheMutex> lock(mutex_);
+        return sweepStaleLocked(maxBuckets);
+    }
+
+    // 快照：按窗口内频次从低到高，同一频次内从旧到新(与淘汰顺序一致)
+    void snapshot(std::vector<std::pair<Key, Value>>& entries) override
+    {
+        std::lock_guard<KCacheMutex> lock(mutex_);
+        entries.reserve(entries.size() + nodeMap_.size());
+        std::vector<size_t> freqs;
+        freqs.reserve(freqLists_.size());
+        for (const auto& pair : freqLists_)
+            freqs.push_back(pair.first);
+        std::sort(freqs.begin(), freqs.end());
+        for (size_t freq : freqs)
+        {
+            const NodeList& list = freqLists_.at(freq);
+            for (NodePtr node = list.head->next; node != list.tail; node = node->next)
+            {
+                if (!isStale(node))
+                    entries.emplace_back(node->key, node->value);
+            }
+        }
+    }
+
+    // 内存统计：窗口(环形缓冲区)和频次链表计为管理开销
+    KMemoryUsage memoryUsage() override
+    {
+        std::lock_guard<KCacheMutex> lock(mutex_);
+        KMemoryUsage usage;
+        usage.entries = nodeMap_.size();
+        usage.indexBytes = hashMapBytes(nodeMap_);
+        usage.payloadBytes = usage.entries * (sizeof(Key) + sizeof(Value));
+        usage.metadataBytes = nodeMemory_.bytes() - usage.payloadBytes
+            + hashMapBytes(freqLists_) + freqLists_.size() * 2 * (sizeof(Node) + kSharedControlBlockBytes)
+            + window_.capacity() * sizeof(WindowEntry);
+        for (const auto& pair : nodeMap_)
+        {
+            usage.indexBytes += heapBytesOf(pair.first);
+            usage.payloadBytes += heapBytesOf(pair.second->key) + heapBytesOf(pair.second->value);
+        }
+        for (size_t i = 0; i < windowCount_; ++i)
+            usage.metadataBytes += heapBytesOf(window_[i].key);
+        return usage;
+    }
+
+    void setLockName(const std::string& name)
+    {
+        MyCache::setLockName(mutex_, name);
+    }
+
+    void collectLockStats(std::vector<KLockStats>& out) const
+    {
+        MyCache::collectLockStats(mutex_, out);
+    }
+
+private:
+    // 插入新节点，缓存已满时先淘汰
+    NodePtr addNewNode(const Key& key, const Value& value)
+    {
+        if (nodeMap_.size() >= static_cast<size_t>(capacity_) && generation_.hasStale())
+            sweepStaleLocked(kEvictSweepBuckets);   // 优先回收过期节点
+        if (nodeMap_.size() >= static_cast<size_t>(capacity_))
+            kickOut();
+
+        NodePtr node = std::allocate_shared<Node>(KCountingAllocator<Node>(&nodeMemory_), key, value, nextId_++,
+            generation_.namespaceOf(key), generation_.current());
+        nodeMap_[key] = node;
+        freqLists_[0].addNode(node);
+        recordAccess(node);     // 频次变为1，最小频次在moveToFreq中一并更新
+        return node;
+    }
+
+    // 修改节点的value并更新版本号
+    void setNodeValue(const NodePtr& node, const Value& value)
+    {
+        node->value = value;
+        node->version = nextId_++;
+    }
+
+    // 记录一次命中：频次+1，并把这次访问放入窗口
+    void recordAccess(NodePtr node)
+    {
+        moveToFreq(node, node->freq + 1);
+        pushWindow(node->key, node->id);
+    }
+
+    // 写入窗口，窗口已满时让最老的请求过期
+    void pushWindow(const Key& key, uint64_t id)
+    {
+        if (windowCount_ == windowSize_)
+        {
+            WindowEntry& oldest = window_[windowHead_];
+            expire(oldest);
+            oldest = WindowEntry{key, id};
+        }
+        else
+        {
+            window_[windowHead_] = WindowEntry{key, id};
+            ++windowCount_;
+        }
+        windowHead_ = (windowHead_ + 1) % windowSize_;
+    }
+
+    // 请求滑出窗口：若对应节点仍在缓存中，频次-1
+    void expire(const WindowEntry& entry)
+    {
+        if (entry.id == 0)
+            return;
+        auto it = nodeMap_.find(entry.key);
+        if (it == nodeMap_.end() || it->second->id != entry.id)
+            return;     // 该节点已被淘汰(或已是重新插入的新节点)
+        NodePtr node = it->second;
+        if (node->freq > 0)
+            moveToFreq(node, node->freq - 1);
+    }
+
+    // 把节点移到新的频次链表，同时维护最小频次
+    void moveToFreq(NodePtr node, size_t newFreq)
+    {
+        size_t oldFreq = node->freq;
+        NodeList& oldList = freqLists_[oldFreq];
+        oldList.removeNode(node);
+        node->freq = newFreq;
+        freqLists_[newFreq].addNode(node);
+
+        if (newFreq < minFreq_)
+            minFreq_ = newFreq;
+        else if (oldFreq == minFreq_ && oldList.isEmpty())
+            minFreq_ = newFreq;     // 频次只会±1，旧的最小频次链表空了，新频次即为最小
+        if (oldList.isEmpty())
+            freqLists_.erase(oldFreq);
+    }
+
+    bool isStale(const NodePtr& node) const
+    {
+        return generation_.isStale(node->ns, node->gen);
+    }
+
+    typename NodeMap::iterator findLive(const Key& key)
+    {
+        auto it = nodeMap_.find(key);
+        if (it != nodeMap_.end() && isStale(it->second))
+        {
+            eraseNode(it);
+            return nodeMap_.end();
+        }
+        return it;
+    }
+
+    // 删除任意节点，需要时重新计算最小频次(频次不超过窗口大小)
+    void eraseNode(typename NodeMap::iterator it)
+    {
+        NodePtr node = it->second;
+        nodeMap_.erase(it);
+        auto listIt = freqLists_.find(node->freq);
+        listIt->second.removeNode(node);
+        if (!listIt->second.isEmpty())
+            return;
+        freqLists_.erase(listIt);
+        if (node->freq == minFreq_ && !freqLists_.empty())
+        {
+            minFreq_ = freqLists_.begin()->first;
+            for (const auto& pair : freqLists_)
+                minFreq_ = std::min(minFreq_, pair.first);
+        }
+    }
+
+    size_t sweepStaleLocked(size_t maxBuckets)
+    {
+        return generation_.sweep(nodeMap_, maxBuckets,
+            [this](const NodePtr& node) { return isStale(node); },
+            [this](const Key& key) { eraseNode(nodeMap_.find(key)); });
+    }
+
+    // 淘汰窗口内访问次数最少的节点中最久未访问的那个
+    void kickOut()
+    {
+        auto it = freqLists_.find(minFreq_);
+        if (it == freqLists_.end() || it->second.isEmpty())
+            return;
+        NodePtr node = it->second.head->next;
+        MYCACHE_TRACE_INSTANT(Evict, "KWindowLfuCache", node->freq);
+        if (!isStale(node))
+            this->notifyEvicted(node->key, node->value);
+        it->second.removeNode(node);
+        if (it->second.isEmpty())
+            freqLists_.erase(it);
+        nodeMap_.erase(node->key);
+    }
+
+private:
+    int         capacity_;      // 缓存容量
+    size_t      windowSize_;    // 窗口大小(请求数)
+    size_t      windowHead_;    // 下一个写入位置
+    size_t      windowCount_;   // 窗口中已有的请求数
+    size_t      minFreq_;       // 当前最小频次
+    uint64_t    nextId_;        // 下一个节点编号
+    KCacheMutex mutex_;
+    KMemoryCounter nodeMemory_; // 节点(含控制块)占用的字节数，需在持有节点的成员之前声明
+    NodeMap     nodeMap_;       // key -> 节点
+    std::unordered_map<size_t, NodeList> freqLists_;    // 频次 -> 节点链表
+    std::vector<WindowEntry> window_;   // 最近windowSize次请求的环形缓冲区
+    KGeneration<Key> generation_;       // 代数：O(1)清空和命名空间失效
+
+    static constexpr size_t kEvictSweepBuckets = 8;    // 驱逐前顺带回收过期节点时扫描的桶数
+};
+
+} // namespace MyCache
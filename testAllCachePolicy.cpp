@@ -5,11 +5,40 @@
 #include <iomanip>
 #include <random>
 #include <algorithm>
+#include <array>
+#include <cmath>
+#include <atomic>
+#include <thread>
+#include <cstdio>
+#include <functional>
+#include <list>
+#include <memory>
+#include <map>
 
 #include "KICachePolicy.h"
 #include "KLfuCache.h"
 #include "KLruCache.h"
 #include "KArcCache/KArcCache.h"
+#include "KWindowLfuCache.h"
+#include "KCuckooCache.h"
+#include "KSetAssocCache.h"
+#include "KTinyCache.h"
+#include "KAppendLog.h"
+#include "KReplication.h"
+#include "KCacheClient.h"
+#include "KInvalidationBus.h"
+#include "KShmCache.h"
+#include "KIntLruCache.h"
+#include "KStringKeyCache.h"
+#include "KTieredCache.h"
+#include "KMaintenance.h"
+#include "KCacheAutoTuner.h"
+
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
 
 class Timer {
 public:
@@ -24,6 +53,16 @@ private:
     std::chrono::time_point<std::chrono::high_resolution_clock> start_;
 };
 
+// 正确性检查：不满足时打印并计数，main以是否有失败的检查作为返回码
+int g_failedChecks = 0;
+
+void expect(bool ok, const std::string& what) {
+    if (!ok) {
+        ++g_failedChecks;
+        std::cout << "[检查失败] " << what << std::endl;
+    }
+}
+
 // 辅助函数：打印结果
 void printResults(const std::string& testName, int capacity, 
                  const std::vector<int>& get_operations, 
@@ -223,9 +262,1921 @@ void testWorkloadShift() {
     printResults("工作负载剧烈变化测试", CAPACITY, get_operations, hits);
 }
 
+// 按阶段统计命中率，观察各LFU策略在负载切换后的适应速度
+void testWindowLfuAdaptation() {
+    std::cout << "\n=== 测试场景4：滑动窗口LFU适应速度测试 ===" << std::endl;
+
+    const int CAPACITY = 50;
+    const int OPERATIONS = 80000;
+    const int PHASE_LENGTH = OPERATIONS / 5;
+    const int PHASES = 5;
+    const int WINDOW = 500;
+
+    MyCache::KLruCache<int, std::string> lru(CAPACITY);
+    MyCache::KLfuCache<int, std::string> lfu(CAPACITY);
+    MyCache::KLfuAgingCache<int, std::string> lfu_aging(CAPACITY, 10);
+    MyCache::KWindowLfuCache<int, std::string> lfu_window(CAPACITY, WINDOW);
+
+    std::array<MyCache::KICachePolicy<int, std::string>*, 4> caches = {&lru, &lfu, &lfu_aging, &lfu_window};
+    std::array<const char*, 4> names = {"LRU       ", "LFU       ", "LFU-Aging ", "LFU-Window"};
+
+    std::random_device rd;
+    std::mt19937 gen(rd());
+
+    for (size_t i = 0; i < caches.size(); ++i) {
+        for (int key = 0; key < 1000; ++key) {
+            caches[i]->put(key, "init" + std::to_string(key));
+        }
+
+        // 每个阶段分前1/4(刚切换)和整体两组统计
+        std::vector<int> hits(PHASES, 0), earlyHits(PHASES, 0);
+        for (int op = 0; op < OPERATIONS; ++op) {
+            int phase = op / PHASE_LENGTH;
+            int key;
+            // 与测试场景3相同的五个阶段
+            if (phase == 0) {
+                key = gen() % 5;
+            } else if (phase == 1) {
+                key = gen() % 1000;
+            } else if (phase == 2) {
+                key = (op - PHASE_LENGTH * 2) % 100;
+            } else if (phase == 3) {
+                int locality = (op / 1000) % 10;
+                key = locality * 20 + (gen() % 20);
+            } else {
+                int r = gen() % 100;
+                if (r < 30) {
+                    key = gen() % 5;
+                } else if (r < 60) {
+                    key = 5 + (gen() % 95);
+                } else {
+                    key = 100 + (gen() % 900);
+                }
+            }
+
+            std::string result;
+            if (caches[i]->get(key, result)) {
+                hits[phase]++;
+                if (op % PHASE_LENGTH < PHASE_LENGTH / 4) {
+                    earlyHits[phase]++;
+                }
+            }
+            if (gen() % 100 < 30) {
+                caches[i]->put(key, "new" + std::to_string(key));
+            }
+        }
+
+        std::cout << names[i] << " 各阶段命中率(切换后前1/4 / 整体):";
+        for (int p = 0; p < PHASES; ++p) {
+            std::cout << " " << std::fixed << std::setprecision(1)
+                      << (100.0 * earlyHits[p] / (PHASE_LENGTH / 4)) << "/"
+                      << (100.0 * hits[p] / PHASE_LENGTH) << "%";
+        }
+        std::cout << std::endl;
+    }
+}
+
+// 读多写少(95%读)时，比较无锁读的布谷鸟缓存与分片LRU随线程数增加的吞吐
+void testReadScalability() {
+    std::cout << "\n=== 测试场景5：并发读扩展性测试 ===" << std::endl;
+
+    const int CAPACITY = 100000;
+    const int KEYS = 80000;
+    const int OPS_PER_THREAD = 400000;
+
+    auto run = [&](MyCache::KICachePolicy<int, int>& cache, int threads) {
+        std::vector<std::thread> workers;
+        Timer timer;
+        for (int t = 0; t < threads; ++t) {
+            workers.emplace_back([&cache, t, KEYS, OPS_PER_THREAD]() {
+                std::mt19937 gen(t + 1);
+                int value;
+                for (int op = 0; op < OPS_PER_THREAD; ++op) {
+                    int key = gen() % KEYS;
+                    if (op % 20 == 0) {
+                        cache.put(key, op);
+                    } else {
+                        cache.get(key, value);
+                    }
+                }
+            });
+        }
+        for (auto& worker : workers) {
+            worker.join();
+        }
+        return threads * OPS_PER_THREAD / std::max(timer.elapsed(), 1.0) / 1000.0;
+    };
+
+    for (int threads : {1, 2, 4, 8}) {
+        MyCache::KCuckooCache<int, int> cuckoo(CAPACITY);
+        MyCache::KHashLruCaches<int, int> lru_hash(CAPACITY, -1);
+        for (int key = 0; key < KEYS; ++key) {
+            cuckoo.put(key, key);
+            lru_hash.put(key, key);
+        }
+        double cuckooMops = run(cuckoo, threads);
+        double lruMops = run(lru_hash, threads);
+        std::cout << threads << "线程  Cuckoo: " << std::fixed << std::setprecision(2) << cuckooMops
+                  << " Mops/s  LRU-hash: " << lruMops << " Mops/s" << std::endl;
+    }
+
+    // 正确性：value为堆上分配的字符串(走替换条目+延迟释放的路径)，写者反复覆盖、删除并触发淘汰和布谷鸟挪动，
+    // 读者每次命中都检查value与key对应
+    {
+        const int STRESS_KEYS = 8000;
+        auto valueOf = [](int key) { return "value-" + std::to_string(key) + std::string(24, 'x'); };
+        MyCache::KCuckooCache<int, std::string> cuckoo(2000);
+        std::atomic<bool> done(false);
+        std::atomic<long> hits(0);
+        std::atomic<bool> corrupted(false);
+        std::vector<std::thread> workers;
+        for (int t = 0; t < 2; ++t) {
+            workers.emplace_back([&, t] {
+                std::mt19937 gen(100 + t);
+                for (int op = 0; op < 200000; ++op) {
+                    int key = static_cast<int>(gen() % STRESS_KEYS);
+                    if (op % 10 == 0) {
+                        cuckoo.compute(key, [](bool, std::string&, uint64_t) {
+                            return MyCache::KComputeAction::Remove;
+                        });
+                    } else {
+                        cuckoo.put(key, valueOf(key));
+                    }
+                }
+            });
+        }
+        for (int t = 0; t < 2; ++t) {
+            workers.emplace_back([&, t] {
+                std::mt19937 gen(200 + t);
+                std::string value;
+                while (!done.load(std::memory_order_relaxed)) {
+                    int key = static_cast<int>(gen() % STRESS_KEYS);
+                    if (cuckoo.get(key, value)) {
+                        ++hits;
+                        if (value != valueOf(key)) {
+                            corrupted = true;
+                        }
+                    }
+                }
+            });
+        }
+        workers[0].join();
+        workers[1].join();
+        done = true;
+        workers[2].join();
+        workers[3].join();
+        expect(hits > 0, "并发读写KCuckooCache<int, string>时读者应有命中");
+        expect(!corrupted, "并发覆盖、删除、淘汰期间KCuckooCache读到的value应与key对应");
+        expect(cuckoo.memoryUsage().entries <= 2000, "并发写入后KCuckooCache不应超过容量");
+    }
+
+    // 正确性：多字的可平凡复制value走seqlock就地更新，每次写入的各字段相同，读者不应读到两次写入拼在一起的值
+    {
+        struct Wide {
+            uint64_t words[6];
+        };
+        static_assert(MyCache::kSeqlockEligible<Wide>, "Wide应使用seqlock存储");
+        auto make = [](uint64_t n) {
+            Wide wide;
+            std::fill(std::begin(wide.words), std::end(wide.words), n);
+            return wide;
+        };
+        auto consistent = [](const Wide& wide) {
+            return std::all_of(std::begin(wide.words), std::end(wide.words),
+                               [&](uint64_t word) { return word == wide.words[0]; });
+        };
+
+        MyCache::KSeqlockValue<Wide> cell(make(0));
+        MyCache::KCuckooCache<int, Wide> cuckoo(16);
+        for (int key = 0; key < 4; ++key) {
+            cuckoo.put(key, make(0));
+        }
+        std::atomic<bool> done(false);
+        std::atomic<bool> torn(false);
+        std::vector<std::thread> readers;
+        for (int t = 0; t < 2; ++t) {
+            readers.emplace_back([&, t] {
+                Wide wide;
+                for (int i = 0; !done.load(std::memory_order_relaxed); ++i) {
+                    cell.load(wide);
+                    if (!consistent(wide)) {
+                        torn = true;
+                    }
+                    if (cuckoo.get((i + t) % 4, wide) && !consistent(wide)) {
+                        torn = true;
+                    }
+                }
+            });
+        }
+        for (uint64_t n = 1; n <= 500000; ++n) {
+            cell.store(make(n));        // 单写者，相当于缓存持有写锁
+            cuckoo.put(static_cast<int>(n % 4), make(n));
+        }
+        done = true;
+        for (auto& reader : readers) {
+            reader.join();
+        }
+        Wide last;
+        cell.load(last);
+        expect(!torn, "seqlock保护的多字value不应读到两次写入混合的结果");
+        expect(consistent(last) && last.words[0] == 500000, "seqlock读者应读到最后一次写入");
+    }
+}
+
+// 组相联缓存只在组内淘汰，与全局LRU在相同容量下比较命中率
+void testSetAssocHitRate() {
+    std::cout << "\n=== 测试场景6：组相联缓存命中率测试 ===" << std::endl;
+
+    const int CAPACITY = 1024;
+    const int OPERATIONS = 500000;
+
+    std::random_device rd;
+    std::mt19937 gen(rd());
+
+    // 三种负载：70%访问热点集合、顺序扫描+随机跳跃、近似Zipf分布
+    std::array<const char*, 3> workloads = {"热点数据", "循环扫描", "Zipf    "};
+    for (size_t w = 0; w < workloads.size(); ++w) {
+        MyCache::KLruCache<int, int> lru(CAPACITY);
+        MyCache::KSetAssocCache<int, int, 8> set8(CAPACITY);
+        MyCache::KSetAssocCache<int, int, 16> set16(CAPACITY);
+        std::array<MyCache::KICachePolicy<int, int>*, 3> caches = {&lru, &set8, &set16};
+        std::vector<int> hits(caches.size(), 0);
+
+        for (int op = 0; op < OPERATIONS; ++op) {
+            int key;
+            if (w == 0) {
+                key = gen() % 100 < 70 ? gen() % (CAPACITY / 2) : CAPACITY + gen() % 20000;
+            } else if (w == 1) {
+                key = op % 100 < 70 ? op % (CAPACITY * 2) : gen() % (CAPACITY * 2);
+            } else {
+                // 幂律分布：key = N^u，u在[0,1)上均匀分布
+                key = static_cast<int>(std::pow(50000.0, std::uniform_real_distribution<double>(0, 1)(gen)));
+            }
+            for (size_t i = 0; i < caches.size(); ++i) {
+                int value;
+                if (caches[i]->get(key, value)) {
+                    hits[i]++;
+                } else {
+                    caches[i]->put(key, key);
+                }
+            }
+        }
+
+        std::cout << workloads[w] << "  LRU: " << std::fixed << std::setprecision(2)
+                  << (100.0 * hits[0] / OPERATIONS) << "%  8路组相联: "
+                  << (100.0 * hits[1] / OPERATIONS) << "%  16路组相联: "
+                  << (100.0 * hits[2] / OPERATIONS) << "%" << std::endl;
+    }
+}
+
+// 填充大容量缓存时单次put的最大耗时(扩容rehash会在锁内造成停顿)
+void testFillLatency() {
+    std::cout << "\n=== 测试场景7：大容量填充延迟测试 ===" << std::endl;
+
+    const int CAPACITY = 1000000;
+
+    auto fill = [&](MyCache::KICachePolicy<int, int>& cache, const char* name) {
+        std::vector<double> latencies(CAPACITY);
+        auto begin = std::chrono::steady_clock::now();
+        for (int key = 0; key < CAPACITY; ++key) {
+            auto start = std::chrono::steady_clock::now();
+            cache.put(key, key);
+            latencies[key] = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+        }
+        double total = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+        std::sort(latencies.begin(), latencies.end());
+        std::cout << name << " 总耗时: " << std::fixed << std::setprecision(0) << total << "ms  p99.9: "
+                  << std::setprecision(2) << latencies[CAPACITY * 999 / 1000] << "us  最大: "
+                  << latencies.back() << "us" << std::endl;
+    };
+
+    MyCache::KLruCache<int, int> lru(CAPACITY);
+    fill(lru, "LRU");
+    MyCache::KLfuCache<int, int> lfu(CAPACITY);
+    fill(lfu, "LFU");
+}
+
+// 各缓存策略每个条目的内存开销(索引/管理开销/有效数据)
+void testMemoryOverhead() {
+    std::cout << "\n=== 测试场景8：每条目内存开销测试 ===" << std::endl;
+
+    const int ENTRIES = 1000000;
+
+    auto report = [](const char* name, MyCache::KICachePolicy<int, int>& cache, int entries, int rounds) {
+        for (int round = 0; round < rounds; ++round) {
+            for (int key = 0; key < entries; ++key) {
+                cache.put(key, key);
+            }
+        }
+        MyCache::KMemoryUsage usage = cache.memoryUsage();
+        std::cout << name << " 条目: " << usage.entries << std::fixed << std::setprecision(1)
+                  << "  每条目字节: " << usage.bytesPerEntry()
+                  << " (索引 " << 1.0 * usage.indexBytes / usage.entries
+                  << " / 管理 " << 1.0 * usage.metadataBytes / usage.entries
+                  << " / 数据 " << 1.0 * usage.payloadBytes / usage.entries << ")" << std::endl;
+    };
+
+    {
+        MyCache::KLruCache<int, int> lru(ENTRIES);
+        report("LRU       ", lru, ENTRIES, 1);
+    }
+    {
+        MyCache::KLruKCache<int, int> lru_k(ENTRIES, ENTRIES, 2);
+        report("LRU-k     ", lru_k, ENTRIES, 2);    // 第二次put才进入缓存
+    }
+    {
+        MyCache::KHashLruCaches<int, int> lru_hash(ENTRIES, 8);
+        report("LRU-hash  ", lru_hash, ENTRIES, 1);
+    }
+    {
+        MyCache::KLfuCache<int, int> lfu(ENTRIES);
+        report("LFU       ", lfu, ENTRIES, 1);
+    }
+    {
+        MyCache::KLfuAgingCache<int, int> lfu_aging(ENTRIES, 20);
+        report("LFU-Aging ", lfu_aging, ENTRIES, 1);
+    }
+    {
+        MyCache::KHashLfuCache<int, int> lfu_hash(ENTRIES, 8, 20);
+        report("LFU-hash  ", lfu_hash, ENTRIES, 1);
+    }
+    {
+        MyCache::KArcCache<int, int> arc(ENTRIES * 2);  // LRU部分和LFU部分各占一半容量
+        report("ARC       ", arc, ENTRIES, 1);
+    }
+    {
+        MyCache::KWindowLfuCache<int, int> lfu_window(ENTRIES, 1000);
+        report("LFU-Window", lfu_window, ENTRIES, 1);
+    }
+    {
+        MyCache::KCuckooCache<int, int> cuckoo(ENTRIES);
+        report("Cuckoo    ", cuckoo, ENTRIES, 1);
+    }
+    {
+        MyCache::KSetAssocCache<int, int> set8(ENTRIES);
+        report("组相联8路 ", set8, ENTRIES, 1);
+    }
+    {
+        MyCache::KTinyCache<int, int, 64> tiny;   // 小容量缓存只能放64项
+        report("Tiny(64)  ", tiny, 64, 1);
+    }
+}
+
+// 批量加载与逐个put的填充速度对比
+void testBulkLoad() {
+    std::cout << "\n=== 测试场景9：批量加载测试 ===" << std::endl;
+
+    const int ENTRIES = 1000000;
+    std::vector<std::pair<int, int>> entries;
+    entries.reserve(ENTRIES);
+    for (int key = 0; key < ENTRIES; ++key) {
+        entries.emplace_back(key, key);
+    }
+
+    // 每次用新建的缓存分别测量逐个put和bulkLoad，输出每秒加载的条目数
+    auto compare = [&](const char* name, const std::function<std::unique_ptr<MyCache::KICachePolicy<int, int>>()>& make) {
+        auto byPut = make();
+        auto start = std::chrono::steady_clock::now();
+        for (const auto& entry : entries) {
+            byPut->put(entry.first, entry.second);
+        }
+        double putSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        auto byBulk = make();
+        start = std::chrono::steady_clock::now();
+        byBulk->bulkLoad(entries);
+        double bulkSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        std::cout << name << " put: " << std::fixed << std::setprecision(2) << ENTRIES / putSeconds / 1e6
+                  << " M条/秒  bulkLoad: " << ENTRIES / bulkSeconds / 1e6 << " M条/秒" << std::endl;
+    };
+
+    compare("LRU     ", [&] { return std::make_unique<MyCache::KLruCache<int, int>>(ENTRIES); });
+    compare("LRU-hash", [&] { return std::make_unique<MyCache::KHashLruCaches<int, int>>(ENTRIES, 8); });
+    compare("LFU     ", [&] { return std::make_unique<MyCache::KLfuCache<int, int>>(ENTRIES); });
+    compare("LFU-hash", [&] { return std::make_unique<MyCache::KHashLfuCache<int, int>>(ENTRIES, 8, 20); });
+    compare("Cuckoo  ", [&] { return std::make_unique<MyCache::KCuckooCache<int, int>>(ENTRIES); });
+}
+
+// 追加日志：不同同步策略下的写入吞吐、重写压缩和重启恢复耗时
+void testAppendLog() {
+    std::cout << "\n=== 测试场景10：追加日志(AOF)测试 ===" << std::endl;
+
+    const int CAPACITY = 100000;
+    const int OPERATIONS = 500000;
+    const std::string path = "mycache_aof_test.log";
+
+    auto writeLoad = [&](const char* name, MyCache::KICachePolicy<int, int>& cache, const std::function<void()>& sync) {
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < OPERATIONS; ++i) {
+            cache.put(i % CAPACITY, i);
+        }
+        double enqueueMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        sync();
+        double totalMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        std::cout << name << " 写入: " << std::fixed << std::setprecision(2) << OPERATIONS / enqueueMs / 1000
+                  << " M次/秒  含落盘: " << OPERATIONS / totalMs / 1000 << " M次/秒" << std::endl;
+    };
+
+    {
+        MyCache::KLruCache<int, int> lru(CAPACITY);
+        writeLoad("无日志         ", lru, [] {});
+    }
+
+    const std::pair<const char*, MyCache::KLogSyncPolicy> policies[] = {
+        {"每秒同步       ", MyCache::KLogSyncPolicy::Interval},
+        {"每批同步       ", MyCache::KLogSyncPolicy::Always},
+    };
+    for (const auto& policy : policies) {
+        std::remove(path.c_str());
+        MyCache::KAppendLogOptions options;
+        options.syncPolicy = policy.second;
+        options.rewritePercentage = 0;
+        MyCache::KLruCache<int, int> lru(CAPACITY);
+        MyCache::KAofCache<int, int> aof(lru, path, options);
+        writeLoad(policy.first, aof, [&] { aof.sync(); });
+    }
+
+    // 上面最后一个日志包含OPERATIONS条记录，重写前后各恢复一次
+    auto recover = [&](const char* name) {
+        MyCache::KLruCache<int, int> lru(CAPACITY);
+        auto start = std::chrono::steady_clock::now();
+        MyCache::KAofCache<int, int> aof(lru, path);
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        std::cout << name << " 日志大小: " << aof.logStats().fileBytes / 1024 << "KB  记录数: "
+                  << aof.replayStats().records << "  恢复条目: " << aof.replayStats().entries
+                  << "  恢复耗时: " << std::setprecision(0) << ms << "ms" << std::endl;
+        return ms;
+    };
+    recover("重写前");
+    {
+        MyCache::KLruCache<int, int> lru(CAPACITY);
+        MyCache::KAofCache<int, int> aof(lru, path);
+        aof.rewriteLog();
+        while (aof.rewriting()) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+    recover("重写后");
+    std::remove(path.c_str());
+
+    // 崩溃恢复的正确性：写入、删除、过期、清空都要按顺序重放，损坏的尾部被截断，重写后结果不变
+    {
+        std::map<int, std::string> expected;
+        auto recovered = [&](MyCache::KAofCache<int, std::string>& aof) {
+            std::vector<std::pair<int, std::string>> entries;
+            aof.snapshot(entries);
+            std::map<int, std::string> actual(entries.begin(), entries.end());
+            return entries.size() == actual.size() && actual == expected;
+        };
+
+        std::remove(path.c_str());
+        {
+            MyCache::KLruCache<int, std::string> lru(1000);
+            MyCache::KAofCache<int, std::string> aof(lru, path);
+            for (int key = 0; key < 100; ++key) {
+                aof.put(key, "old-" + std::to_string(key));
+            }
+            aof.clear();
+            for (int key = 50; key < 150; ++key) {
+                aof.put(key, "v-" + std::to_string(key));
+                expected[key] = "v-" + std::to_string(key);
+            }
+            for (int key = 50; key < 150; key += 3) {
+                aof.remove(key);
+                expected.erase(key);
+            }
+            for (int key = 51; key < 150; key += 5) {
+                if (aof.expire(key)) {
+                    expected.erase(key);
+                }
+            }
+            aof.put(60, "rewritten");
+            expected[60] = "rewritten";
+            aof.sync();
+        }
+        // 模拟写到一半崩溃：日志尾部是一段不完整的记录
+        const char garbage[] = "\x01\x7f\x00torn";
+        FILE* file = std::fopen(path.c_str(), "ab");
+        if (file != nullptr) {
+            std::fwrite(garbage, 1, sizeof(garbage) - 1, file);
+            std::fclose(file);
+        }
+        {
+            MyCache::KLruCache<int, std::string> lru(1000);
+            MyCache::KAofCache<int, std::string> aof(lru, path);
+            expect(aof.replayStats().truncatedBytes == sizeof(garbage) - 1, "AOF：应截断损坏的尾部");
+            expect(recovered(aof), "AOF：恢复的数据应与崩溃前写入的一致(含删除、过期和清空)");
+            // 截断后继续追加，再重写日志
+            aof.put(200, "after-truncate");
+            aof.remove(61);
+            expected[200] = "after-truncate";
+            expected.erase(61);
+            aof.sync();
+            aof.rewriteLog();
+            while (aof.rewriting()) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        }
+        {
+            MyCache::KLruCache<int, std::string> lru(1000);
+            MyCache::KAofCache<int, std::string> aof(lru, path);
+            expect(aof.replayStats().truncatedBytes == 0, "AOF：截断后追加的日志不应再有损坏的尾部");
+            expect(recovered(aof), "AOF：重写后恢复的数据应保持不变");
+        }
+        std::remove(path.c_str());
+    }
+}
+
+void testReplication() {
+    std::cout << "\n=== 测试场景11：主从复制测试 ===" << std::endl;
+
+    const int CAPACITY = 100000;
+    const int OPERATIONS = 1000000;
+    const int MARK_INTERVAL = 1000;     // 每隔这么多次写入带一次时间戳，副本据此计算延迟
+    const int TIME_KEY = -1;
+    const int DONE_KEY = -2;
+    const std::string address = "mycache_repl_test.sock";
+
+    auto nowNs = [] {
+        return static_cast<long long>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+    };
+
+    // 副本进程把结果通过管道交给主进程
+    struct ReplicaResult {
+        long long doneNs;
+        long long lagAvgNs;
+        long long lagP99Ns;
+        long long lagMaxNs;
+    };
+    int fds[2];
+    if (pipe(fds) != 0) {
+        std::cout << "创建管道失败" << std::endl;
+        return;
+    }
+
+    pid_t pid = fork();
+    if (pid == 0) {
+        close(fds[0]);
+        ReplicaResult result{};
+        {
+            MyCache::KLruCache<int, long long> cache(CAPACITY + 2);
+            MyCache::KReplica<int, long long> replica(cache, address);
+            std::vector<long long> lags;
+            long long lastStamp = 0;
+            std::atomic<bool> done(false);
+            replica.setApplyListener([&](uint64_t) {
+                long long stamp = 0;
+                if (cache.get(TIME_KEY, stamp) && stamp != lastStamp) {
+                    lags.push_back(nowNs() - stamp);
+                    lastStamp = stamp;
+                }
+                long long flag = 0;
+                if (!done && cache.get(DONE_KEY, flag)) {
+                    result.doneNs = nowNs();
+                    done = true;
+                }
+            });
+            replica.start();
+            while (!done) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+            replica.stop();
+            if (!lags.empty()) {
+                std::sort(lags.begin(), lags.end());
+                long long sum = 0;
+                for (long long lag : lags) {
+                    sum += lag;
+                }
+                result.lagAvgNs = sum / static_cast<long long>(lags.size());
+                result.lagP99Ns = lags[lags.size() * 99 / 100];
+                result.lagMaxNs = lags.back();
+            }
+        }
+        ssize_t written = write(fds[1], &result, sizeof(result));
+        _exit(written == sizeof(result) ? 0 : 1);
+    }
+    close(fds[1]);
+
+    {
+        MyCache::KLruCache<int, long long> cache(CAPACITY + 2);
+        MyCache::KReplicationPrimary<int, long long> primary(cache, address);
+        while (primary.replicas().empty()) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+
+        long long start = nowNs();
+        for (int i = 0; i < OPERATIONS; ++i) {
+            primary.put(i % CAPACITY, i);
+            if (i % MARK_INTERVAL == 0) {
+                primary.put(TIME_KEY, nowNs());
+            }
+        }
+        primary.put(DONE_KEY, 1);
+        long long written = nowNs();
+
+        ReplicaResult result{};
+        ssize_t n = read(fds[0], &result, sizeof(result));
+        waitpid(pid, nullptr, 0);
+        if (n != sizeof(result)) {
+            std::cout << "副本进程异常退出" << std::endl;
+        } else {
+            std::cout << "主节点写入: " << std::fixed << std::setprecision(2)
+                      << OPERATIONS / ((written - start) / 1e6) / 1000 << " M次/秒" << std::endl;
+            std::cout << "副本应用:   " << OPERATIONS / ((result.doneNs - start) / 1e6) / 1000 << " M次/秒" << std::endl;
+            std::cout << "复制延迟:   平均 " << std::setprecision(1) << result.lagAvgNs / 1e6
+                      << "ms  P99 " << result.lagP99Ns / 1e6 << "ms  最大 " << result.lagMaxNs / 1e6 << "ms" << std::endl;
+        }
+    }
+    close(fds[0]);
+
+    // 一致性：积压区很小，断线重连分别走增量同步和全量同步，应用变慢时被断开后重新全量同步，每次都比较两边的数据
+    {
+        const std::string checkAddress = "mycache_repl_check.sock";
+        MyCache::KReplicationOptions options;
+        options.backlogRecords = 64;
+        options.batchRecords = 16;
+        options.reconnectDelay = std::chrono::milliseconds(10);
+        MyCache::KLruCache<int, long long> primaryCache(1000);
+        MyCache::KLruCache<int, long long> replicaCache(1000);
+        MyCache::KReplicationPrimary<int, long long> primary(primaryCache, checkAddress, options);
+        MyCache::KReplica<int, long long> replica(replicaCache, checkAddress, options);
+        std::atomic<int> applyDelayMs(0);
+        replica.setApplyListener([&](uint64_t) {
+            int delay = applyDelayMs.exchange(0);
+            if (delay > 0) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(delay));
+            }
+        });
+
+        long long marker = 0;
+        // 写一个标记，等副本应用到它并追上主节点的偏移
+        auto waitSynced = [&] {
+            primary.put(DONE_KEY, ++marker);
+            for (int i = 0; i < 5000; ++i) {
+                long long seen = 0;
+                if (replicaCache.get(DONE_KEY, seen) && seen == marker
+                    && replica.appliedOffset() == primary.stats().offset) {
+                    return true;
+                }
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+            return false;
+        };
+        auto sameData = [&] {
+            std::vector<std::pair<int, long long>> a, b;
+            primaryCache.snapshot(a);
+            replicaCache.snapshot(b);
+            std::sort(a.begin(), a.end());
+            std::sort(b.begin(), b.end());
+            return a == b;
+        };
+        auto writeRange = [&](int begin, int end) {
+            for (int key = begin; key < end; ++key) {
+                primary.put(key % 500, key);
+                if (key % 7 == 0) {
+                    primary.remove((key + 3) % 500);
+                }
+            }
+        };
+
+        replica.start();
+        writeRange(0, 300);
+        primary.clear();
+        writeRange(300, 600);
+        expect(waitSynced() && sameData(), "复制：初次全量同步后副本应与主节点一致(含删除和清空)");
+
+        // 积压区很小，上面的写入期间副本可能已经因落后被断开过，所以只比较同步次数的增量
+        replica.stop();
+        uint64_t partialBefore = replica.stats().partialSyncs;
+        writeRange(600, 620);   // 不超过积压区
+        replica.start();
+        expect(waitSynced() && sameData() && replica.stats().partialSyncs > partialBefore, "复制：断线重连应增量同步并保持一致");
+
+        replica.stop();
+        uint64_t fullBefore = replica.stats().fullSyncs;
+        writeRange(620, 1000);  // 超出积压区
+        replica.start();
+        // 重连时后台线程可能还没把新记录放入积压区，会先增量同步、发现落后后再断开重连做全量同步
+        expect(waitSynced() && sameData() && replica.stats().fullSyncs > fullBefore, "复制：落后超出积压区应全量同步并保持一致");
+
+        // 副本应用卡住时套接字缓冲区被填满，发送线程落后于积压区后被断开，副本重连后全量同步
+        uint64_t droppedBefore = primary.stats().droppedReplicas;
+        applyDelayMs = 1000;
+        writeRange(1000, 200000);
+        expect(waitSynced() && sameData(), "复制：落后被断开后重新全量同步应保持一致");
+        expect(primary.stats().droppedReplicas > droppedBefore, "复制：应用卡住的副本应因落后太多被断开");
+        replica.stop();
+    }
+}
+
+void testCacheCluster() {
+    std::cout << "\n=== 测试场景12：一致性哈希客户端测试 ===" << std::endl;
+
+    const int SERVERS = 4;              // 前3个先加入，最后一个测试扩容
+    const int CAPACITY = 200000;        // 每个服务器的容量
+    const int KEYS = 200000;
+    const int BATCH = 1000;
+
+    // 每个服务器一个子进程，主进程关闭管道写端后子进程退出
+    std::vector<std::string> addresses;
+    std::vector<pid_t> pids;
+    int fds[2];
+    if (pipe(fds) != 0) {
+        std::cout << "创建管道失败" << std::endl;
+        return;
+    }
+    for (int s = 0; s < SERVERS; ++s) {
+        addresses.push_back("mycache_server_" + std::to_string(s) + ".sock");
+        pid_t pid = fork();
+        if (pid == 0) {
+            close(fds[1]);
+            {
+                MyCache::KLruCache<int, int> cache(CAPACITY);
+                MyCache::KCacheServer<int, int> server(cache, addresses.back());
+                char byte;
+                while (read(fds[0], &byte, 1) > 0) {
+                }
+            }
+            _exit(0);
+        }
+        pids.push_back(pid);
+    }
+    close(fds[0]);
+    for (const auto& address : addresses) {
+        int fd;
+        while ((fd = MyCache::KSocket::connect(address)) < 0) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        close(fd);
+    }
+
+    {
+        MyCache::KCacheClient<int, int> client({addresses[0], addresses[1], addresses[2]});
+        std::vector<std::pair<int, int>> entries;
+        std::vector<int> keys;
+        for (int i = 0; i < KEYS; ++i) {
+            keys.push_back(i);
+            entries.emplace_back(i, i);
+        }
+
+        auto rate = [](const char* name, int operations, const std::function<void()>& body) {
+            auto start = std::chrono::steady_clock::now();
+            body();
+            double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            std::cout << name << std::fixed << std::setprecision(2) << operations / ms / 1000 << " M次/秒" << std::endl;
+        };
+        rate("批量写入(每批1000):  ", KEYS, [&] {
+            for (int i = 0; i < KEYS; i += BATCH) {
+                client.putMany(std::vector<std::pair<int, int>>(entries.begin() + i, entries.begin() + i + BATCH));
+            }
+        });
+        size_t hits = 0;
+        rate("批量读取(每批1000):  ", KEYS, [&] {
+            std::vector<std::pair<int, int>> found;
+            for (int i = 0; i < KEYS; i += BATCH) {
+                found.clear();
+                hits += client.getMany(std::vector<int>(keys.begin() + i, keys.begin() + i + BATCH), found);
+            }
+        });
+        rate("逐个读取:            ", KEYS / 10, [&] {
+            int value;
+            for (int i = 0; i < KEYS / 10; ++i) {
+                client.get(i, value);
+            }
+        });
+
+        // 扩容和缩容：统计换了服务器的key的比例，以及之后的命中率
+        auto rebalance = [&](const char* name, const std::function<void()>& change) {
+            std::vector<std::string> before;
+            for (int key : keys) {
+                before.push_back(client.serverFor(key));
+            }
+            change();
+            int moved = 0;
+            for (int i = 0; i < KEYS; ++i) {
+                moved += client.serverFor(keys[i]) != before[i];
+            }
+            std::vector<std::pair<int, int>> found;
+            size_t hit = client.getMany(keys, found);
+            std::cout << name << "迁移key比例: " << std::setprecision(1) << 100.0 * moved / KEYS
+                      << "%  之后命中率: " << 100.0 * hit / KEYS << "%" << std::endl;
+        };
+        std::cout << "3台服务器命中率: " << std::setprecision(1) << 100.0 * hits / KEYS << "%" << std::endl;
+        rebalance("3台->4台 ", [&] { client.addServer(addresses[3]); });
+        client.putMany(entries);
+        rebalance("4台->3台 ", [&] { client.removeServer(addresses[0]); });
+    }
+
+    close(fds[1]);
+    for (pid_t pid : pids) {
+        waitpid(pid, nullptr, 0);
+    }
+}
+
+// 模拟创建者在初始化中途崩溃：子进程创建共享内存并加flock，设置大小(size为0时不设置)、写入一些垃圾后直接退出
+void abandonShmCreation(const std::string& name, size_t size) {
+    shm_unlink(name.c_str());
+    pid_t pid = fork();
+    if (pid == 0) {
+        int fd = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+        if (fd < 0 || flock(fd, LOCK_EX) != 0) {
+            _exit(1);
+        }
+        if (size > 0) {
+            const char garbage[] = "half-initialized";
+            if (ftruncate(fd, static_cast<off_t>(size)) != 0 || pwrite(fd, garbage, sizeof(garbage), 8) < 0) {
+                _exit(1);
+            }
+        }
+        _exit(0);
+    }
+    waitpid(pid, nullptr, 0);
+}
+
+void testInvalidationBus() {
+    std::cout << "\n=== 测试场景13：跨进程失效总线测试 ===" << std::endl;
+
+    const int KEYS = 200000;
+    const int PINGS = 10000;
+    const int BATCH = 256;
+    const uint64_t PING = 0x50494e4700000000ULL;    // 不是key的哈希值，只用来测延迟
+    const uint64_t ECHO = 0x4543484f00000000ULL;
+    const uint64_t DONE = 0x444f4e4500000000ULL;
+    const std::string name = "/mycache_bus_test";
+    const size_t CAPACITY = 1 << 18;    // 装得下一整轮失效，订阅者不会被套圈
+
+    auto nowNs = [] {
+        return static_cast<long long>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+    };
+
+    struct SubscriberResult {
+        long long doneNs;
+        uint64_t removed;
+        uint64_t batches;
+        uint64_t overruns;
+    };
+    int fds[2];
+    if (pipe(fds) != 0) {
+        std::cout << "创建管道失败" << std::endl;
+        return;
+    }
+    MyCache::KInvalidationBus::unlink(name);
+
+    // 子进程：内嵌一个装满的KHashLruCaches，应用总线上的失效，并回应PING
+    pid_t pid = fork();
+    if (pid == 0) {
+        close(fds[0]);
+        SubscriberResult result{};
+        {
+            MyCache::KHashLruCaches<int, int> cache(KEYS, 4);
+            for (int i = 0; i < KEYS; ++i) {
+                cache.put(i, i);
+            }
+            MyCache::KInvalidationBus bus(name, CAPACITY);
+            std::atomic<bool> done(false);
+            std::vector<uint64_t> echoes;
+            bus.subscribe([&](const std::vector<uint64_t>& hashes) {
+                result.removed += cache.invalidateHashes(hashes);
+                echoes.clear();
+                for (uint64_t hash : hashes) {
+                    if ((hash & 0xffffffff00000000ULL) == PING) {
+                        echoes.push_back(ECHO | (hash & 0xffffffffULL));
+                    } else if (hash == DONE) {
+                        result.doneNs = nowNs();
+                        done = true;
+                    }
+                }
+                bus.publish(echoes);
+            }, [&] { cache.clear(); });
+            while (!done) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+            bus.stop();
+            result.batches = bus.stats().batches;
+            result.overruns = bus.stats().overruns;
+        }
+        ssize_t written = write(fds[1], &result, sizeof(result));
+        _exit(written == sizeof(result) ? 0 : 1);
+    }
+    close(fds[1]);
+
+    {
+        MyCache::KInvalidationBus bus(name, CAPACITY);
+        std::atomic<uint64_t> lastEcho(0);
+        bus.subscribe([&](const std::vector<uint64_t>& hashes) {
+            for (uint64_t hash : hashes) {
+                if ((hash & 0xffffffff00000000ULL) == ECHO) {
+                    lastEcho = hash & 0xffffffffULL;
+                }
+            }
+        }, [] {});
+
+        // 等子进程订阅好
+        while (lastEcho == 0) {
+            bus.publish(PING | 0xffffffffULL);
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+
+        // 往返延迟：发一个PING，等子进程的ECHO
+        std::vector<long long> rtts;
+        for (int i = 1; i <= PINGS; ++i) {
+            long long start = nowNs();
+            bus.publish(PING | static_cast<uint64_t>(i));
+            while (lastEcho != static_cast<uint64_t>(i)) {
+                std::this_thread::yield();
+            }
+            rtts.push_back(nowNs() - start);
+        }
+        std::sort(rtts.begin(), rtts.end());
+
+        // 吞吐：广播所有key的失效
+        std::vector<uint64_t> hashes;
+        long long start = nowNs();
+        for (int i = 0; i < KEYS; i += BATCH) {
+            hashes.clear();
+            for (int k = i; k < std::min(KEYS, i + BATCH); ++k) {
+                hashes.push_back(MyCache::KHashedKey<int>(k).hash);
+            }
+            bus.publish(hashes);
+        }
+        bus.publish(DONE);
+
+        SubscriberResult result{};
+        ssize_t n = read(fds[0], &result, sizeof(result));
+        waitpid(pid, nullptr, 0);
+        if (n != sizeof(result)) {
+            std::cout << "订阅进程异常退出" << std::endl;
+        } else {
+            std::cout << "往返延迟: 中位数 " << std::fixed << std::setprecision(1) << rtts[rtts.size() / 2] / 1000.0
+                      << "us  P99 " << rtts[rtts.size() * 99 / 100] / 1000.0 << "us" << std::endl;
+            std::cout << "失效吞吐: " << std::setprecision(2) << KEYS / ((result.doneNs - start) / 1e6) / 1000
+                      << " M个/秒  删除条目: " << result.removed << "/" << KEYS
+                      << "  批次: " << result.batches << "  整体失效: " << result.overruns << std::endl;
+        }
+    }
+    close(fds[0]);
+    MyCache::KInvalidationBus::unlink(name);
+
+    // 创建者在写入魔数前崩溃：之后打开的进程应接手创建，而不是一直等待
+    for (size_t size : {size_t(0), size_t(4096)}) {
+        abandonShmCreation(name, size);
+        MyCache::KInvalidationBus publisher(name, 1024);
+        MyCache::KInvalidationBus subscriber(name, 1024);
+        std::atomic<uint64_t> received(0);
+        subscriber.subscribe([&](const std::vector<uint64_t>& hashes) { received += hashes.size(); }, [] {});
+        for (int i = 0; i < 1000 && received == 0; ++i) {
+            publisher.publish(12345);
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        subscriber.stop();
+        expect(received > 0, "创建者中途崩溃(大小" + std::to_string(size) + ")后重新创建的总线应能收发");
+        MyCache::KInvalidationBus::unlink(name);
+    }
+}
+
+void testSharedMemoryCache() {
+    std::cout << "\n=== 测试场景14：跨进程共享内存缓存测试 ===" << std::endl;
+
+    const int WORKERS = 4;
+    const int KEYS = 100000;
+    const int READS = 500000;           // 每个进程的读取次数
+    const std::string name = "/mycache_shm_test";
+    const std::string payload(64, 'v');
+
+    MyCache::KShmCache<int, std::string>::unlink(name);
+    MyCache::KShmCacheOptions options;
+    options.valueBytes = 64;
+    MyCache::KShmCache<int, std::string> cache(name, KEYS, options);
+    for (int i = 0; i < KEYS; ++i) {
+        cache.put(i, payload);
+    }
+
+    // 每个进程各存一份 vs 所有进程共享一份
+    {
+        MyCache::KLruCache<int, std::string> lru(KEYS);
+        for (int i = 0; i < KEYS; ++i) {
+            lru.put(i, payload);
+        }
+        std::cout << WORKERS << "个进程各自缓存: " << std::fixed << std::setprecision(1)
+                  << WORKERS * lru.memoryUsage().total() / 1048576.0 << "MB  共享一份: "
+                  << cache.regionBytes() / 1048576.0 << "MB" << std::endl;
+    }
+
+    // 多个进程同时零复制读取
+    auto start = std::chrono::steady_clock::now();
+    std::vector<pid_t> pids;
+    for (int w = 0; w < WORKERS; ++w) {
+        pid_t pid = fork();
+        if (pid == 0) {
+            MyCache::KShmCache<int, std::string> shared(name, KEYS, options);
+            std::mt19937 gen(w);
+            std::uniform_int_distribution<int> dist(0, KEYS - 1);
+            size_t bytes = 0;
+            for (int i = 0; i < READS; ++i) {
+                shared.read(dist(gen), [&](const char*, size_t size) { bytes += size; });
+            }
+            _exit(bytes > 0 ? 0 : 1);
+        }
+        pids.push_back(pid);
+    }
+    for (pid_t pid : pids) {
+        waitpid(pid, nullptr, 0);
+    }
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    std::cout << WORKERS << "个进程并发读取: " << std::setprecision(2) << WORKERS * READS / ms / 1000 << " M次/秒" << std::endl;
+
+    // 持锁时崩溃：子进程在compute的回调中退出，之后其他进程照常访问
+    pid_t pid = fork();
+    if (pid == 0) {
+        MyCache::KShmCache<int, std::string> shared(name, KEYS, options);
+        shared.compute(0, [](bool, std::string&, uint64_t) {
+            _exit(1);
+            return MyCache::KComputeAction::Keep;
+        });
+        _exit(0);
+    }
+    waitpid(pid, nullptr, 0);
+    start = std::chrono::steady_clock::now();
+    std::string value;
+    cache.get(0, value);
+    ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    auto stats = cache.stats();
+    std::cout << "持锁进程崩溃后: 重建分片 " << stats.recoveries << " 次，耗时 " << std::setprecision(3) << ms
+              << "ms，剩余条目 " << stats.entries << "/" << KEYS << std::endl;
+    MyCache::KShmCache<int, std::string>::unlink(name);
+
+    // 创建者在初始化完成前崩溃(还没设置大小，或设置了大小但没写完)：之后打开的进程应接手初始化
+    const std::string abandoned = "/mycache_shm_abandoned";
+    for (size_t size : {size_t(0), size_t(4096)}) {
+        abandonShmCreation(abandoned, size);
+        MyCache::KShmCache<int, std::string> first(abandoned, 100, options);
+        MyCache::KShmCache<int, std::string> second(abandoned, 100, options);
+        first.put(1, payload);
+        expect(second.get(1, value) && value == payload,
+               "创建者中途崩溃(大小" + std::to_string(size) + ")后重新初始化的共享缓存应能读写");
+        MyCache::KShmCache<int, std::string>::unlink(abandoned);
+    }
+}
+
+// 两级缓存：小LRU在前、大LFU在后，与同等总容量的单级缓存比较命中率，并给出各级命中和升降级次数
+void testTieredCache() {
+    std::cout << "\n=== 测试场景15：两级缓存测试 ===" << std::endl;
+
+    const int L1_CAPACITY = 1024;
+    const int L2_CAPACITY = 8192;
+    const int OPERATIONS = 500000;
+    const int MAX_AVERAGE_FREQ = 1000000;  // 老化阈值调高：Zipf负载下热点频次很高，默认值会频繁触发全量老化
+
+    std::mt19937 gen(42);
+    std::vector<int> keys(OPERATIONS);
+    for (int& key : keys) {
+        // 近似Zipf分布，key空间是总容量的约6倍
+        key = static_cast<int>(std::pow(60000.0, std::uniform_real_distribution<double>(0, 1)(gen)));
+    }
+
+    auto run = [&](MyCache::KICachePolicy<int, int>& cache) {
+        int hits = 0;
+        Timer timer;
+        for (int key : keys) {
+            int value;
+            if (cache.get(key, value)) {
+                hits++;
+            } else {
+                cache.put(key, key);
+            }
+        }
+        double ms = timer.elapsed();
+        std::cout << "命中率: " << std::fixed << std::setprecision(2) << (100.0 * hits / OPERATIONS)
+                  << "%  耗时: " << ms << "ms" << std::endl;
+    };
+
+    {
+        MyCache::KLruCache<int, int> lru(L1_CAPACITY + L2_CAPACITY);
+        std::cout << "单级LRU(" << L1_CAPACITY + L2_CAPACITY << ")       ";
+        run(lru);
+        MyCache::KHashLfuCache<int, int> lfu(L1_CAPACITY + L2_CAPACITY, 4, MAX_AVERAGE_FREQ);
+        std::cout << "单级LFU-hash(" << L1_CAPACITY + L2_CAPACITY << ")  ";
+        run(lfu);
+    }
+
+    std::array<MyCache::KTierMode, 2> modes = {MyCache::KTierMode::Exclusive, MyCache::KTierMode::Inclusive};
+    for (MyCache::KTierMode mode : modes) {
+        MyCache::KLruCache<int, int> l1(L1_CAPACITY);
+        MyCache::KHashLfuCache<int, int> l2(L2_CAPACITY, 4, MAX_AVERAGE_FREQ);
+        MyCache::KTieredCache<int, int> tiered(l1, l2, mode);
+        std::cout << (mode == MyCache::KTierMode::Exclusive ? "互斥" : "包含") << " LRU+LFU-hash  ";
+        run(tiered);
+
+        MyCache::KTieredCacheStats stats = tiered.stats();
+        std::cout << "  L1命中: " << stats.l1Hits << "  L2命中: " << stats.l2Hits << "  未命中: " << stats.misses
+                  << "  提升: " << stats.promotions << "  降级: " << stats.demotions
+                  << "  条目数: " << tiered.memoryUsage().entries << std::endl;
+    }
+}
+
+// 40~100字节的字符串key：每条目内存和查找耗时，KHashLruCaches<std::string>与key存放在arena中的KStringLruCache比较
+void testStringKeys() {
+    std::cout << "\n=== 测试场景16：字符串key存储测试 ===" << std::endl;
+
+    const int ENTRIES = 200000;
+    const int LOOKUPS = 1000000;
+    const int SHARDS = 4;
+
+    std::mt19937 gen(7);
+    std::vector<std::string> keys(ENTRIES);
+    for (int i = 0; i < ENTRIES; ++i) {
+        // 公共前缀 + 序号 + 随机填充，总长40~100字节
+        std::string key = "tenant:42:session:" + std::to_string(i) + ":";
+        size_t length = 40 + gen() % 61;
+        while (key.size() < length) {
+            key.push_back(static_cast<char>('a' + gen() % 26));
+        }
+        keys[i] = key;
+    }
+    std::vector<int> order(LOOKUPS);
+    for (int& index : order) {
+        index = gen() % ENTRIES;
+    }
+
+    auto report = [&](const char* name, MyCache::KICachePolicy<std::string, int>& cache,
+                      const std::function<bool(const std::string&, int&)>& lookup) {
+        for (int i = 0; i < ENTRIES; ++i) {
+            cache.put(keys[i], i);
+        }
+        MyCache::KMemoryUsage usage = cache.memoryUsage();
+
+        int hits = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (int index : order) {
+            int value;
+            hits += lookup(keys[index], value) && value == index;
+        }
+        double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / LOOKUPS;
+
+        std::cout << name << " 每条目字节: " << std::fixed << std::setprecision(1) << usage.bytesPerEntry()
+                  << " (索引 " << 1.0 * usage.indexBytes / usage.entries
+                  << " / 管理 " << 1.0 * usage.metadataBytes / usage.entries
+                  << " / 数据 " << 1.0 * usage.payloadBytes / usage.entries << ")"
+                  << "  查找: " << ns << "ns  命中: " << hits << "/" << LOOKUPS << std::endl;
+    };
+
+    {
+        MyCache::KHashLruCaches<std::string, int> lru_hash(ENTRIES, SHARDS);
+        report("LRU-hash<string>", lru_hash, [&](const std::string& key, int& value) {
+            return lru_hash.get(key, value);
+        });
+    }
+    {
+        MyCache::KStringLruCache<int> string_lru(ENTRIES, SHARDS);
+        report("StringLru(arena)", string_lru, [&](const std::string& key, int& value) {
+            return string_lru.get(std::string_view(key), value);   // 不复制key
+        });
+    }
+}
+
+// uint64_t key：通用布局(哈希表和节点各存一份key、shared_ptr节点)与KIntLruCache(节点数组+32位下标)的每条目内存和读写耗时
+void testIntegerKeys() {
+    std::cout << "\n=== 测试场景17：整数key紧凑布局测试 ===" << std::endl;
+
+    const int ENTRIES = 1000000;
+    const int LOOKUPS = 2000000;
+    const int SHARDS = 8;
+
+    std::mt19937_64 gen(11);
+    std::vector<uint64_t> ids(ENTRIES);
+    for (uint64_t& id : ids) {
+        id = gen();
+    }
+    std::vector<int> order(LOOKUPS);
+    for (int& index : order) {
+        index = gen() % ENTRIES;
+    }
+
+    auto report = [&](const char* name, MyCache::KICachePolicy<uint64_t, uint64_t>& cache) {
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < ENTRIES; ++i) {
+            cache.put(ids[i], i);
+        }
+        double putNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / ENTRIES;
+
+        int hits = 0;
+        start = std::chrono::steady_clock::now();
+        for (int index : order) {
+            uint64_t value;
+            hits += cache.get(ids[index], value) && value == static_cast<uint64_t>(index);
+        }
+        double getNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / LOOKUPS;
+
+        MyCache::KMemoryUsage usage = cache.memoryUsage();
+        std::cout << name << " 每条目字节: " << std::fixed << std::setprecision(1) << usage.bytesPerEntry()
+                  << " (索引 " << 1.0 * usage.indexBytes / usage.entries
+                  << " / 管理 " << 1.0 * usage.metadataBytes / usage.entries
+                  << " / 数据 " << 1.0 * usage.payloadBytes / usage.entries << ")"
+                  << "  put: " << putNs << "ns  get: " << getNs << "ns  命中: " << hits << "/" << LOOKUPS << std::endl;
+    };
+
+    {
+        MyCache::KLruCache<uint64_t, uint64_t> lru(ENTRIES);
+        report("LRU       ", lru);
+    }
+    {
+        MyCache::KHashLruCaches<uint64_t, uint64_t> lru_hash(ENTRIES, SHARDS);
+        report("LRU-hash  ", lru_hash);
+    }
+    {
+        MyCache::KIntLruCache<uint64_t, uint64_t> int_lru(ENTRIES, SHARDS);
+        report("IntLru    ", int_lru);
+    }
+}
+
+// value较大(256字节)时的淘汰速率和LFU-Aging一次全量老化的耗时：淘汰和老化只应访问节点的元数据
+void testMetadataScan() {
+    std::cout << "\n=== 测试场景18：淘汰与老化扫描测试 ===" << std::endl;
+
+    using BigValue = std::array<char, 256>;
+    const int CAPACITY = 200000;
+    const int INSERTS = 1000000;
+    const BigValue value{};
+
+    auto evictionRate = [&](const char* name, MyCache::KICachePolicy<int, BigValue>& cache) {
+        for (int key = 0; key < CAPACITY; ++key) {
+            cache.put(key, value);
+        }
+        auto start = std::chrono::steady_clock::now();
+        for (int key = CAPACITY; key < CAPACITY + INSERTS; ++key) {
+            cache.put(key, value);     // 缓存已满，每次写入淘汰一个
+        }
+        double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / INSERTS;
+        std::cout << name << " 淘汰写入: " << std::fixed << std::setprecision(1) << ns << "ns/次" << std::endl;
+    };
+
+    {
+        MyCache::KLruCache<int, BigValue> lru(CAPACITY);
+        evictionRate("LRU      ", lru);
+    }
+    {
+        MyCache::KArcCache<int, BigValue> arc(CAPACITY);
+        evictionRate("ARC      ", arc);
+    }
+    {
+        MyCache::KLfuCache<int, BigValue> lfu(CAPACITY);
+        evictionRate("LFU      ", lfu);
+    }
+
+    // 老化：先让平均访问次数到4，再把上限调到2触发一次全量老化
+    MyCache::KLfuAgingCache<int, BigValue> lfu_aging(CAPACITY, 1000000);
+    std::mt19937 gen(3);
+    for (int key = 0; key < CAPACITY; ++key) {
+        lfu_aging.put(key, value);
+    }
+    BigValue out;
+    for (int i = 0; i < CAPACITY * 3; ++i) {
+        lfu_aging.get(gen() % CAPACITY, out);
+    }
+    auto start = std::chrono::steady_clock::now();
+    lfu_aging.setMaxAverageNum(2);
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "LFU-Aging 全量老化(" << CAPACITY << "个节点): " << std::fixed << std::setprecision(2) << ms
+              << "ms  " << std::setprecision(1) << ms * 1e6 / CAPACITY << "ns/节点" << std::endl;
+}
+
+// 驱逐和老化内联执行与交给后台维护线程时，前台put/get的延迟分布
+void testBackgroundMaintenance() {
+    std::cout << "\n=== 测试场景19：后台维护延迟测试 ===" << std::endl;
+
+    const int CAPACITY = 200000;
+    const int OPERATIONS = 2000000;
+    const size_t SLACK = CAPACITY / 20;    // 后台模式允许暂时超出容量5%
+
+    // 一半读热点key，一半写新key(缓存已满，每次写入都需要驱逐)
+    auto run = [&](MyCache::KICachePolicy<int, int>& cache, const char* name) {
+        for (int key = 0; key < CAPACITY; ++key) {
+            cache.put(key, key);
+        }
+        std::mt19937 gen(19);
+        std::vector<double> latencies(OPERATIONS);
+        int nextKey = CAPACITY;
+        int value = 0;
+        auto begin = std::chrono::steady_clock::now();
+        for (int op = 0; op < OPERATIONS; ++op) {
+            bool write = gen() % 2 == 0;
+            int hotKey = nextKey - 1 - static_cast<int>(gen() % 1000);
+            auto start = std::chrono::steady_clock::now();
+            if (write) {
+                cache.put(nextKey++, op);
+            } else {
+                cache.get(hotKey, value);
+            }
+            latencies[op] = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+        }
+        double total = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+        std::sort(latencies.begin(), latencies.end());
+        std::cout << name << " 总耗时: " << std::fixed << std::setprecision(0) << total << "ms  p50: "
+                  << std::setprecision(2) << latencies[OPERATIONS / 2] << "us  p99: "
+                  << latencies[OPERATIONS * 99 / 100] << "us  p99.9: "
+                  << latencies[OPERATIONS * 999 / 1000] << "us  p99.99: "
+                  << latencies[OPERATIONS / 10000 * 9999] << "us  最大: " << latencies.back() << "us" << std::endl;
+    };
+
+    {
+        MyCache::KLruCache<int, int> lru(CAPACITY);
+        run(lru, "LRU 内联驱逐");
+    }
+    {
+        MyCache::KLruCache<int, int> lru(CAPACITY);
+        MyCache::KMaintenanceScheduler scheduler;
+        scheduler.attach(lru, SLACK);
+        run(lru, "LRU 后台驱逐");
+    }
+    // 上限较小，测试过程中会多次触发全量老化
+    {
+        MyCache::KLfuAgingCache<int, int> lfu(CAPACITY, 4);
+        run(lfu, "LFU-Aging 内联驱逐/老化");
+    }
+    {
+        MyCache::KLfuAgingCache<int, int> lfu(CAPACITY, 4);
+        MyCache::KMaintenanceScheduler scheduler;
+        scheduler.attach(lfu, SLACK);
+        run(lfu, "LFU-Aging 后台驱逐/老化");
+        MyCache::KMaintenanceStats stats = scheduler.stats();
+        std::cout << "后台维护: 唤醒" << stats.wakeups << "次  执行" << stats.steps << "步" << std::endl;
+    }
+}
+
+// 自动调参：负载切换时参数应被实际调整，调参线程(访问线程)与读写线程并发修改参数
+void testAutoTune() {
+    std::cout << "\n=== 测试场景20：自动调参测试 ===" << std::endl;
+
+    const int CAPACITY = 500;
+    const int OPERATIONS = 200000;
+    const int THREADS = 2;
+
+    // 每个阶段的热点集合不同：前半程热点集合是容量的2倍(需要较长的历史记录/较高的阈值过滤)，后半程在容量以内
+    auto run = [&](MyCache::KICachePolicy<int, int>& cache) {
+        std::vector<std::thread> threads;
+        for (int t = 0; t < THREADS; ++t) {
+            threads.emplace_back([&, t] {
+                std::mt19937 gen(20 + t);
+                for (int op = 0; op < OPERATIONS; ++op) {
+                    int phase = op * 4 / OPERATIONS;
+                    int range = phase < 2 ? CAPACITY * 2 : CAPACITY / 2;
+                    int key = phase * 100000 + (gen() % 10 < 8 ? gen() % range : CAPACITY * 10 + gen() % 100000);
+                    int value;
+                    if (!cache.get(key, value)) {
+                        cache.put(key, key);
+                    }
+                }
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+    };
+
+    auto report = [](const char* name, int initial, const MyCache::KAutoTuneStats& stats) {
+        std::cout << name << " 初始值: " << initial << "  当前值: " << stats.currentValue << "  窗口: "
+                  << stats.windows << "  调整: " << stats.adjustments << "次  反转: " << stats.reversals
+                  << "次  重置: " << stats.restarts << "次" << std::endl;
+        expect(stats.adjustments > 0, std::string(name) + " 参数应被调整");
+    };
+
+    MyCache::KLruKCache<int, int> lru_k(CAPACITY, 100, 2);
+    MyCache::KAutoTuneCache<int, int> tuned_lru_k(lru_k, MyCache::makeLruKHistoryParam(lru_k, 50, 5000));
+    run(tuned_lru_k);
+    report("LRU-k历史容量", 100, tuned_lru_k.stats());
+    expect(lru_k.getHistoryCapacity() == tuned_lru_k.stats().currentValue, "LRU-k历史容量应与调参器的当前值一致");
+
+    MyCache::KArcCache<int, int> arc(CAPACITY, 2);
+    MyCache::KAutoTuneCache<int, int> tuned_arc(arc, MyCache::makeArcThresholdParam(arc, 1, 16));
+    run(tuned_arc);
+    report("ARC转换阈值", 2, tuned_arc.stats());
+    expect(static_cast<int>(arc.getTransformThreshold()) == tuned_arc.stats().currentValue,
+           "ARC转换阈值应与调参器的当前值一致");
+}
+
+// 正确性回归检查：曾经出错的边界情况
+void testRegressions() {
+    std::cout << "\n=== 测试场景21：正确性回归检查 ===" << std::endl;
+    int failedBefore = g_failedChecks;
+
+    // 渐进式rehash进行中回收过期节点：回收时的删除可能完成迁移、改变桶数
+    {
+        MyCache::KLruCache<int, int> lru(16);
+        for (int key = 0; key < 16; ++key) {
+            lru.put(key, key);
+        }
+        lru.setCapacity(1000);
+        lru.clear();
+        lru.put(100, 100);      // 第17个节点触发扩容，开始渐进式迁移
+        size_t reclaimed = 0;
+        for (int i = 0; i < 8; ++i) {
+            reclaimed += lru.sweepStale(64);
+        }
+        int value = 0;
+        expect(reclaimed == 16, "rehash期间sweepStale应回收全部16个过期节点");
+        expect(lru.get(100, value) && value == 100, "rehash期间sweepStale不应影响未过期的节点");
+        expect(lru.memoryUsage().entries == 1, "rehash期间sweepStale后只应剩1个节点");
+    }
+
+    // 渐进式rehash进行中删除、遍历迁移开始后插入的节点(它在新表中，但在旧表中对应的桶可能还没迁移)
+    {
+        MyCache::KLruCache<int, int> lru(16);
+        lru.setCapacity(1000);  // 之后的写入超出构造时预留的桶数
+        for (int key = 0; key < 17; ++key) {
+            lru.put(key, key);  // 第17个节点触发扩容
+        }
+        expect(lru.memoryUsage().entries == 17, "rehash期间遍历应访问到每个节点恰好一次");
+        lru.remove(16);
+        std::vector<std::pair<int, int>> entries;
+        lru.snapshot(entries);
+        int value = 0;
+        expect(!lru.get(16, value) && entries.size() == 16, "rehash期间应能删除迁移开始后插入的节点");
+    }
+
+    // clear后L1回收过期节点时不应通知驱逐，否则互斥模式会把已清空的key降级到L2
+    {
+        auto checkCleared = [](MyCache::KICachePolicy<int, int>& l1, const char* name) {
+            MyCache::KLruCache<int, int> l2(10);
+            MyCache::KTieredCache<int, int> tiered(l1, l2, MyCache::KTierMode::Exclusive);
+            bool resurrected = false;
+            for (int round = 0; round < 5; ++round) {
+                int base = round * 10;
+                tiered.put(base + 1, 1);
+                tiered.put(base + 2, 2);
+                tiered.clear();
+                tiered.put(base + 3, 3);
+                tiered.put(base + 4, 4);
+                int value = 0;
+                if (tiered.get(base + 1, value) || tiered.get(base + 2, value)) {
+                    resurrected = true;
+                }
+            }
+            expect(!resurrected, std::string(name) + "作为L1时clear掉的key不应重新出现");
+        };
+        MyCache::KLruCache<int, int> lru(2);
+        checkCleared(lru, "KLruCache");
+        MyCache::KWindowLfuCache<int, int> windowLfu(2, 2);
+        checkCleared(windowLfu, "KWindowLfuCache");
+    }
+
+    // 后台驱逐时所有节点的频次都很高：最小频次不能停在哨兵值上，驱逐要找到真正的最低频次链表
+    {
+        MyCache::KLfuCache<int, int> lfu(1);
+        lfu.enableBackgroundMaintenance(10, [] {});
+        std::array<int, 3> freqs = {301, 201, 250};
+        for (size_t key = 0; key < freqs.size(); ++key) {
+            lfu.put(static_cast<int>(key), static_cast<int>(key));
+            int value;
+            for (int i = 1; i < freqs[key]; ++i) {
+                lfu.get(static_cast<int>(key), value);
+            }
+        }
+        bool pending = lfu.runMaintenance(64);
+        int value = 0;
+        expect(!pending && lfu.memoryUsage().entries == 1, "高频次节点的后台驱逐应回到容量以内");
+        expect(lfu.get(0, value) && value == 0, "后台驱逐应保留频次最高的节点");
+    }
+
+    // 调度器驱动的驱逐：并发写入期间不超过硬上限，停止写入后回到容量以内，留下的值都是最后写入的值
+    {
+        const int CAPACITY = 1000;
+        const size_t SLACK = 200;
+        auto check = [&](MyCache::KICachePolicy<int, int>& cache, const char* name) {
+            std::atomic<bool> overLimit(false);
+            std::vector<std::thread> threads;
+            for (int t = 0; t < 2; ++t) {
+                threads.emplace_back([&, t] {
+                    std::mt19937 gen(21 + t);
+                    for (int op = 0; op < 50000; ++op) {
+                        int key = static_cast<int>(gen() % 5000);
+                        int value;
+                        if (op % 4 == 0 || !cache.get(key, value)) {
+                            cache.put(key, key * 3);
+                        } else if (value != key * 3) {
+                            overLimit = true;
+                        }
+                        if (op % 1000 == 0 && cache.memoryUsage().entries > CAPACITY + SLACK) {
+                            overLimit = true;
+                        }
+                    }
+                });
+            }
+            for (auto& thread : threads) {
+                thread.join();
+            }
+            for (int i = 0; i < 100 && cache.memoryUsage().entries > static_cast<size_t>(CAPACITY); ++i) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            }
+            std::vector<std::pair<int, int>> entries;
+            cache.snapshot(entries);
+            bool intact = std::all_of(entries.begin(), entries.end(),
+                                      [](const std::pair<int, int>& entry) { return entry.second == entry.first * 3; });
+            expect(!overLimit, std::string(name) + "后台驱逐期间不应超过容量+余量，读到的值应正确");
+            expect(entries.size() <= static_cast<size_t>(CAPACITY), std::string(name) + "停止写入后应被驱逐回容量以内");
+            expect(intact, std::string(name) + "后台驱逐后留下的值应完整");
+        };
+        {
+            MyCache::KLruCache<int, int> lru(CAPACITY);
+            MyCache::KMaintenanceScheduler scheduler;
+            scheduler.attach(lru, SLACK);
+            check(lru, "KLruCache");
+        }
+        {
+            MyCache::KLfuCache<int, int> lfu(CAPACITY);
+            MyCache::KMaintenanceScheduler scheduler;
+            scheduler.attach(lfu, SLACK);
+            check(lfu, "KLfuCache");
+        }
+        {
+            MyCache::KLfuAgingCache<int, int> lfu(CAPACITY, 4);
+            MyCache::KMaintenanceScheduler scheduler;
+            scheduler.attach(lfu, SLACK);
+            check(lfu, "KLfuAgingCache");
+        }
+    }
+
+    // 窗口LFU的快照应从冷到热(副本全量同步按这个顺序bulkLoad)，不能是哈希表顺序
+    {
+        MyCache::KWindowLfuCache<int, int> windowLfu(8, 100);
+        for (int key = 1; key <= 8; ++key) {
+            windowLfu.put(key, key);
+        }
+        int value;
+        for (int key = 8; key >= 2; --key) {
+            for (int i = 0; i < key; ++i) {
+                windowLfu.get(key, value);    // 访问次数随key增大
+            }
+        }
+        std::vector<std::pair<int, int>> entries;
+        windowLfu.snapshot(entries);
+        bool ordered = entries.size() == 8;
+        for (size_t i = 0; ordered && i < entries.size(); ++i) {
+            ordered = entries[i].first == static_cast<int>(i) + 1;
+        }
+        expect(ordered, "KWindowLfuCache的快照应按频次从低到高");
+    }
+
+    // KICachePolicy的原子辅助操作：版本号随Store变化、Keep不变、Remove归0，过期版本号的CAS失败，容量为0时不生效
+    {
+        auto check = [](MyCache::KICachePolicy<int, int>& cache, MyCache::KICachePolicy<int, int>& empty,
+                        const std::string& name) {
+            int value = 0;
+            uint64_t version = 0;
+            expect(cache.putIfAbsent(1, 10), name + " putIfAbsent应写入不存在的key");
+            expect(!cache.putIfAbsent(1, 11) && cache.get(1, value) && value == 10,
+                   name + " putIfAbsent不应覆盖已存在的key");
+            expect(cache.getVersioned(1, value, version) && value == 10 && version != 0,
+                   name + " getVersioned应返回value和非0版本号");
+            uint64_t stored = version;
+
+            uint64_t kept = cache.compute(1, [](bool, int&, uint64_t) { return MyCache::KComputeAction::Keep; });
+            expect(kept == stored, name + " Keep不应改变版本号");
+            uint64_t updated = cache.compute(1, [](bool, int& current, uint64_t) {
+                current = 12;
+                return MyCache::KComputeAction::Store;
+            });
+            expect(updated != 0 && updated != stored, name + " Store应更新版本号");
+
+            expect(!cache.compareAndSet(1, stored, 13) && cache.get(1, value) && value == 12,
+                   name + " 版本号过期的compareAndSet应失败");
+            expect(cache.compareAndSet(1, updated, 14) && cache.get(1, value) && value == 14,
+                   name + " 版本号一致的compareAndSet应写入");
+            expect(!cache.compareAndSet(2, 1, 20) && !cache.get(2, value),
+                   name + " key不存在时期望非0版本号的compareAndSet应失败");
+            expect(cache.compareAndSet(2, 0, 20) && cache.get(2, value) && value == 20,
+                   name + " 期望版本号0的compareAndSet应写入不存在的key");
+
+            expect(cache.computeIfAbsent(3, [](const int& key) { return key * 10; }) == 30,
+                   name + " computeIfAbsent应对不存在的key调用loader");
+            expect(cache.computeIfAbsent(3, [](const int&) { return -1; }) == 30,
+                   name + " computeIfAbsent不应对已存在的key调用loader");
+            auto add = [](const int& a, const int& b) { return a + b; };
+            expect(cache.merge(4, 5, add) == 5 && cache.merge(4, 5, add) == 10 && cache.get(4, value) && value == 10,
+                   name + " merge应写入初值并累加");
+
+            expect(cache.computeValue(4, [](bool present, int& current) {
+                       current = present ? current + 1 : -1;
+                       return true;
+                   }) && cache.get(4, value) && value == 11,
+                   name + " computeValue返回true应写入修改后的值");
+            uint64_t removed = cache.compute(4, [](bool, int&, uint64_t) { return MyCache::KComputeAction::Remove; });
+            expect(removed == 0 && !cache.get(4, value), name + " Remove后版本号应为0，key不存在");
+            expect(!cache.computeValue(3, [](bool, int&) { return false; }) && !cache.get(3, value),
+                   name + " computeValue返回false应删除key");
+            expect(!cache.getVersioned(3, value, version) && version == 0,
+                   name + " getVersioned对不存在的key应返回false和版本号0");
+
+            expect(!empty.putIfAbsent(1, 1) && !empty.get(1, value), name + " 容量为0时putIfAbsent应返回false");
+            expect(!empty.compareAndSet(1, 0, 1) && !empty.get(1, value),
+                   name + " 容量为0时compareAndSet应返回false");
+            expect(!empty.computeValue(1, [](bool, int& current) { current = 1; return true; }),
+                   name + " 容量为0时computeValue应返回false");
+            expect(!empty.getVersioned(1, value, version) && version == 0,
+                   name + " 容量为0时getVersioned应找不到key");
+        };
+        MyCache::KLruCache<int, int> lru(10), lru0(0);
+        check(lru, lru0, "KLruCache");
+        MyCache::KLfuCache<int, int> lfu(10), lfu0(0);
+        check(lfu, lfu0, "KLfuCache");
+        MyCache::KArcCache<int, int> arc(10), arc0(0);
+        check(arc, arc0, "KArcCache");
+        MyCache::KCuckooCache<int, int> cuckoo(10), cuckoo0(0);
+        check(cuckoo, cuckoo0, "KCuckooCache");
+    }
+
+    // 标签失效：带标签的条目被删除、不带的保留，已淘汰或已过期(clear)的条目不计入返回值
+    {
+        auto check = [](auto& cache, const std::string& name) {
+            const int TAGGED = 10;
+            for (int key = 0; key < TAGGED; ++key) {
+                cache.put(key, key, {"a", key % 2 == 0 ? "even" : "odd"});
+            }
+            for (int key = 100; key < 400; ++key) {
+                cache.put(key, key);   // 写满后开始淘汰，最早写入的带标签条目先被淘汰
+            }
+            int value;
+            size_t present = 0;
+            for (int key = 0; key < TAGGED; ++key) {
+                present += cache.get(key, value) ? 1 : 0;
+            }
+            expect(present < TAGGED, name + " 应已淘汰部分带标签的条目");
+            expect(cache.invalidateTag("a") == present, name + " invalidateTag只应统计仍在缓存中的条目");
+            bool tagGone = true;
+            for (int key = 0; key < TAGGED; ++key) {
+                tagGone = tagGone && !cache.get(key, value);
+            }
+            expect(tagGone, name + " invalidateTag后带标签的条目应不可见");
+            expect(cache.invalidateTag("even") == 0 && cache.invalidateTag("a") == 0,
+                   name + " 已失效的标签再次失效应删除0个条目");
+            expect(cache.get(399, value) && value == 399, name + " invalidateTag不应删除不带标签的条目");
+
+            // clear之后过期的带标签节点还在索引里，只有重新写入的条目计入
+            for (int key = 500; key < 505; ++key) {
+                cache.put(key, key, {"stale"});
+            }
+            cache.clear();
+            cache.put(500, 1, {"stale"});
+            cache.put(600, 600);
+            expect(cache.invalidateTag("stale") == 1, name + " clear后过期的带标签节点不应计入invalidateTag的返回值");
+            expect(!cache.get(500, value) && cache.get(600, value) && value == 600,
+                   name + " clear后invalidateTag应只删除带标签的条目");
+        };
+        MyCache::KLruCache<int, int> lru(200);
+        check(lru, "KLruCache");
+        MyCache::KLfuCache<int, int> lfu(200);
+        check(lfu, "KLfuCache");
+        MyCache::KHashLruCaches<int, int> lruHash(200, 4);
+        check(lruHash, "KHashLruCaches");
+        MyCache::KHashLfuCache<int, int> lfuHash(200, 4);
+        check(lfuHash, "KHashLfuCache");
+    }
+
+    // 按命名空间失效：失效的key立即不可见并由sweepStale回收，其他命名空间不受影响，失效后重新写入可见
+    {
+        auto check = [](auto& cache, const std::string& name) {
+            cache.setNamespaceFunc([](const int& key) { return static_cast<uint32_t>(key / 1000); });
+            for (int ns = 0; ns < 3; ++ns) {
+                for (int i = 0; i < 50; ++i) {
+                    cache.put(ns * 1000 + i, i);
+                }
+            }
+            cache.invalidateNamespace(1);
+            int value;
+            bool invisible = true;
+            bool othersKept = true;
+            for (int i = 0; i < 50; i += 10) {
+                invisible = invisible && !cache.get(1000 + i, value);
+            }
+            for (int i = 0; i < 50; ++i) {
+                othersKept = othersKept && cache.get(i, value) && value == i
+                             && cache.get(2000 + i, value) && value == i;
+            }
+            expect(invisible, name + " invalidateNamespace后该命名空间的key应立即不可见");
+            expect(othersKept, name + " invalidateNamespace不应影响其他命名空间");
+
+            size_t swept = 0;
+            for (int i = 0; i < 100; ++i) {
+                swept += cache.sweepStale();
+            }
+            expect(swept > 0 && cache.memoryUsage().entries == 100,
+                   name + " sweepStale应回收失效命名空间的全部节点");
+
+            cache.put(1000, 7);
+            expect(cache.get(1000, value) && value == 7, name + " 失效后重新写入的key应可见");
+            expect(!cache.get(1001, value), name + " 重新写入一个key不应让同命名空间的其他key重新可见");
+        };
+        MyCache::KLruCache<int, int> lru(1000);
+        check(lru, "KLruCache");
+        MyCache::KLfuCache<int, int> lfu(1000);
+        check(lfu, "KLfuCache");
+        MyCache::KArcCache<int, int> arc(1000);
+        check(arc, "KArcCache");
+        MyCache::KHashLruCaches<int, int> lruHash(1000, 4);
+        check(lruHash, "KHashLruCaches");
+        MyCache::KHashLfuCache<int, int> lfuHash(1000, 4);
+        check(lfuHash, "KHashLfuCache");
+    }
+
+    // ARC的clear/invalidateNamespace/sweepStale与compute类操作并发：都在外层锁内执行，
+    // 不失效的命名空间0上的merge累加不应丢失
+    {
+        MyCache::KArcCache<int, int> arc(1000);
+        arc.setNamespaceFunc([](const int& key) { return static_cast<uint32_t>(key / 1000); });
+        const int COUNTERS = 16;
+        const int ROUNDS = 5000;
+        std::atomic<bool> done(false);
+        std::thread invalidator([&] {
+            while (!done.load(std::memory_order_relaxed)) {
+                arc.invalidateNamespace(1);
+                arc.sweepStale(8);
+                std::this_thread::yield();
+            }
+        });
+        std::vector<std::thread> writers;
+        for (int t = 0; t < 2; ++t) {
+            writers.emplace_back([&, t] {
+                auto add = [](const int& a, const int& b) { return a + b; };
+                for (int i = 0; i < ROUNDS; ++i) {
+                    arc.merge(i % COUNTERS, 1, add);
+                    arc.putIfAbsent(1000 + (i + t) % 200, i);
+                }
+            });
+        }
+        for (auto& writer : writers) {
+            writer.join();
+        }
+        done = true;
+        invalidator.join();
+        int total = 0;
+        for (int key = 0; key < COUNTERS; ++key) {
+            int value = 0;
+            arc.get(key, value);
+            total += value;
+        }
+        expect(total == 2 * ROUNDS, "KArcCache并发失效命名空间期间，其他命名空间上的merge不应丢失");
+        arc.invalidateNamespace(1);
+        for (int i = 0; i < 100; ++i) {
+            arc.sweepStale();
+        }
+        expect(arc.memoryUsage().entries == COUNTERS, "KArcCache并发失效后sweepStale应回收全部失效节点");
+    }
+
+    // 批量读写：跨多个分片的一批key，结果(以及淘汰后剩下的条目)应与逐个put/get完全相同
+    {
+        auto check = [](auto& batched, auto& single, const std::string& name) {
+            using HashedKey = MyCache::KHashedKey<int>;
+            std::vector<std::pair<HashedKey, int>> entries;
+            for (int key = 0; key < 200; ++key) {
+                entries.emplace_back(HashedKey(key), key * 2);
+            }
+            entries.emplace_back(HashedKey(7), -7);     // 同一批中重复的key，后写入的生效
+            batched.putBatch(entries);
+            for (const auto& entry : entries) {
+                single.put(entry.first.key, entry.second);
+            }
+
+            std::vector<HashedKey> keys;
+            for (int key = 300; key >= 0; key -= 3) {
+                keys.emplace_back(key);              // 包含已淘汰和从未写入的key
+            }
+            std::vector<int> values(keys.size());
+            std::vector<bool> hits(keys.size());
+            size_t hitCount = batched.getBatch(keys, values, hits);
+            bool same = values.size() == keys.size() && hits.size() == keys.size();
+            size_t expectedHits = 0;
+            for (size_t i = 0; same && i < keys.size(); ++i) {
+                int value = 0;
+                bool hit = single.get(keys[i].key, value);
+                expectedHits += hit ? 1 : 0;
+                same = hits[i] == hit && (!hit || values[i] == value);
+            }
+            expect(same && hitCount == expectedHits, name + " getBatch的结果应与逐个get相同");
+
+            std::vector<std::pair<int, int>> batchedEntries, singleEntries;
+            batched.snapshot(batchedEntries);
+            single.snapshot(singleEntries);
+            expect(batchedEntries == singleEntries, name + " putBatch/getBatch后的缓存内容和顺序应与逐个put/get相同");
+        };
+        MyCache::KLruCache<int, int> lru(120), lruSingle(120);
+        check(lru, lruSingle, "KLruCache");
+        MyCache::KLfuCache<int, int> lfu(120), lfuSingle(120);
+        check(lfu, lfuSingle, "KLfuCache");
+        MyCache::KHashLruCaches<int, int> lruHash(120, 4), lruHashSingle(120, 4);
+        check(lruHash, lruHashSingle, "KHashLruCaches");
+        MyCache::KHashLfuCache<int, int> lfuHash(120, 4), lfuHashSingle(120, 4);
+        check(lfuHash, lfuHashSingle, "KHashLfuCache");
+    }
+
+    // 小容量缓存：与链表实现的LRU模型逐步对照(命中、value、被淘汰的key、快照顺序)，
+    // 包括数组中间的删除，4字节整数key走直接比较，string key走tag比较
+    {
+        static_assert(std::is_same<MyCache::KStaticLruCache<int, int, 64>, MyCache::KTinyCache<int, int, 64>>::value,
+                      "容量64应选用KTinyCache");
+        static_assert(std::is_base_of<MyCache::KLruCache<int, int>, MyCache::KStaticLruCache<int, int, 65>>::value,
+                      "容量65应退回KLruCache");
+
+        auto check = [](auto& cache, auto keyOf, size_t capacity, const std::string& name) {
+            using Key = decltype(keyOf(0));
+            std::list<std::pair<Key, int>> model;   // 从新到旧
+            std::vector<Key> evicted;
+            cache.setEvictionListener([&](const Key& key, const int&) { evicted.push_back(key); });
+            auto find = [&](const Key& key) {
+                return std::find_if(model.begin(), model.end(),
+                                    [&](const std::pair<Key, int>& entry) { return entry.first == key; });
+            };
+            std::mt19937 gen(87);
+            bool matched = true;
+            for (int op = 0; op < 20000 && matched; ++op) {
+                Key key = keyOf(static_cast<int>(gen() % (capacity * 2)));
+                auto it = find(key);
+                int value = 0;
+                switch (gen() % 4) {
+                case 0:
+                case 1: {
+                    bool hit = cache.get(key, value);
+                    matched = hit == (it != model.end()) && (!hit || value == it->second);
+                    if (hit) {
+                        model.splice(model.begin(), model, it);
+                    }
+                    break;
+                }
+                case 2: {
+                    evicted.clear();
+                    cache.put(key, op);
+                    if (it != model.end()) {
+                        model.erase(it);
+                    } else if (model.size() == capacity) {
+                        matched = evicted.size() == 1 && evicted[0] == model.back().first;
+                        model.pop_back();
+                    }
+                    model.emplace_front(key, op);
+                    break;
+                }
+                default: {
+                    cache.compute(key, [](bool, int&, uint64_t) { return MyCache::KComputeAction::Remove; });
+                    if (it != model.end()) {
+                        model.erase(it);
+                    }
+                    break;
+                }
+                }
+            }
+            std::vector<std::pair<Key, int>> entries;
+            cache.snapshot(entries);
+            matched = matched && std::equal(entries.begin(), entries.end(), model.rbegin(), model.rend());
+            expect(matched, name + " 应与精确LRU的命中、淘汰顺序和快照完全一致");
+        };
+        MyCache::KTinyCache<int, int, 20> tinyInt;
+        check(tinyInt, [](int k) { return k; }, 20, "KTinyCache<int>");
+        MyCache::KTinyCache<std::string, int, 20> tinyString;
+        check(tinyString, [](int k) { return "key-" + std::to_string(k); }, 20, "KTinyCache<string>");
+        MyCache::KStaticLruCache<int, int, 64> staticTiny;
+        check(staticTiny, [](int k) { return k; }, 64, "KStaticLruCache<64>");
+
+        // 删除数组中间的条目(最后一个条目被挪来填补空位)后，其余条目都能查到，删除的查不到
+        MyCache::KTinyCache<std::string, int, 8> tiny;
+        for (int k = 0; k < 8; ++k) {
+            tiny.put("k" + std::to_string(k), k);
+        }
+        tiny.compute("k3", [](bool, int&, uint64_t) { return MyCache::KComputeAction::Remove; });
+        bool found = true;
+        int value;
+        for (int k = 0; k < 8; ++k) {
+            bool hit = tiny.get("k" + std::to_string(k), value);
+            found = found && (k == 3 ? !hit : hit && value == k);
+        }
+        tiny.put("k8", 8);
+        found = found && tiny.get("k7", value) && value == 7 && tiny.get("k8", value) && value == 8 && tiny.size() == 8;
+        expect(found, "KTinyCache删除中间条目后其余条目应都能查到，空位应被复用");
+    }
+
+    std::cout << (g_failedChecks == failedBefore ? "全部通过" : "存在失败的检查") << std::endl;
+}
+
 int main() {
     testHotDataAccess();
     testLoopPattern();
     testWorkloadShift();
-    return 0;
+    testWindowLfuAdaptation();
+    testReadScalability();
+    testSetAssocHitRate();
+    testFillLatency();
+    testMemoryOverhead();
+    testBulkLoad();
+    testAppendLog();
+    testReplication();
+    testCacheCluster();
+    testInvalidationBus();
+    testSharedMemoryCache();
+    testTieredCache();
+    testStringKeys();
+    testIntegerKeys();
+    testMetadataScan();
+    testBackgroundMaintenance();
+    testAutoTune();
+    testRegressions();
+    return g_failedChecks == 0 ? 0 : 1;
 }
\ No newline at end of file
@@ -0,0 +1,144 @@
+// 事件追踪测试：整个程序定义 MYCACHE_EVENT_TRACING 编译(宏会改变缓存使用的锁类型，不能和main混在一个程序里)
+#ifndef MYCACHE_EVENT_TRACING
+#define MYCACHE_EVENT_TRACING
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <iostream>
+#include <set>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "KLruCache.h"
+#include "KLfuCache.h"
+#include "KArcCache/KArcCache.h"
+#include "KEventTrace.h"
+
+int g_failedChecks = 0;
+
+void expect(bool ok, const std::string& what) {
+    if (!ok) {
+        ++g_failedChecks;
+        std::cout << "[检查失败] " << what << std::endl;
+    }
+}
+
+// 取出一条事件中 "field":"..." 的字符串值
+std::string stringField(const std::string& event, const std::string& field) {
+    std::string key = "\"" + field + "\":\"";
+    size_t begin = event.find(key);
+    if (begin == std::string::npos) {
+        return "";
+    }
+    begin += key.size();
+    size_t end = event.find('"', begin);
+    return end == std::string::npos ? "" : event.substr(begin, end - begin);
+}
+
+// 检查导出的JSON：外层结构完整，每条事件的名称、来源、阶段都是缓存会记录的值(撕裂的记录会产生非法值)
+// 返回各事件名称的出现次数
+std::vector<size_t> checkTrace(const std::string& json, bool& valid) {
+    static const std::vector<std::string> names = {"lock_wait", "evict", "aging", "resize"};
+    static const std::set<std::string> sources = {"mutex", "KLruCache", "KLfuCache", "KLfuAgingCache",
+                                                  "KArcCache.lru", "KArcCache.lfu"};
+    std::vector<size_t> counts(names.size(), 0);
+    const std::string head = "{\"traceEvents\":[";
+    const std::string tail = "\n],\"displayTimeUnit\":\"ns\"}\n";
+    valid = json.compare(0, head.size(), head) == 0 && json.size() >= head.size() + tail.size()
+            && json.compare(json.size() - tail.size(), tail.size(), tail) == 0;
+    if (!valid) {
+        return counts;
+    }
+    std::istringstream lines(json.substr(head.size(), json.size() - head.size() - tail.size()));
+    std::string line;
+    while (std::getline(lines, line)) {
+        if (line.empty()) {
+            continue;
+        }
+        if (line.back() == ',') {
+            line.pop_back();
+        }
+        std::string name = stringField(line, "name");
+        std::string phase = stringField(line, "ph");
+        auto it = std::find(names.begin(), names.end(), name);
+        bool hasDuration = line.find("\"dur\":") != std::string::npos;
+        bool ok = line.front() == '{' && line.back() == '}' && it != names.end()
+                  && sources.count(stringField(line, "cat")) == 1
+                  && phase == (hasDuration ? "X" : "i")
+                  && (name != "evict" || !hasDuration)
+                  && line.find("\"tid\":") != std::string::npos && line.find("\"args\":{\"arg\":") != std::string::npos;
+        if (!ok) {
+            valid = false;
+            std::cout << "非法事件: " << line << std::endl;
+            break;
+        }
+        ++counts[it - names.begin()];
+    }
+    return counts;
+}
+
+int main() {
+    std::cout << "=== 事件追踪测试 ===" << std::endl;
+
+    // 多个线程持续产生驱逐、降频、锁等待事件(写满并反复覆盖各自的环形缓冲区)，同时另一个线程反复导出
+    MyCache::KLruCache<int, int> lru(64);
+    MyCache::KLfuAgingCache<int, int> lfu(64, 4);
+    MyCache::KArcCache<int, int> arc(64);
+    std::atomic<bool> done(false);
+    std::atomic<int> dumps(0);
+    std::atomic<bool> invalidDump(false);
+    std::thread dumper([&] {
+        while (!done.load(std::memory_order_relaxed)) {
+            std::ostringstream os;
+            MyCache::KEventTracer::instance().dumpChromeTrace(os);
+            bool valid = false;
+            checkTrace(os.str(), valid);
+            if (!valid) {
+                invalidDump = true;
+            }
+            ++dumps;
+        }
+    });
+    std::vector<std::thread> writers;
+    for (int t = 0; t < 3; ++t) {
+        writers.emplace_back([&, t] {
+            int value;
+            for (int i = 0; i < 60000; ++i) {
+                int key = i * 3 + t;
+                lru.put(key, key);
+                lfu.put(key, key);
+                lfu.get(t, value);
+                arc.put(key % 200, key);
+                arc.get(key % 100, value);
+            }
+        });
+    }
+    for (auto& writer : writers) {
+        writer.join();
+    }
+    done = true;
+    dumper.join();
+    lru.setCapacity(32);
+
+    std::ostringstream os;
+    MyCache::KEventTracer::instance().dumpChromeTrace(os);
+    bool valid = false;
+    std::vector<size_t> counts = checkTrace(os.str(), valid);
+    std::cout << "并发导出次数: " << dumps << "  最终事件数: evict " << counts[1] << ", aging " << counts[2]
+              << ", resize " << counts[3] << ", lock_wait " << counts[0] << std::endl;
+
+    expect(dumps > 0, "写入期间应至少导出一次");
+    expect(!invalidDump, "与写入并发导出的JSON中不应出现撕裂或非法的事件");
+    expect(valid, "最终导出的JSON应结构完整");
+    expect(counts[1] >= MyCache::KTraceRing::kCapacity, "驱逐事件应写满至少一个线程的环形缓冲区");
+    expect(counts[1] + counts[2] + counts[3] + counts[0] <= 4 * MyCache::KTraceRing::kCapacity,
+           "每个线程最多导出kCapacity条事件");
+    expect(counts[2] > 0, "LFU-Aging应记录降频事件");
+    expect(counts[3] > 0, "调整容量应记录resize事件");
+
+    std::cout << (g_failedChecks == 0 ? "全部通过" : "存在失败的检查") << std::endl;
+    return g_failedChecks == 0 ? 0 : 1;
+}